@@ -30,6 +30,13 @@ G_BEGIN_DECLS
 #define RTP_HDR_EXT_ABS_SEND_TIME_URI "http://www.webrtc.org/experiments/rtp-hdrext/abs-send-time"
 #define RTP_HDR_EXT_ABS_SEND_TIME_SIZE 3
 #define RTP_HDR_EXT_ABS_SEND_TIME_ID 3  /* TODO: do it dynamic when needed */
+#define RTP_HDR_EXT_AUDIO_LEVEL_URI "urn:ietf:params:rtp-hdrext:ssrc-audio-level"
+#define RTP_HDR_EXT_AUDIO_LEVEL_ID 1
+#define RTP_HDR_EXT_TRANSPORT_CC_URI "http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01"
+#define RTP_HDR_EXT_SDES_MID_URI "urn:ietf:params:rtp-hdrext:sdes:mid"
+#define RTP_HDR_EXT_SDES_RID_URI "urn:ietf:params:rtp-hdrext:sdes:rtp-stream-id"
+#define RTP_HDR_EXT_SDES_REPAIRED_RID_URI "urn:ietf:params:rtp-hdrext:sdes:repaired-rtp-stream-id"
+#define RTP_HDR_EXT_VIDEO_ORIENTATION_URI "urn:3gpp:video-orientation"
 
 /* RTP/RTCP profiles */
 #define SDP_MEDIA_RTP_AVP_PROTO "RTP/AVP"
@@ -33,6 +33,7 @@
 #include "sdpagent/kmssdpredundantext.h"
 #include "sdpagent/kmssdprtpavpfmediahandler.h"
 #include "kmsremb.h"
+#include "kmsrtphdrext.h"
 #include "kmsrefstruct.h"
 
 #include <gst/rtp/gstrtpdefs.h>
@@ -81,6 +82,8 @@ G_DEFINE_TYPE_WITH_CODE (KmsBaseRtpEndpoint, kms_base_rtp_endpoint,
 
 #define PICTURE_ID_15_BIT 2
 
+#define AUDIO_LEVEL_SIGNAL_INTERVAL (100 * GST_MSECOND)
+
 #define index_of(str,chr) ({  \
   gint __pos;                 \
   gchar *__c;                 \
@@ -229,6 +232,7 @@ struct _KmsBaseRtpEndpointPrivate
   GstStructure *remb_params;
   KmsRembLocal *rl;
   KmsRembRemote *rm;
+  gulong remb_consumer;
 
   /* Port range */
   guint min_port;
@@ -245,6 +249,13 @@ struct _KmsBaseRtpEndpointPrivate
   KmsRtpSynchronizer *sync_audio;
   KmsRtpSynchronizer *sync_video;
   gboolean perform_video_sync;
+  gulong sync_consumer;
+
+  /* Audio level (RFC 6464) */
+  KmsRtpHdrExtMap *audio_hdr_exts;
+  gboolean audio_level_probe;
+  GMutex audio_levels_mutex;
+  GHashTable *audio_levels;     /* ssrc -> AudioLevelData */
 };
 
 /* Signals and args */
@@ -256,6 +267,7 @@ enum
   GET_CONNECTION_STATE,
   CONNECTION_STATE_CHANGED,
   SIGNAL_REQUEST_LOCAL_KEY_FRAME,
+  SIGNAL_AUDIO_LEVEL,
   LAST_SIGNAL
 };
 
@@ -344,16 +356,7 @@ hdr_ext_data_destroy_pointer (gpointer data)
 static void
 kms_base_rtp_endpoint_rtp_hdr_ext_set_time (guint8 * data)
 {
-  GstClockTime current_time, ms;
-  guint value;
-
-  current_time = kms_utils_get_time_nsecs ();
-  ms = GST_TIME_AS_MSECONDS (current_time);
-  value = (((ms << 18) / 1000) & 0x00ffffff);
-
-  data[0] = (guint8) (value >> 16);
-  data[1] = (guint8) (value >> 8);
-  data[2] = (guint8) (value);
+  kms_rtp_hdr_ext_abs_send_time_encode (kms_utils_get_time_nsecs (), data);
 }
 
 static void
@@ -488,6 +491,111 @@ kms_base_rtp_endpoint_config_rtp_hdr_ext (KmsBaseRtpEndpoint * self,
   g_object_unref (pad);
 }
 
+typedef struct _AudioLevelData
+{
+  guint level;
+  gboolean voice_activity;
+  GstClockTime last_signal;
+} AudioLevelData;
+
+static void
+audio_level_data_destroy (gpointer data)
+{
+  g_slice_free (AudioLevelData, data);
+}
+
+static void
+kms_base_rtp_endpoint_audio_level_cb (const KmsRtpHdrExtValues * values,
+    GstRTPBuffer * rtp, gpointer user_data)
+{
+  KmsBaseRtpEndpoint *self = KMS_BASE_RTP_ENDPOINT (user_data);
+  guint32 ssrc = gst_rtp_buffer_get_ssrc (rtp);
+  GstClockTime now = kms_utils_get_time_nsecs ();
+  AudioLevelData *data;
+  gboolean emit;
+
+  g_mutex_lock (&self->priv->audio_levels_mutex);
+
+  data = g_hash_table_lookup (self->priv->audio_levels,
+      GUINT_TO_POINTER (ssrc));
+  if (data == NULL) {
+    data = g_slice_new0 (AudioLevelData);
+    data->last_signal = GST_CLOCK_TIME_NONE;
+    g_hash_table_insert (self->priv->audio_levels, GUINT_TO_POINTER (ssrc),
+        data);
+  }
+
+  /* Voice activity changes are notified at once, levels are throttled */
+  emit = !GST_CLOCK_TIME_IS_VALID (data->last_signal)
+      || data->voice_activity != values->voice_activity
+      || now - data->last_signal >= AUDIO_LEVEL_SIGNAL_INTERVAL;
+
+  data->level = values->audio_level;
+  data->voice_activity = values->voice_activity;
+
+  if (emit) {
+    data->last_signal = now;
+  }
+
+  g_mutex_unlock (&self->priv->audio_levels_mutex);
+
+  if (emit && g_signal_has_handler_pending (self,
+          obj_signals[SIGNAL_AUDIO_LEVEL], 0, FALSE)) {
+    g_signal_emit (self, obj_signals[SIGNAL_AUDIO_LEVEL], 0, ssrc,
+        (guint) values->audio_level, values->voice_activity);
+  }
+}
+
+static GstPadProbeReturn
+kms_base_rtp_endpoint_audio_level_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  KmsBaseRtpEndpoint *self = KMS_BASE_RTP_ENDPOINT (user_data);
+
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER) {
+    kms_rtp_hdr_ext_map_process_buffer (self->priv->audio_hdr_exts,
+        GST_PAD_PROBE_INFO_BUFFER (info));
+  } else if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    GstBufferList *bufflist = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
+    guint i, len = gst_buffer_list_length (bufflist);
+
+    for (i = 0; i < len; i++) {
+      kms_rtp_hdr_ext_map_process_buffer (self->priv->audio_hdr_exts,
+          gst_buffer_list_get (bufflist, i));
+    }
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+kms_base_rtp_endpoint_config_audio_level (KmsBaseRtpEndpoint * self,
+    const GstSDPMedia * media, GstPad * pad)
+{
+  if (self->priv->audio_level_probe) {
+    return;
+  }
+
+  kms_rtp_hdr_ext_map_add_from_sdp_media (self->priv->audio_hdr_exts, media);
+
+  if (kms_rtp_hdr_ext_map_get_id (self->priv->audio_hdr_exts,
+          KMS_RTP_HDR_EXT_AUDIO_LEVEL) == 0) {
+    GST_DEBUG_OBJECT (self, "audio-level not negotiated.");
+    return;
+  }
+
+  GST_DEBUG_OBJECT (self, "Add probe for reading audio-level (%"
+      GST_PTR_FORMAT ").", pad);
+
+  self->priv->audio_level_probe = TRUE;
+  kms_rtp_hdr_ext_map_add_handler (self->priv->audio_hdr_exts,
+      KMS_RTP_HDR_EXT_FLAG (KMS_RTP_HDR_EXT_AUDIO_LEVEL),
+      kms_base_rtp_endpoint_audio_level_cb, self, NULL);
+  gst_pad_add_probe (pad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      kms_base_rtp_endpoint_audio_level_probe, self, NULL);
+}
+
 /* RTP hdrext end */
 
 /* Media handler management begin */
@@ -571,7 +679,7 @@ kms_base_rtp_create_media_handler (KmsBaseSdpEndpoint * base_sdp,
   }
   h_avp = KMS_SDP_RTP_AVP_MEDIA_HANDLER (*handler);
   kms_sdp_rtp_avp_media_handler_add_extmap (h_avp, RTP_HDR_EXT_ABS_SEND_TIME_ID,
-      RTP_HDR_EXT_ABS_SEND_TIME_URI, &err);
+      kms_rtp_hdr_ext_type_get_uri (KMS_RTP_HDR_EXT_ABS_SEND_TIME), &err);
 
   if (err != NULL) {
     GST_WARNING_OBJECT (base_sdp, "Cannot add extmap '%s'", err->message);
@@ -579,6 +687,18 @@ kms_base_rtp_create_media_handler (KmsBaseSdpEndpoint * base_sdp,
     err = NULL;
   }
 
+  if (g_strcmp0 (media, AUDIO_STREAM_NAME) == 0) {
+    kms_sdp_rtp_avp_media_handler_add_extmap (h_avp,
+        RTP_HDR_EXT_AUDIO_LEVEL_ID,
+        kms_rtp_hdr_ext_type_get_uri (KMS_RTP_HDR_EXT_AUDIO_LEVEL), &err);
+
+    if (err != NULL) {
+      GST_WARNING_OBJECT (base_sdp, "Cannot add extmap '%s'", err->message);
+      g_error_free (err);
+      err = NULL;
+    }
+  }
+
   if (self->priv->support_fec) {
     kms_base_rtp_configure_extensions (self, media, *handler);
   }
@@ -855,6 +975,10 @@ kms_base_rtp_endpoint_request_rtp_sink (KmsIRtpSessionManager * manager,
     pad =
         gst_element_get_request_pad (self->priv->rtpbin,
         AUDIO_RTPBIN_RECV_RTP_SINK);
+
+    if (pad != NULL) {
+      kms_base_rtp_endpoint_config_audio_level (self, media, pad);
+    }
   } else if (g_strcmp0 (VIDEO_STREAM_NAME, media_str) == 0) {
     pad =
         gst_element_get_request_pad (self->priv->rtpbin,
@@ -983,6 +1107,17 @@ end:
   return ret;
 }
 
+static void
+kms_base_rtp_endpoint_remb_rtcp_cb (const KmsRTCPPacketView * view,
+    gpointer user_data)
+{
+  KmsRembRemote *rm = user_data;
+
+  if (view->remb != NULL) {
+    kms_remb_remote_process_remb (rm, view->remb);
+  }
+}
+
 static void
 kms_base_rtp_endpoint_create_remb_manager (KmsBaseRtpEndpoint *self,
     KmsBaseRtpSession *sess)
@@ -1034,6 +1169,11 @@ kms_base_rtp_endpoint_create_remb_manager (KmsBaseRtpEndpoint *self,
   g_object_unref (pad);
   g_object_unref (rtpsession);
 
+  self->priv->remb_consumer =
+      kms_rtcp_dispatcher_add_consumer (sess->rtcp_dispatcher,
+      KMS_RTCP_PACKET_VIEW_REMB, kms_base_rtp_endpoint_remb_rtcp_cb,
+      self->priv->rm, NULL);
+
   if (self->priv->remb_params != NULL) {
     kms_remb_local_set_params (self->priv->rl, self->priv->remb_params);
     kms_remb_remote_set_params (self->priv->rm, self->priv->remb_params);
@@ -1488,6 +1628,44 @@ connection_state_changed (KmsSdpSession * sess, guint new_state,
       new_state);
 }
 
+static KmsRtpSynchronizer *
+kms_base_rtp_endpoint_get_sync_for_ssrc (KmsBaseRtpEndpoint * self,
+    guint32 ssrc)
+{
+  KmsBaseRtpSession *sess = self->priv->sess;
+
+  /* The dispatcher sees the SRs of every stream of the session, keep only
+   * the ones of the streams being synchronized */
+  if (ssrc == sess->remote_audio_ssrc
+      || ssrc == kms_rtp_synchronizer_get_ssrc (self->priv->sync_audio)) {
+    return self->priv->sync_audio;
+  }
+
+  if (self->priv->perform_video_sync && (ssrc == sess->remote_video_ssrc
+          || ssrc == kms_rtp_synchronizer_get_ssrc (self->priv->sync_video))) {
+    return self->priv->sync_video;
+  }
+
+  return NULL;
+}
+
+static void
+kms_base_rtp_endpoint_sync_rtcp_cb (const KmsRTCPPacketView * view,
+    gpointer user_data)
+{
+  KmsBaseRtpEndpoint *self = KMS_BASE_RTP_ENDPOINT (user_data);
+  KmsRtpSynchronizer *sync;
+
+  if (view->sender_ssrc == 0) {
+    return;
+  }
+
+  sync = kms_base_rtp_endpoint_get_sync_for_ssrc (self, view->sender_ssrc);
+  if (sync != NULL) {
+    kms_rtp_synchronizer_process_rtcp_packet (sync, view->packet, view->time);
+  }
+}
+
 static void
 kms_base_rtp_endpoint_create_session_internal (KmsBaseSdpEndpoint * base_sdp,
     gint id, KmsSdpSession ** sess)
@@ -1516,6 +1694,10 @@ kms_base_rtp_endpoint_create_session_internal (KmsBaseSdpEndpoint * base_sdp,
   g_signal_connect (*sess, "connection-state-changed",
       (GCallback) connection_state_changed, self);
 
+  self->priv->sync_consumer =
+      kms_rtcp_dispatcher_add_consumer (self->priv->sess->rtcp_dispatcher,
+      KMS_RTCP_PACKET_VIEW_SR, kms_base_rtp_endpoint_sync_rtcp_cb, self, NULL);
+
 end:
 
   /* Chain up */
@@ -1865,48 +2047,6 @@ timestamps_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
   return GST_PAD_PROBE_OK;
 }
 
-static gboolean
-kms_base_rtp_endpoint_process_rtcp_bufflist (GstBuffer ** buf, guint idx,
-    KmsRtpSynchronizer * sync)
-{
-  kms_rtp_synchronizer_process_rtcp_buffer (sync, *buf,
-      GST_BUFFER_DTS (*buf), NULL);
-
-  return TRUE;
-}
-
-static GstPadProbeReturn
-rtcp_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
-{
-  KmsRtpSynchronizer *sync = user_data;
-
-  if (GST_PAD_PROBE_INFO_TYPE (info) | GST_PAD_PROBE_TYPE_BUFFER) {
-    GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
-
-    kms_rtp_synchronizer_process_rtcp_buffer (sync, buffer,
-        GST_BUFFER_DTS (buffer), NULL);
-  } else {
-    GstBufferList *bufflist = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
-
-    gst_buffer_list_foreach (bufflist,
-        (GstBufferListFunc) kms_base_rtp_endpoint_process_rtcp_bufflist, sync);
-  }
-
-  return GST_PAD_PROBE_OK;
-}
-
-static void
-pad_added_jb (GstElement * jitterbuffer, GstPad * new_pad, gpointer sync)
-{
-  if (g_strcmp0 (GST_OBJECT_NAME (new_pad), "sink_rtcp") != 0) {
-    return;
-  }
-
-  gst_pad_add_probe (new_pad,
-      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
-      rtcp_probe, sync, NULL);
-}
-
 static void
 kms_base_rtp_endpoint_rtpbin_new_jitterbuffer (GstElement * rtpbin,
     GstElement * jitterbuffer,
@@ -1933,13 +2073,6 @@ kms_base_rtp_endpoint_rtpbin_new_jitterbuffer (GstElement * rtpbin,
       NULL);
   g_object_unref (src_pad);
 
-  if ((session == AUDIO_RTP_SESSION) || self->priv->perform_video_sync) {
-    g_signal_connect (jitterbuffer, "pad-added", G_CALLBACK (pad_added_jb),
-        GINT_TO_POINTER (session ==
-            VIDEO_RTP_SESSION ? self->priv->sync_video : self->
-            priv->sync_audio));
-  }
-
   KMS_ELEMENT_LOCK (self);
 
   rtp_stats =
@@ -2484,6 +2617,15 @@ kms_base_rtp_endpoint_finalize (GObject * gobject)
     kms_list_unref (self->priv->prot_medias);
   }
 
+  if (self->priv->sess != NULL) {
+    if (self->priv->remb_consumer != 0) {
+      kms_rtcp_dispatcher_remove_consumer (self->priv->sess->rtcp_dispatcher,
+          self->priv->remb_consumer);
+    }
+    kms_rtcp_dispatcher_remove_consumer (self->priv->sess->rtcp_dispatcher,
+        self->priv->sync_consumer);
+  }
+
   kms_remb_local_destroy (self->priv->rl);
   kms_remb_remote_destroy (self->priv->rm);
 
@@ -2498,6 +2640,10 @@ kms_base_rtp_endpoint_finalize (GObject * gobject)
   g_clear_object (&self->priv->sync_audio);
   g_clear_object (&self->priv->sync_video);
 
+  kms_rtp_hdr_ext_map_free (self->priv->audio_hdr_exts);
+  g_hash_table_destroy (self->priv->audio_levels);
+  g_mutex_clear (&self->priv->audio_levels_mutex);
+
   G_OBJECT_CLASS (kms_base_rtp_endpoint_parent_class)->finalize (gobject);
 }
 
@@ -2563,6 +2709,47 @@ kms_base_rtp_endpoint_append_remb_stats (KmsBaseRtpEndpoint * self,
   }
 }
 
+static void
+merge_audio_level_stats (gpointer key, AudioLevelData * data,
+    GstStructure * stats)
+{
+  const GstStructure *session_stats, *ssrc_stats;
+  gchar *ssrc_id;
+
+  session_stats = get_structure_from_id (stats, "session-"
+      AUDIO_RTP_SESSION_STR);
+
+  if (session_stats == NULL) {
+    return;
+  }
+
+  ssrc_id = g_strdup_printf ("ssrc-%u", GPOINTER_TO_UINT (key));
+  ssrc_stats = get_structure_from_id (session_stats, ssrc_id);
+  g_free (ssrc_id);
+
+  if (ssrc_stats == NULL) {
+    return;
+  }
+
+  gst_structure_set ((GstStructure *) ssrc_stats, "audio-level", G_TYPE_UINT,
+      data->level, "voice-activity", G_TYPE_BOOLEAN, data->voice_activity,
+      NULL);
+}
+
+static void
+kms_base_rtp_endpoint_append_audio_level_stats (KmsBaseRtpEndpoint * self,
+    GstStructure * stats, gchar * selector)
+{
+  if (selector != NULL && g_strcmp0 (selector, AUDIO_STREAM_NAME) != 0) {
+    return;
+  }
+
+  g_mutex_lock (&self->priv->audio_levels_mutex);
+  g_hash_table_foreach (self->priv->audio_levels,
+      (GHFunc) merge_audio_level_stats, stats);
+  g_mutex_unlock (&self->priv->audio_levels_mutex);
+}
+
 static gchar *
 kms_element_get_padname_from_id (KmsBaseRtpEndpoint * self, const gchar * id)
 {
@@ -2623,6 +2810,7 @@ kms_element_get_e2e_latency_stats (KmsBaseRtpEndpoint * self, gchar * selector)
         (avg->type ==
             KMS_MEDIA_TYPE_AUDIO) ? AUDIO_STREAM_NAME : VIDEO_STREAM_NAME,
         "avg", G_TYPE_UINT64, (guint64) avg->avg, NULL);
+    kms_stats_set_latency_percentiles (pad_latency, avg->hist);
 
     gst_structure_set (stats, padname, GST_TYPE_STRUCTURE, pad_latency, NULL);
     gst_structure_free (pad_latency);
@@ -2648,6 +2836,7 @@ kms_base_rtp_endpoint_stats (KmsElement * obj, gchar * selector)
   rtp_stats = gst_structure_new_empty (KMS_RTP_STRUCT_NAME);
   kms_base_rtp_endpoint_add_rtp_stats (self, rtp_stats, selector);
   kms_base_rtp_endpoint_append_remb_stats (self, rtp_stats, selector);
+  kms_base_rtp_endpoint_append_audio_level_stats (self, rtp_stats, selector);
 
   gst_structure_set (stats, KMS_RTC_STATISTICS_FIELD, GST_TYPE_STRUCTURE,
       rtp_stats, NULL);
@@ -2898,6 +3087,14 @@ kms_base_rtp_endpoint_class_init (KmsBaseRtpEndpointClass * klass)
       G_STRUCT_OFFSET (KmsBaseRtpEndpointClass, request_local_key_frame), NULL,
       NULL, __kms_core_marshal_BOOLEAN__VOID, G_TYPE_BOOLEAN, 0);
 
+  obj_signals[SIGNAL_AUDIO_LEVEL] =
+      g_signal_new ("audio-level",
+      G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST,
+      G_STRUCT_OFFSET (KmsBaseRtpEndpointClass, audio_level), NULL, NULL,
+      __kms_core_marshal_VOID__UINT_UINT_BOOLEAN, G_TYPE_NONE, 3,
+      G_TYPE_UINT, G_TYPE_UINT, G_TYPE_BOOLEAN);
+
   g_type_class_add_private (klass, sizeof (KmsBaseRtpEndpointPrivate));
 
   stats_files_dir = g_getenv ("KURENTO_GENERATE_RTP_PTS_STATS");
@@ -3277,6 +3474,11 @@ kms_base_rtp_endpoint_init (KmsBaseRtpEndpoint * self)
   self->priv->min_video_send_bw = MIN_VIDEO_SEND_BW_DEFAULT;
   self->priv->max_video_send_bw = MAX_VIDEO_SEND_BW_DEFAULT;
 
+  self->priv->audio_hdr_exts = kms_rtp_hdr_ext_map_new ();
+  g_mutex_init (&self->priv->audio_levels_mutex);
+  self->priv->audio_levels = g_hash_table_new_full (NULL, NULL, NULL,
+      audio_level_data_destroy);
+
   self->priv->rtpbin = gst_element_factory_make ("rtpbin", NULL);
 
   g_signal_connect (self->priv->rtpbin, "request-pt-map",
@@ -68,6 +68,9 @@ struct _KmsBaseRtpEndpointClass
   void (*connection_state_changed) (KmsBaseRtpEndpoint * self, KmsConnectionState new_state);
 
   gboolean (*request_local_key_frame) (KmsBaseRtpEndpoint * self);
+
+  void (*audio_level) (KmsBaseRtpEndpoint * self, guint ssrc, guint level,
+    gboolean voice_activity);
 };
 
 GType kms_base_rtp_endpoint_get_type (void);
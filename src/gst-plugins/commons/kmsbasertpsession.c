@@ -23,6 +23,7 @@
 #include "constants.h"
 #include "kmsutils.h"
 #include "sdp_utils.h"
+#include "kmsslaballocator.h"
 
 #include "kms-core-enumtypes.h"
 #include "kms-core-marshal.h"
@@ -40,6 +41,9 @@ G_DEFINE_QUARK (BUNDLE_CONN_ADDED, bundle_conn_added);
 #define RTCP_DEMUX_PEER "rtcp-demux-peer"
 G_DEFINE_QUARK (RTCP_DEMUX_PEER, rtcp_demux_peer);
 
+#define BUNDLE_SSRC "bundle-ssrc"
+G_DEFINE_QUARK (BUNDLE_SSRC, bundle_ssrc);
+
 struct _KmsBaseRTPSessionStats
 {
   gboolean enabled;
@@ -211,6 +215,10 @@ kms_base_rtp_session_e2e_latency_cb (GstPad * pad, KmsMediaType type,
 
     stat = (StreamE2EAvgStat *) value;
     stat->avg = KMS_STATS_CALCULATE_LATENCY_AVG (t, stat->avg);
+
+    if (t >= 0) {
+      kms_histogram_record (stat->hist, t);
+    }
   }
 }
 
@@ -303,52 +311,182 @@ kms_base_rtp_session_link_pads (GstPad * src, GstPad * sink)
   }
 }
 
+static const GstSDPMedia *
+kms_base_rtp_session_resolve_ssrc (KmsBaseRtpSession * self,
+    GstElement * ssrcdemux, guint32 ssrc, const gchar * media_str)
+{
+  if (g_strcmp0 (media_str, AUDIO_STREAM_NAME) == 0
+      || (media_str == NULL
+          && ssrcs_are_mapped (ssrcdemux, self->local_audio_ssrc, ssrc))) {
+    return self->audio_neg;
+  } else if (g_strcmp0 (media_str, VIDEO_STREAM_NAME) == 0
+      || (media_str == NULL
+          && ssrcs_are_mapped (ssrcdemux, self->local_video_ssrc, ssrc))) {
+    return self->video_neg;
+  }
+
+  return NULL;
+}
+
 static void
-rtp_ssrc_demux_new_ssrc_pad (GstElement * ssrcdemux, guint ssrc, GstPad * pad,
-    KmsBaseRtpSession * self)
+kms_base_rtp_session_link_ssrc_pad (KmsBaseRtpSession * self,
+    GstElement * ssrcdemux, GstPad * pad, const GstSDPMedia * media)
 {
-  const gchar *rtp_pad_name = GST_OBJECT_NAME (pad);
   gchar *rtcp_pad_name;
-  const GstSDPMedia *media;
   GstPad *src, *sink;
 
-  GST_DEBUG_OBJECT (self, "pad: %" GST_PTR_FORMAT " ssrc: %" G_GUINT32_FORMAT,
-      pad, ssrc);
-
-  KMS_SDP_SESSION_LOCK (self);
-
-  if (self->remote_audio_ssrc == ssrc
-      || ssrcs_are_mapped (ssrcdemux, self->local_audio_ssrc, ssrc)) {
-    media = self->audio_neg;
-  } else if (self->remote_video_ssrc == ssrc
-      || ssrcs_are_mapped (ssrcdemux, self->local_video_ssrc, ssrc)) {
-    media = self->video_neg;
-  } else {
-    if (!kms_i_rtp_session_manager_custom_ssrc_management (self->manager, self,
-            ssrcdemux, ssrc, pad)) {
-      GST_ERROR_OBJECT (pad, "SSRC %" G_GUINT32_FORMAT " not matching.", ssrc);
-    }
-    goto end;
-  }
-
   /* RTP */
   sink = kms_i_rtp_session_manager_request_rtp_sink (self->manager, self, media);
   kms_base_rtp_session_link_pads (pad, sink);
   g_object_unref (sink);
 
   /* RTCP */
-  rtcp_pad_name = g_strconcat ("rtcp_", rtp_pad_name, NULL);
+  rtcp_pad_name = g_strconcat ("rtcp_", GST_OBJECT_NAME (pad), NULL);
   src = gst_element_get_static_pad (ssrcdemux, rtcp_pad_name);
   g_free (rtcp_pad_name);
   sink = kms_i_rtp_session_manager_request_rtcp_sink (self->manager, self, media);
   kms_base_rtp_session_link_pads (src, sink);
   g_object_unref (src);
   g_object_unref (sink);
+}
+
+static void
+kms_base_rtp_session_unmatched_ssrc (KmsBaseRtpSession * self,
+    GstElement * ssrcdemux, guint32 ssrc, GstPad * pad)
+{
+  if (!kms_i_rtp_session_manager_custom_ssrc_management (self->manager, self,
+          ssrcdemux, ssrc, pad)) {
+    GST_ERROR_OBJECT (pad, "SSRC %" G_GUINT32_FORMAT " not matching.", ssrc);
+  }
+}
+
+static GstPadProbeReturn
+bundle_demux_learn_ssrc_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  KmsBaseRtpSession *self = KMS_BASE_RTP_SESSION (user_data);
+  GstPadProbeReturn ret = GST_PAD_PROBE_REMOVE;
+  GstElement *ssrcdemux;
+  const GstSDPMedia *media;
+  const gchar *media_str;
+  GstBuffer *buffer;
+  guint32 ssrc;
+
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER) {
+    buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+  } else {
+    buffer = gst_buffer_list_get (GST_PAD_PROBE_INFO_BUFFER_LIST (info), 0);
+  }
+
+  if (buffer == NULL) {
+    return GST_PAD_PROBE_OK;
+  }
+
+  ssrc = GPOINTER_TO_UINT (g_object_get_qdata (G_OBJECT (pad),
+          bundle_ssrc_quark ()));
+  ssrcdemux = gst_pad_get_parent_element (pad);
+  if (ssrcdemux == NULL) {
+    return GST_PAD_PROBE_REMOVE;
+  }
+
+  /* Looks at the header extensions unless the SSRC was given up on */
+  media_str = kms_bundle_demux_process_rtp (self->bundle_demux, buffer);
+
+  KMS_SDP_SESSION_LOCK (self);
+
+  media = kms_base_rtp_session_resolve_ssrc (self, ssrcdemux, ssrc, media_str);
+
+  if (media != NULL) {
+    GST_DEBUG_OBJECT (self, "SSRC %" G_GUINT32_FORMAT " resolved", ssrc);
+    /* The peer is checked after the probes, so this buffer already goes on */
+    kms_base_rtp_session_link_ssrc_pad (self, ssrcdemux, pad, media);
+  } else if (!kms_bundle_demux_can_learn_ssrc (self->bundle_demux, ssrc)) {
+    kms_base_rtp_session_unmatched_ssrc (self, ssrcdemux, ssrc, pad);
+  } else {
+    ret = GST_PAD_PROBE_DROP;
+  }
+
+  KMS_SDP_SESSION_UNLOCK (self);
+
+  g_object_unref (ssrcdemux);
+
+  return ret;
+}
+
+static void
+rtp_ssrc_demux_new_ssrc_pad (GstElement * ssrcdemux, guint ssrc, GstPad * pad,
+    KmsBaseRtpSession * self)
+{
+  const GstSDPMedia *media;
+
+  GST_DEBUG_OBJECT (self, "pad: %" GST_PTR_FORMAT " ssrc: %" G_GUINT32_FORMAT,
+      pad, ssrc);
+
+  KMS_SDP_SESSION_LOCK (self);
+
+  media = kms_base_rtp_session_resolve_ssrc (self, ssrcdemux, ssrc,
+      kms_bundle_demux_lookup_ssrc (self->bundle_demux, ssrc));
+
+  if (media != NULL) {
+    kms_base_rtp_session_link_ssrc_pad (self, ssrcdemux, pad, media);
+  } else if (kms_bundle_demux_can_learn_ssrc (self->bundle_demux, ssrc)) {
+    /* Only the first packets of an unknown SSRC are inspected, until their
+     * MID/RID header extensions resolve it; signalled SSRCs are never
+     * looked at per packet */
+    GST_DEBUG_OBJECT (self, "Learning SSRC %" G_GUINT32_FORMAT, ssrc);
+    g_object_set_qdata (G_OBJECT (pad), bundle_ssrc_quark (),
+        GUINT_TO_POINTER (ssrc));
+    gst_pad_add_probe (pad,
+        GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+        bundle_demux_learn_ssrc_probe, self, NULL);
+  } else {
+    kms_base_rtp_session_unmatched_ssrc (self, ssrcdemux, ssrc, pad);
+  }
 
-end:
   KMS_SDP_SESSION_UNLOCK (self);
 }
 
+static gboolean
+kms_base_rtp_session_dispatch_rtcp_list_cb (GstBuffer ** buffer, guint idx,
+    gpointer user_data)
+{
+  kms_rtcp_dispatcher_process_buffer (user_data, *buffer);
+
+  return TRUE;
+}
+
+static GstPadProbeReturn
+kms_base_rtp_session_dispatch_rtcp_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  KmsBaseRtpSession *self = KMS_BASE_RTP_SESSION (user_data);
+
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER) {
+    kms_rtcp_dispatcher_process_buffer (self->rtcp_dispatcher,
+        GST_PAD_PROBE_INFO_BUFFER (info));
+  } else if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    gst_buffer_list_foreach (GST_PAD_PROBE_INFO_BUFFER_LIST (info),
+        kms_base_rtp_session_dispatch_rtcp_list_cb, self->rtcp_dispatcher);
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+kms_base_rtp_session_add_rtcp_dispatch_probe (KmsBaseRtpSession * self,
+    GstPad * pad)
+{
+  gst_pad_add_probe (pad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      kms_base_rtp_session_dispatch_rtcp_probe, self, NULL);
+}
+
+static void
+bundle_demux_learn_rtcp_cb (const KmsRTCPPacketView * view, gpointer user_data)
+{
+  kms_bundle_demux_process_rtcp_packet (user_data, view->packet);
+}
+
 static void
 kms_base_rtp_session_add_gst_bundle_elements (KmsBaseRtpSession * self,
     KmsIRtpConnection * conn, const GstSDPMedia * media, gboolean active)
@@ -385,6 +523,7 @@ kms_base_rtp_session_add_gst_bundle_elements (KmsBaseRtpSession * self,
 
   /* RTP */
   src = kms_i_rtp_connection_request_rtp_src (conn);
+  kms_slab_allocator_propose_on_pad (src);
   sink = gst_element_get_static_pad (ssrcdemux, "sink");
   kms_base_rtp_session_link_pads (src, sink);
   g_object_unref (src);
@@ -393,6 +532,7 @@ kms_base_rtp_session_add_gst_bundle_elements (KmsBaseRtpSession * self,
   /* RTCP */
   src = kms_i_rtp_connection_request_rtcp_src (conn);
   sink = gst_element_get_static_pad (rtcpdemux, "sink");
+  kms_base_rtp_session_add_rtcp_dispatch_probe (self, sink);
   kms_base_rtp_session_link_pads (src, sink);
   g_object_unref (src);
   g_object_unref (sink);
@@ -433,6 +573,7 @@ kms_base_rtp_session_link_gst_connection_src (KmsBaseRtpSession * self,
 
   /* RTP */
   src = kms_i_rtp_connection_request_rtp_src (conn);
+  kms_slab_allocator_propose_on_pad (src);
   sink = kms_i_rtp_session_manager_request_rtp_sink (self->manager, self, media);
   kms_base_rtp_session_link_pads (src, sink);
   g_object_unref (src);
@@ -441,6 +582,7 @@ kms_base_rtp_session_link_gst_connection_src (KmsBaseRtpSession * self,
   /* RTCP */
   src = kms_i_rtp_connection_request_rtcp_src (conn);
   sink = kms_i_rtp_session_manager_request_rtcp_sink (self->manager, self, media);
+  kms_base_rtp_session_add_rtcp_dispatch_probe (self, src);
   kms_base_rtp_session_link_pads (src, sink);
   g_object_unref (src);
   g_object_unref (sink);
@@ -460,6 +602,7 @@ kms_base_rtp_session_add_gst_rtcp_mux_elements (KmsBaseRtpSession * self,
 
   /* RTP */
   src = kms_i_rtp_connection_request_rtp_src (conn);
+  kms_slab_allocator_propose_on_pad (src);
   sink = kms_i_rtp_session_manager_request_rtp_sink (self->manager, self, media);
   kms_base_rtp_session_link_pads (src, sink);
   g_object_unref (src);
@@ -473,6 +616,7 @@ kms_base_rtp_session_add_gst_rtcp_mux_elements (KmsBaseRtpSession * self,
 
   src = kms_i_rtp_connection_request_rtcp_src (conn);
   sink = gst_element_get_static_pad (rtcpdemux, "sink");
+  kms_base_rtp_session_add_rtcp_dispatch_probe (self, sink);
   kms_base_rtp_session_link_pads (src, sink);
   g_object_unref (src);
   g_object_unref (sink);
@@ -528,6 +672,18 @@ kms_base_rtp_session_add_gst_connection_elements (KmsBaseRtpSession * self,
   return TRUE;
 }
 
+static void
+kms_base_rtp_session_add_bundle_media (KmsBaseRtpSession * self,
+    const GstSDPMedia * remote_media, guint32 remote_ssrc, guint32 local_ssrc,
+    const gchar * media_str)
+{
+  gpointer data = (gpointer) media_str;
+
+  kms_bundle_demux_add_media (self->bundle_demux, remote_media, data);
+  kms_bundle_demux_add_ssrc (self->bundle_demux, remote_ssrc, data);
+  kms_bundle_demux_add_local_ssrc (self->bundle_demux, local_ssrc, data);
+}
+
 static const gchar *
 kms_base_rtp_session_process_remote_ssrc (KmsBaseRtpSession * self,
     const GstSDPMedia * remote_media, const GstSDPMedia * neg_media)
@@ -543,6 +699,8 @@ kms_base_rtp_session_process_remote_ssrc (KmsBaseRtpSession * self,
   if (g_strcmp0 (AUDIO_STREAM_NAME, media_str) == 0) {
     GST_DEBUG_OBJECT (self, "Add remote audio ssrc: %u", ssrc);
     self->remote_audio_ssrc = ssrc;
+    kms_base_rtp_session_add_bundle_media (self, remote_media, ssrc,
+        self->local_audio_ssrc, AUDIO_STREAM_NAME);
     if (self->audio_neg != NULL) {
       gst_sdp_media_free (self->audio_neg);
     }
@@ -552,6 +710,8 @@ kms_base_rtp_session_process_remote_ssrc (KmsBaseRtpSession * self,
   } else if (g_strcmp0 (VIDEO_STREAM_NAME, media_str) == 0) {
     GST_DEBUG_OBJECT (self, "Add remote video ssrc: %u", ssrc);
     self->remote_video_ssrc = ssrc;
+    kms_base_rtp_session_add_bundle_media (self, remote_media, ssrc,
+        self->local_video_ssrc, VIDEO_STREAM_NAME);
     if (self->video_neg != NULL) {
       gst_sdp_media_free (self->video_neg);
     }
@@ -790,6 +950,8 @@ kms_base_rtp_session_finalize (GObject * object)
   }
 
   g_hash_table_destroy (self->conns);
+  kms_rtcp_dispatcher_destroy (self->rtcp_dispatcher);
+  kms_bundle_demux_destroy (self->bundle_demux);
 
   /* chain up */
   G_OBJECT_CLASS (kms_base_rtp_session_parent_class)->finalize (object);
@@ -811,6 +973,11 @@ kms_base_rtp_session_init (KmsBaseRtpSession * self)
 {
   self->conns =
       g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+  self->bundle_demux = kms_bundle_demux_new ();
+  self->rtcp_dispatcher = kms_rtcp_dispatcher_new ();
+  kms_rtcp_dispatcher_add_consumer (self->rtcp_dispatcher,
+      KMS_RTCP_PACKET_VIEW_SR | KMS_RTCP_PACKET_VIEW_RR,
+      bundle_demux_learn_rtcp_cb, self->bundle_demux, NULL);
 
   self->stats_enabled = FALSE;
 }
@@ -23,6 +23,8 @@
 #include "kmsirtpsessionmanager.h"
 #include "kmsirtpconnection.h"
 #include "kmsconnectionstate.h"
+#include "kmsbundledemux.h"
+#include "kmsrtcp.h"
 
 G_BEGIN_DECLS
 
@@ -61,6 +63,9 @@ struct _KmsBaseRtpSession
   guint32 local_video_ssrc;
   guint32 remote_video_ssrc;
 
+  KmsBundleDemux *bundle_demux;
+  KmsRTCPDispatcher *rtcp_dispatcher;
+
   gboolean stats_enabled;
 };
 
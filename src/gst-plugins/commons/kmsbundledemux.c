@@ -0,0 +1,390 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "kmsbundledemux.h"
+#include "kmsrtphdrext.h"
+#include <gst/rtp/gstrtpbuffer.h>
+#include <gst/rtp/gstrtcpbuffer.h>
+
+#define GST_DEFAULT_NAME "kmsbundledemux"
+#define GST_CAT_DEFAULT kms_bundle_demux_debug
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+
+#define RTP_SSRC_OFFSET 8
+#define RTP_MIN_HEADER_LEN 12
+
+/* Packets of an unknown SSRC looked at for a MID/RID before giving up on it */
+#define MAX_LEARN_ATTEMPTS 32
+
+#define KMS_BUNDLE_DEMUX_LOCK(demux) (g_mutex_lock (&(demux)->mutex))
+#define KMS_BUNDLE_DEMUX_UNLOCK(demux) (g_mutex_unlock (&(demux)->mutex))
+
+struct _KmsBundleDemux
+{
+  GMutex mutex;
+
+  GHashTable *ssrcs;            /* guint32 -> data */
+  GHashTable *local_ssrcs;      /* guint32 -> data */
+  GHashTable *mids;             /* gchar* -> data */
+  GHashTable *rids;             /* gchar* -> data */
+  GHashTable *unresolved;       /* guint32 -> failed attempts */
+
+  KmsRtpHdrExtMap *hdr_exts;
+};
+
+static void
+init_debug (void)
+{
+  static gsize init = 0;
+
+  if (g_once_init_enter (&init)) {
+    GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, GST_DEFAULT_NAME, 0,
+        GST_DEFAULT_NAME);
+    g_once_init_leave (&init, 1);
+  }
+}
+
+KmsBundleDemux *
+kms_bundle_demux_new (void)
+{
+  KmsBundleDemux *self;
+
+  init_debug ();
+
+  self = g_slice_new0 (KmsBundleDemux);
+  g_mutex_init (&self->mutex);
+  self->ssrcs = g_hash_table_new (g_direct_hash, g_direct_equal);
+  self->local_ssrcs = g_hash_table_new (g_direct_hash, g_direct_equal);
+  self->mids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  self->rids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  self->unresolved = g_hash_table_new (g_direct_hash, g_direct_equal);
+  self->hdr_exts = kms_rtp_hdr_ext_map_new ();
+
+  return self;
+}
+
+void
+kms_bundle_demux_destroy (KmsBundleDemux * self)
+{
+  g_hash_table_destroy (self->ssrcs);
+  g_hash_table_destroy (self->local_ssrcs);
+  g_hash_table_destroy (self->mids);
+  g_hash_table_destroy (self->rids);
+  g_hash_table_destroy (self->unresolved);
+  kms_rtp_hdr_ext_map_free (self->hdr_exts);
+  g_mutex_clear (&self->mutex);
+
+  g_slice_free (KmsBundleDemux, self);
+}
+
+static void
+kms_bundle_demux_add_ssrc_str (KmsBundleDemux * self, const gchar * str,
+    gpointer data)
+{
+  gchar *end;
+  guint64 ssrc;
+
+  ssrc = g_ascii_strtoull (str, &end, 10);
+  if (end == str || ssrc > G_MAXUINT32) {
+    GST_WARNING ("Invalid ssrc '%s'", str);
+    return;
+  }
+
+  g_hash_table_insert (self->ssrcs, GUINT_TO_POINTER ((guint32) ssrc), data);
+}
+
+void
+kms_bundle_demux_add_media (KmsBundleDemux * self,
+    const GstSDPMedia * remote_media, gpointer data)
+{
+  guint i, len;
+
+  KMS_BUNDLE_DEMUX_LOCK (self);
+
+  len = gst_sdp_media_attributes_len (remote_media);
+
+  for (i = 0; i < len; i++) {
+    const GstSDPAttribute *attr;
+
+    attr = gst_sdp_media_get_attribute (remote_media, i);
+    if (attr->value == NULL) {
+      continue;
+    }
+
+    if (g_strcmp0 (attr->key, "ssrc") == 0) {
+      /* "<ssrc> <attribute>[:<value>]" */
+      kms_bundle_demux_add_ssrc_str (self, attr->value, data);
+    } else if (g_strcmp0 (attr->key, "ssrc-group") == 0) {
+      /* "<semantics> <ssrc> ..." covers FID, FEC and SIM groups */
+      gchar **tokens = g_strsplit (attr->value, " ", 0);
+      guint t;
+
+      for (t = 1; tokens[t] != NULL; t++) {
+        kms_bundle_demux_add_ssrc_str (self, tokens[t], data);
+      }
+
+      g_strfreev (tokens);
+    } else if (g_strcmp0 (attr->key, "mid") == 0) {
+      g_hash_table_insert (self->mids, g_strdup (attr->value), data);
+    } else if (g_strcmp0 (attr->key, "rid") == 0) {
+      /* "<rid> <direction> ..." */
+      gchar **tokens = g_strsplit (attr->value, " ", 2);
+
+      g_hash_table_insert (self->rids, g_strdup (tokens[0]), data);
+      g_strfreev (tokens);
+    }
+  }
+
+  kms_rtp_hdr_ext_map_add_from_sdp_media (self->hdr_exts, remote_media);
+
+  /* New MIDs, RIDs or extension ids may resolve what was given up on */
+  g_hash_table_remove_all (self->unresolved);
+
+  KMS_BUNDLE_DEMUX_UNLOCK (self);
+}
+
+void
+kms_bundle_demux_add_ssrc (KmsBundleDemux * self, guint32 ssrc, gpointer data)
+{
+  if (ssrc == 0) {
+    return;
+  }
+
+  KMS_BUNDLE_DEMUX_LOCK (self);
+  g_hash_table_insert (self->ssrcs, GUINT_TO_POINTER (ssrc), data);
+  g_hash_table_remove (self->unresolved, GUINT_TO_POINTER (ssrc));
+  KMS_BUNDLE_DEMUX_UNLOCK (self);
+}
+
+void
+kms_bundle_demux_add_local_ssrc (KmsBundleDemux * self, guint32 ssrc,
+    gpointer data)
+{
+  if (ssrc == 0) {
+    return;
+  }
+
+  KMS_BUNDLE_DEMUX_LOCK (self);
+  g_hash_table_insert (self->local_ssrcs, GUINT_TO_POINTER (ssrc), data);
+  KMS_BUNDLE_DEMUX_UNLOCK (self);
+}
+
+gpointer
+kms_bundle_demux_lookup_ssrc (KmsBundleDemux * self, guint32 ssrc)
+{
+  gpointer data;
+
+  KMS_BUNDLE_DEMUX_LOCK (self);
+  data = g_hash_table_lookup (self->ssrcs, GUINT_TO_POINTER (ssrc));
+  KMS_BUNDLE_DEMUX_UNLOCK (self);
+
+  return data;
+}
+
+static gpointer
+kms_bundle_demux_lookup_sdes (GHashTable * table, const gchar * value,
+    guint len)
+{
+  gchar *key;
+  gpointer data;
+
+  key = g_strndup (value, len);
+  data = g_hash_table_lookup (table, key);
+  g_free (key);
+
+  return data;
+}
+
+static gpointer
+kms_bundle_demux_learn_ssrc (KmsBundleDemux * self, GstBuffer * buffer,
+    guint32 ssrc)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  KmsRtpHdrExtValues values;
+  gpointer data = NULL;
+  guint attempts;
+
+  attempts = GPOINTER_TO_UINT (g_hash_table_lookup (self->unresolved,
+          GUINT_TO_POINTER (ssrc)));
+  if (attempts >= MAX_LEARN_ATTEMPTS) {
+    /* Do not map every packet of a stream that cannot be resolved */
+    return NULL;
+  }
+
+  if (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp)) {
+    return NULL;
+  }
+
+  if (!kms_rtp_hdr_ext_map_parse (self->hdr_exts, &rtp, &values)) {
+    goto end;
+  }
+
+  if (values.present & KMS_RTP_HDR_EXT_FLAG (KMS_RTP_HDR_EXT_MID)) {
+    data = kms_bundle_demux_lookup_sdes (self->mids, values.mid,
+        values.mid_len);
+  }
+
+  if (data == NULL
+      && (values.present & KMS_RTP_HDR_EXT_FLAG (KMS_RTP_HDR_EXT_RID))) {
+    data = kms_bundle_demux_lookup_sdes (self->rids, values.rid,
+        values.rid_len);
+  }
+
+  if (data == NULL
+      && (values.present & KMS_RTP_HDR_EXT_FLAG (KMS_RTP_HDR_EXT_REPAIRED_RID))) {
+    data = kms_bundle_demux_lookup_sdes (self->rids, values.repaired_rid,
+        values.repaired_rid_len);
+  }
+
+  if (data != NULL) {
+    GST_DEBUG ("Learnt ssrc %" G_GUINT32_FORMAT " from header extension",
+        ssrc);
+    g_hash_table_insert (self->ssrcs, GUINT_TO_POINTER (ssrc), data);
+  }
+
+end:
+  gst_rtp_buffer_unmap (&rtp);
+
+  if (data != NULL) {
+    g_hash_table_remove (self->unresolved, GUINT_TO_POINTER (ssrc));
+  } else {
+    g_hash_table_insert (self->unresolved, GUINT_TO_POINTER (ssrc),
+        GUINT_TO_POINTER (attempts + 1));
+  }
+
+  return data;
+}
+
+gboolean
+kms_bundle_demux_can_learn_ssrc (KmsBundleDemux * self, guint32 ssrc)
+{
+  guint attempts;
+
+  KMS_BUNDLE_DEMUX_LOCK (self);
+  attempts = GPOINTER_TO_UINT (g_hash_table_lookup (self->unresolved,
+          GUINT_TO_POINTER (ssrc)));
+  KMS_BUNDLE_DEMUX_UNLOCK (self);
+
+  return attempts < MAX_LEARN_ATTEMPTS;
+}
+
+gpointer
+kms_bundle_demux_process_rtp (KmsBundleDemux * self, GstBuffer * buffer)
+{
+  guint8 header[RTP_MIN_HEADER_LEN];
+  gpointer data;
+  guint32 ssrc;
+
+  /* Only the fixed header is needed in the common path */
+  if (gst_buffer_extract (buffer, 0, header, sizeof (header)) <
+      sizeof (header)) {
+    return NULL;
+  }
+
+  ssrc = GST_READ_UINT32_BE (header + RTP_SSRC_OFFSET);
+
+  KMS_BUNDLE_DEMUX_LOCK (self);
+
+  data = g_hash_table_lookup (self->ssrcs, GUINT_TO_POINTER (ssrc));
+  if (data == NULL) {
+    data = kms_bundle_demux_learn_ssrc (self, buffer, ssrc);
+  }
+
+  KMS_BUNDLE_DEMUX_UNLOCK (self);
+
+  return data;
+}
+
+static void
+kms_bundle_demux_learn_from_rtcp (KmsBundleDemux * self,
+    GstRTCPPacket * packet)
+{
+  guint32 sender_ssrc;
+  guint i, count;
+
+  switch (gst_rtcp_packet_get_type (packet)) {
+    case GST_RTCP_TYPE_SR:
+      gst_rtcp_packet_sr_get_sender_info (packet, &sender_ssrc, NULL, NULL,
+          NULL, NULL);
+      break;
+    case GST_RTCP_TYPE_RR:
+      sender_ssrc = gst_rtcp_packet_rr_get_ssrc (packet);
+      break;
+    default:
+      return;
+  }
+
+  if (g_hash_table_contains (self->ssrcs, GUINT_TO_POINTER (sender_ssrc))) {
+    return;
+  }
+
+  /* Receive-only streams are only known by the local SSRC they report on */
+  count = gst_rtcp_packet_get_rb_count (packet);
+  for (i = 0; i < count; i++) {
+    guint32 ssrc;
+    gpointer data;
+
+    gst_rtcp_packet_get_rb (packet, i, &ssrc, NULL, NULL, NULL, NULL, NULL,
+        NULL);
+
+    data = g_hash_table_lookup (self->local_ssrcs, GUINT_TO_POINTER (ssrc));
+    if (data != NULL) {
+      GST_DEBUG ("Learnt ssrc %" G_GUINT32_FORMAT " from report on %"
+          G_GUINT32_FORMAT, sender_ssrc, ssrc);
+      g_hash_table_insert (self->ssrcs, GUINT_TO_POINTER (sender_ssrc), data);
+      g_hash_table_remove (self->unresolved, GUINT_TO_POINTER (sender_ssrc));
+      return;
+    }
+  }
+}
+
+void
+kms_bundle_demux_process_rtcp_packet (KmsBundleDemux * self,
+    GstRTCPPacket * packet)
+{
+  KMS_BUNDLE_DEMUX_LOCK (self);
+  kms_bundle_demux_learn_from_rtcp (self, packet);
+  KMS_BUNDLE_DEMUX_UNLOCK (self);
+}
+
+void
+kms_bundle_demux_process_rtcp (KmsBundleDemux * self, GstBuffer * buffer)
+{
+  GstRTCPBuffer rtcp = GST_RTCP_BUFFER_INIT;
+  GstRTCPPacket packet;
+  gboolean more;
+
+  if (!gst_rtcp_buffer_map (buffer, GST_MAP_READ, &rtcp)) {
+    return;
+  }
+
+  KMS_BUNDLE_DEMUX_LOCK (self);
+
+  /* Single pass over the compound packet */
+  for (more = gst_rtcp_buffer_get_first_packet (&rtcp, &packet); more;
+      more = gst_rtcp_packet_move_to_next (&packet)) {
+    kms_bundle_demux_learn_from_rtcp (self, &packet);
+  }
+
+  KMS_BUNDLE_DEMUX_UNLOCK (self);
+
+  gst_rtcp_buffer_unmap (&rtcp);
+}
@@ -0,0 +1,53 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __KMS_BUNDLE_DEMUX_H__
+#define __KMS_BUNDLE_DEMUX_H__
+
+#include <gst/gst.h>
+#include <gst/sdp/gstsdpmessage.h>
+#include <gst/rtp/gstrtcpbuffer.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Maps the streams of a bundled transport to the media they belong to.
+ * SSRCs are taken from the remote SDP (including RTX, FEC and simulcast
+ * groups) and learnt on the fly from the MID/RID header extensions and from
+ * RTCP report blocks. Only the first packets of a stream are looked at: once
+ * resolved, or given up on, it is routed without touching the table again.
+ */
+typedef struct _KmsBundleDemux KmsBundleDemux;
+
+KmsBundleDemux * kms_bundle_demux_new (void);
+void kms_bundle_demux_destroy (KmsBundleDemux * self);
+
+void kms_bundle_demux_add_media (KmsBundleDemux * self, const GstSDPMedia * remote_media, gpointer data);
+void kms_bundle_demux_add_ssrc (KmsBundleDemux * self, guint32 ssrc, gpointer data);
+void kms_bundle_demux_add_local_ssrc (KmsBundleDemux * self, guint32 ssrc, gpointer data);
+
+gpointer kms_bundle_demux_lookup_ssrc (KmsBundleDemux * self, guint32 ssrc);
+/* FALSE once enough packets of an unknown SSRC were seen without a MID/RID
+ * that resolves it. New remote media gives every SSRC another chance */
+gboolean kms_bundle_demux_can_learn_ssrc (KmsBundleDemux * self, guint32 ssrc);
+gpointer kms_bundle_demux_process_rtp (KmsBundleDemux * self, GstBuffer * buffer);
+void kms_bundle_demux_process_rtcp (KmsBundleDemux * self, GstBuffer * buffer);
+void kms_bundle_demux_process_rtcp_packet (KmsBundleDemux * self, GstRTCPPacket * packet);
+
+G_END_DECLS
+
+#endif /* __KMS_BUNDLE_DEMUX_H__ */
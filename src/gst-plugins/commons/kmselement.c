@@ -25,6 +25,7 @@
 #include "kmselement.h"
 #include "kmsagnosticcaps.h"
 #include "kmsstats.h"
+#include "kmshistogram.h"
 #include "kmsutils.h"
 #include "kmsrefstruct.h"
 #include "constants.h"
@@ -86,6 +87,7 @@ typedef struct _StreamInputAvgStat
   KmsRefStruct ref;
   KmsMediaType type;
   gdouble avg;
+  KmsHistogram *hist;
 } StreamInputAvgStat;
 
 typedef struct _PendingPad
@@ -168,6 +170,7 @@ enum
 {
   /* Actions */
   REQUEST_NEW_SRCPAD,
+  REQUEST_NEW_SRCPADS,
   RELEASE_REQUESTED_SRCPAD,
   STATS,
   SIGNAL_FLOW_OUT_MEDIA,
@@ -318,6 +321,7 @@ media_flow_timeout_data_ref (KmsMediaFlowTimeoutData * data)
 static void
 stream_input_avg_stat_destroy (StreamInputAvgStat * stat)
 {
+  kms_histogram_free (stat->hist);
   g_slice_free (StreamInputAvgStat, stat);
 }
 
@@ -330,6 +334,7 @@ stream_input_avg_stat_new (KmsMediaType type)
   kms_ref_struct_init (KMS_REF_STRUCT_CAST (stat),
       (GDestroyNotify) stream_input_avg_stat_destroy);
   stat->type = type;
+  stat->hist = kms_histogram_new ();
 
   return stat;
 }
@@ -555,33 +560,56 @@ kms_element_get_data_output_element (KmsElement * self,
       description);
 }
 
+static void
+kms_element_emit_media_flow (KmsElement * self, KmsMediaFlowData * data,
+    gboolean flowing)
+{
+  guint signal_id;
+
+  if (data->media_flow_type == KMS_MEDIA_FLOW_IN) {
+    signal_id = element_signals[SIGNAL_FLOW_IN_MEDIA];
+  } else if (data->media_flow_type == KMS_MEDIA_FLOW_OUT) {
+    signal_id = element_signals[SIGNAL_FLOW_OUT_MEDIA];
+  } else {
+    return;
+  }
+
+  /* Nobody is listening, avoid marshalling the signal */
+  if (!g_signal_has_handler_pending (self, signal_id, 0, FALSE)) {
+    return;
+  }
+
+  g_signal_emit (G_OBJECT (self), signal_id, 0, flowing,
+      data->pad_description, data->type);
+}
+
 static GstPadProbeReturn
 cb_buffer_received (GstPad * pad, GstPadProbeInfo * info, gpointer data)
 {
   KmsMediaFlowTimeoutData *fdto_data = (KmsMediaFlowTimeoutData *) data;
   KmsMediaFlowData *fd_data = fdto_data->media_flow_data;
-  gpointer weak_ptr = g_weak_ref_get (&fd_data->element);
+  gpointer weak_ptr;
   KmsElement *element;
 
+  if (g_atomic_int_get (&fd_data->buffers) == 0) {
+    g_atomic_int_set (&fd_data->buffers, 1);
+  }
+
+  /* Fast path: media is already known to be flowing */
+  if (g_atomic_int_get (&fd_data->media_flowing) == 1) {
+    return GST_PAD_PROBE_OK;
+  }
+
+  weak_ptr = g_weak_ref_get (&fd_data->element);
   if (weak_ptr == NULL) {
     return FALSE;
   }
 
   element = KMS_ELEMENT (weak_ptr);
   if (g_atomic_int_compare_and_exchange (&fd_data->media_flowing, 0, 1)) {
-    if (fd_data->media_flow_type == KMS_MEDIA_FLOW_IN) {
-      g_signal_emit (G_OBJECT (element),
-          element_signals[SIGNAL_FLOW_IN_MEDIA], 0, TRUE,
-          fd_data->pad_description, fd_data->type);
-    } else if (fd_data->media_flow_type == KMS_MEDIA_FLOW_OUT) {
-      g_signal_emit (G_OBJECT (element),
-          element_signals[SIGNAL_FLOW_OUT_MEDIA], 0, TRUE,
-          fd_data->pad_description, fd_data->type);
-    }
+    kms_element_emit_media_flow (element, fd_data, TRUE);
   }
 
-  g_atomic_int_compare_and_exchange (&fd_data->buffers, 0, 1);
-
   g_object_unref (element);
 
   return GST_PAD_PROBE_OK;
@@ -607,15 +635,7 @@ check_if_flow_media (gpointer user_data)
   if (g_atomic_int_get (&data->media_flowing) == 1) {
     if (g_atomic_int_get (&data->buffers) == 0) {
       g_atomic_int_set (&data->media_flowing, 0);
-      if (data->media_flow_type == KMS_MEDIA_FLOW_IN) {
-        g_signal_emit (G_OBJECT (element),
-            element_signals[SIGNAL_FLOW_IN_MEDIA], 0, FALSE,
-            data->pad_description, data->type);
-      } else if (data->media_flow_type == KMS_MEDIA_FLOW_OUT) {
-        g_signal_emit (G_OBJECT (element),
-            element_signals[SIGNAL_FLOW_OUT_MEDIA], 0, FALSE,
-            data->pad_description, data->type);
-      }
+      kms_element_emit_media_flow (element, data, FALSE);
     } else {
       g_atomic_int_set (&data->buffers, 0);
     }
@@ -906,6 +926,10 @@ kms_element_calculate_stats (GstPad * pad, KmsMediaType type,
   }
 
   sstat->avg = KMS_STATS_CALCULATE_LATENCY_AVG (t, sstat->avg);
+
+  if (t >= 0) {
+    kms_histogram_record (sstat->hist, t);
+  }
 }
 
 static void
@@ -1449,6 +1473,88 @@ kms_element_request_new_srcpad (KmsElement * self,
   return pad_name;
 }
 
+static gchar **
+kms_element_request_new_srcpads_action (KmsElement * self,
+    KmsElementPadType type, const gchar * description, guint count)
+{
+  const gchar *templ_name, *desc;
+  KmsOutputElementData *odata;
+  GstElement *element = NULL;
+  gchar **pad_names, *key;
+  guint i, first_added = count;
+
+  if (count == 0) {
+    return NULL;
+  }
+
+  desc = KMS_FORMAT_PAD_DESCRIPTION (description);
+
+  KMS_ELEMENT_LOCK (self);
+
+  templ_name = get_pad_template_from_pad_type (type);
+  if (templ_name == NULL) {
+    KMS_ELEMENT_UNLOCK (self);
+    return NULL;
+  }
+
+  key = create_id_from_pad_attrs (type, GST_PAD_SRC, desc);
+  odata = g_hash_table_lookup (self->priv->output_elements, key);
+
+  if (odata == NULL) {
+    GST_DEBUG_OBJECT (self, "New output element for track %s, stream %s",
+        kms_element_pad_type_str (type), desc);
+    odata = create_output_element_data (type);
+    g_hash_table_insert (self->priv->output_elements, key, odata);
+  } else {
+    g_free (key);
+  }
+
+  pad_names = g_new0 (gchar *, count + 1);
+
+  /* All the names are reserved under one lock; pads are added afterwards */
+  for (i = 0; i < count; i++) {
+    gchar *pad_name = g_strdup_printf (templ_name, desc, odata->pad_count++);
+
+    if (odata->element == NULL) {
+      KmsRequestNewSrcElementReturn ret =
+          KMS_ELEMENT_GET_CLASS (self)->request_new_src_element (self, type,
+          desc, pad_name);
+
+      if (ret == KMS_REQUEST_NEW_SRC_ELEMENT_NOT_SUPPORTED) {
+        GST_WARNING_OBJECT (self, "source pad '%s' forbidden", pad_name);
+        odata->pad_count--;
+        g_free (pad_name);
+        break;
+      }
+    }
+
+    if (odata->element == NULL) {
+      if (!g_hash_table_contains (self->priv->pendingpads, pad_name)) {
+        g_hash_table_insert (self->priv->pendingpads, g_strdup (pad_name),
+            create_pending_pad (type, GST_PAD_SRC, desc));
+      }
+    } else if (first_added == count) {
+      first_added = i;
+      element = odata->element;
+    }
+
+    pad_names[i] = pad_name;
+  }
+
+  KMS_ELEMENT_UNLOCK (self);
+
+  if (pad_names[0] == NULL) {
+    g_free (pad_names);
+    return NULL;
+  }
+
+  for (i = first_added; i < count && pad_names[i] != NULL; i++) {
+    kms_element_add_src_pad (self, element, pad_names[i], templ_name);
+  }
+
+  return pad_names;
+}
+
 static KmsRequestNewSrcElementReturn
 kms_element_request_new_src_element_default (KmsElement * self,
     KmsElementPadType type, const gchar * description, const gchar * name)
@@ -1657,6 +1763,7 @@ kms_element_get_input_latency_stats (KmsElement * self, gchar * selector)
         (avg->type ==
             KMS_MEDIA_TYPE_AUDIO) ? AUDIO_STREAM_NAME : VIDEO_STREAM_NAME,
         "avg", G_TYPE_UINT64, (guint64) avg->avg, NULL);
+    kms_stats_set_latency_percentiles (pad_latency, avg->hist);
 
     gst_structure_set (stats, padname, GST_TYPE_STRUCTURE, pad_latency, NULL);
     gst_structure_free (pad_latency);
@@ -1670,26 +1777,38 @@ kms_element_get_input_latency_stats (KmsElement * self, gchar * selector)
 static GstStructure *
 kms_element_stats_impl (KmsElement * self, gchar * selector)
 {
-  GstStructure *stats;
+  GstStructure *stats, *e_stats, *p_stats;
 
   stats = gst_structure_new_empty ("stats");
 
+  /* Only filled in when the kmslatency tracer is running */
+  p_stats = kms_processing_latency_get_stats (GST_ELEMENT (self));
+
+  if (!self->priv->stats_enabled && p_stats == NULL) {
+    return stats;
+  }
+
+  e_stats = gst_structure_new_empty (KMS_ELEMENT_STATS_STRUCT_NAME);
+
   if (self->priv->stats_enabled) {
-    GstStructure *e_stats;
     GstStructure *l_stats;
 
     l_stats = kms_element_get_input_latency_stats (self, selector);
-
-    e_stats = gst_structure_new (KMS_ELEMENT_STATS_STRUCT_NAME,
-        "input-latencies", GST_TYPE_STRUCTURE, l_stats, NULL);
+    gst_structure_set (e_stats, "input-latencies", GST_TYPE_STRUCTURE,
+        l_stats, NULL);
     gst_structure_free (l_stats);
+  }
 
-    gst_structure_set (stats, KMS_MEDIA_ELEMENT_FIELD, GST_TYPE_STRUCTURE,
-        e_stats, NULL);
-
-    gst_structure_free (e_stats);
+  if (p_stats != NULL) {
+    gst_structure_set (e_stats, "processing-latency", GST_TYPE_STRUCTURE,
+        p_stats, NULL);
+    gst_structure_free (p_stats);
   }
 
+  gst_structure_set (stats, KMS_MEDIA_ELEMENT_FIELD, GST_TYPE_STRUCTURE,
+      e_stats, NULL);
+  gst_structure_free (e_stats);
+
   return stats;
 }
 
@@ -1878,6 +1997,14 @@ kms_element_class_init (KmsElementClass * klass)
       __kms_core_marshal_STRING__ENUM_STRING_UINT,
       G_TYPE_STRING, 3, KMS_TYPE_ELEMENT_PAD_TYPE, G_TYPE_STRING, G_TYPE_UINT);
 
+  element_signals[REQUEST_NEW_SRCPADS] =
+      g_signal_new ("request-new-pads",
+      G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST,
+      G_STRUCT_OFFSET (KmsElementClass, request_new_pads), NULL, NULL,
+      __kms_core_marshal_BOXED__ENUM_STRING_UINT,
+      G_TYPE_STRV, 3, KMS_TYPE_ELEMENT_PAD_TYPE, G_TYPE_STRING, G_TYPE_UINT);
+
   element_signals[RELEASE_REQUESTED_SRCPAD] =
       g_signal_new ("release-requested-pad",
       G_TYPE_FROM_CLASS (klass),
@@ -1910,6 +2037,8 @@ kms_element_class_init (KmsElementClass * klass)
 
   klass->request_new_pad =
       GST_DEBUG_FUNCPTR (kms_element_request_new_pad_action);
+  klass->request_new_pads =
+      GST_DEBUG_FUNCPTR (kms_element_request_new_srcpads_action);
   klass->release_requested_pad =
       GST_DEBUG_FUNCPTR (kms_element_release_requested_pad_action);
   klass->stats = GST_DEBUG_FUNCPTR (kms_element_stats_impl);
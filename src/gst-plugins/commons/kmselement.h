@@ -80,6 +80,7 @@ struct _KmsElementClass
 
   /* actions */
   gchar * (*request_new_pad) (KmsElement *self, KmsElementPadType type, const gchar *desc, GstPadDirection dir);
+  gchar ** (*request_new_pads) (KmsElement *self, KmsElementPadType type, const gchar *desc, guint count);
   gboolean (*release_requested_pad) (KmsElement *self, const gchar *pad_name);
   GstStructure * (*stats) (KmsElement * self, gchar * selector);
 
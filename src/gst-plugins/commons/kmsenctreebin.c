@@ -29,6 +29,9 @@ GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
 #define kms_enc_tree_bin_parent_class parent_class
 G_DEFINE_TYPE (KmsEncTreeBin, kms_enc_tree_bin, KMS_TYPE_TREE_BIN);
 
+/* Encoders alive in the process */
+static volatile gint active_count = 0;
+
 #define KMS_ENC_TREE_BIN_GET_PRIVATE(obj) ( \
   G_TYPE_INSTANCE_GET_PRIVATE (             \
     (obj),                                  \
@@ -563,6 +566,8 @@ kms_enc_tree_bin_init (KmsEncTreeBin * self)
 
   self->priv->max_bitrate = G_MAXINT;
   self->priv->min_bitrate = 0;
+
+  g_atomic_int_inc (&active_count);
 }
 
 static void
@@ -581,6 +586,15 @@ kms_enc_tree_bin_dispose (GObject * object)
   G_OBJECT_CLASS (kms_enc_tree_bin_parent_class)->dispose (object);
 }
 
+static void
+kms_enc_tree_bin_finalize (GObject * object)
+{
+  g_atomic_int_add (&active_count, -1);
+
+  /* chain up */
+  G_OBJECT_CLASS (kms_enc_tree_bin_parent_class)->finalize (object);
+}
+
 static void
 kms_enc_tree_bin_class_init (KmsEncTreeBinClass * klass)
 {
@@ -597,6 +611,13 @@ kms_enc_tree_bin_class_init (KmsEncTreeBinClass * klass)
       GST_DEFAULT_NAME);
 
   gobject_class->dispose = kms_enc_tree_bin_dispose;
+  gobject_class->finalize = kms_enc_tree_bin_finalize;
 
   g_type_class_add_private (klass, sizeof (KmsEncTreeBinPrivate));
 }
+
+gint
+kms_enc_tree_bin_get_active_count (void)
+{
+  return g_atomic_int_get (&active_count);
+}
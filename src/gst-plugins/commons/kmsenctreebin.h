@@ -57,5 +57,8 @@ void kms_enc_tree_bin_set_bitrate_limits (KmsEncTreeBin *self, gint min_bitrate,
 gint kms_enc_tree_bin_get_min_bitrate (KmsEncTreeBin *self);
 gint kms_enc_tree_bin_get_max_bitrate (KmsEncTreeBin *self);
 
+/* Number of encoder bins currently alive in the process */
+gint kms_enc_tree_bin_get_active_count (void);
+
 G_END_DECLS
 #endif /* __KMS_ENC_TREE_BIN_H__ */
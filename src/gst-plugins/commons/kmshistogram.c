@@ -0,0 +1,416 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <string.h>
+
+#include "kmshistogram.h"
+
+#define PROCESSING_LATENCY_QUARK \
+  (g_quark_from_static_string ("kms-processing-latency"))
+
+static GMutex processing_latency_mutex;
+
+struct _KmsHistogram
+{
+  GMutex mutex;
+  guint64 count;
+  guint64 sum;
+  guint64 min;
+  guint64 max;
+  guint32 buckets[KMS_HISTOGRAM_BUCKETS];
+};
+
+static guint
+kms_histogram_bucket (guint64 value)
+{
+  guint msb;
+
+  if (value < KMS_HISTOGRAM_SUB_BUCKETS) {
+    return value;
+  }
+
+  msb = g_bit_storage (value) - 1;
+
+  if (msb >= KMS_HISTOGRAM_MAX_BITS) {
+    return KMS_HISTOGRAM_BUCKETS - 1;
+  }
+
+  return (msb - 3) * KMS_HISTOGRAM_SUB_BUCKETS +
+      ((value >> (msb - 4)) & (KMS_HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+static guint64
+kms_histogram_bucket_lower_bound (guint bucket, guint64 * width)
+{
+  guint msb, sub;
+
+  if (bucket < KMS_HISTOGRAM_SUB_BUCKETS) {
+    *width = 1;
+    return bucket;
+  }
+
+  msb = bucket / KMS_HISTOGRAM_SUB_BUCKETS + 3;
+  sub = bucket % KMS_HISTOGRAM_SUB_BUCKETS;
+  *width = G_GUINT64_CONSTANT (1) << (msb - 4);
+
+  return (guint64) (KMS_HISTOGRAM_SUB_BUCKETS + sub) << (msb - 4);
+}
+
+KmsHistogram *
+kms_histogram_new (void)
+{
+  KmsHistogram *hist;
+
+  hist = g_slice_new0 (KmsHistogram);
+  g_mutex_init (&hist->mutex);
+  hist->min = G_MAXUINT64;
+
+  return hist;
+}
+
+void
+kms_histogram_free (KmsHistogram * hist)
+{
+  g_mutex_clear (&hist->mutex);
+  g_slice_free (KmsHistogram, hist);
+}
+
+void
+kms_histogram_record (KmsHistogram * hist, guint64 value)
+{
+  guint bucket = kms_histogram_bucket (value);
+
+  g_mutex_lock (&hist->mutex);
+
+  hist->buckets[bucket]++;
+  hist->count++;
+  hist->sum += value;
+
+  if (value < hist->min) {
+    hist->min = value;
+  }
+
+  if (value > hist->max) {
+    hist->max = value;
+  }
+
+  g_mutex_unlock (&hist->mutex);
+}
+
+void
+kms_histogram_merge (KmsHistogram * dst, KmsHistogram * src)
+{
+  guint32 buckets[KMS_HISTOGRAM_BUCKETS];
+  guint64 count, sum, min, max;
+  guint i;
+
+  /* Copy first so that two histograms are never locked at once */
+  g_mutex_lock (&src->mutex);
+  memcpy (buckets, src->buckets, sizeof (buckets));
+  count = src->count;
+  sum = src->sum;
+  min = src->min;
+  max = src->max;
+  g_mutex_unlock (&src->mutex);
+
+  if (count == 0) {
+    return;
+  }
+
+  g_mutex_lock (&dst->mutex);
+
+  for (i = 0; i < KMS_HISTOGRAM_BUCKETS; i++) {
+    dst->buckets[i] += buckets[i];
+  }
+
+  dst->count += count;
+  dst->sum += sum;
+  dst->min = MIN (dst->min, min);
+  dst->max = MAX (dst->max, max);
+
+  g_mutex_unlock (&dst->mutex);
+}
+
+void
+kms_histogram_reset (KmsHistogram * hist)
+{
+  g_mutex_lock (&hist->mutex);
+  memset (hist->buckets, 0, sizeof (hist->buckets));
+  hist->count = 0;
+  hist->sum = 0;
+  hist->min = G_MAXUINT64;
+  hist->max = 0;
+  g_mutex_unlock (&hist->mutex);
+}
+
+guint64
+kms_histogram_get_count (KmsHistogram * hist)
+{
+  guint64 count;
+
+  g_mutex_lock (&hist->mutex);
+  count = hist->count;
+  g_mutex_unlock (&hist->mutex);
+
+  return count;
+}
+
+guint64
+kms_histogram_get_sum (KmsHistogram * hist)
+{
+  guint64 sum;
+
+  g_mutex_lock (&hist->mutex);
+  sum = hist->sum;
+  g_mutex_unlock (&hist->mutex);
+
+  return sum;
+}
+
+guint64
+kms_histogram_get_min (KmsHistogram * hist)
+{
+  guint64 min;
+
+  g_mutex_lock (&hist->mutex);
+  min = hist->count > 0 ? hist->min : 0;
+  g_mutex_unlock (&hist->mutex);
+
+  return min;
+}
+
+guint64
+kms_histogram_get_max (KmsHistogram * hist)
+{
+  guint64 max;
+
+  g_mutex_lock (&hist->mutex);
+  max = hist->max;
+  g_mutex_unlock (&hist->mutex);
+
+  return max;
+}
+
+guint64
+kms_histogram_get_percentile (KmsHistogram * hist, gdouble percentile)
+{
+  guint64 target, seen = 0, value = 0, width;
+  guint i;
+
+  g_mutex_lock (&hist->mutex);
+
+  if (hist->count == 0) {
+    g_mutex_unlock (&hist->mutex);
+    return 0;
+  }
+
+  target = (guint64) (percentile / 100.0 * hist->count + 0.5);
+  target = CLAMP (target, 1, hist->count);
+
+  for (i = 0; i < KMS_HISTOGRAM_BUCKETS; i++) {
+    seen += hist->buckets[i];
+
+    if (seen >= target) {
+      /* Middle of the bucket, but never outside the recorded range */
+      value = kms_histogram_bucket_lower_bound (i, &width);
+      value = CLAMP (value + width / 2, hist->min, hist->max);
+      break;
+    }
+  }
+
+  g_mutex_unlock (&hist->mutex);
+
+  return value;
+}
+
+void
+kms_histogram_get_counts (KmsHistogram * hist, const guint64 * bounds,
+    guint n_bounds, guint64 * counts, guint64 * sum)
+{
+  guint64 last, width;
+  guint i, bound = 0;
+
+  memset (counts, 0, (n_bounds + 1) * sizeof (guint64));
+
+  g_mutex_lock (&hist->mutex);
+
+  for (i = 0; i < KMS_HISTOGRAM_BUCKETS; i++) {
+    if (hist->buckets[i] == 0) {
+      continue;
+    }
+
+    /* Buckets are sorted, so bounds already passed are never needed again */
+    last = kms_histogram_bucket_lower_bound (i, &width) + width - 1;
+
+    while (bound < n_bounds && last > bounds[bound]) {
+      bound++;
+    }
+
+    counts[bound] += hist->buckets[i];
+  }
+
+  if (sum != NULL) {
+    *sum = hist->sum;
+  }
+
+  g_mutex_unlock (&hist->mutex);
+}
+
+GstStructure *
+kms_histogram_to_structure (KmsHistogram * hist, const gchar * name)
+{
+  return gst_structure_new (name,
+      "count", G_TYPE_UINT64, kms_histogram_get_count (hist),
+      "min", G_TYPE_UINT64, kms_histogram_get_min (hist),
+      "p50", G_TYPE_UINT64, kms_histogram_get_percentile (hist, 50),
+      "p90", G_TYPE_UINT64, kms_histogram_get_percentile (hist, 90),
+      "p99", G_TYPE_UINT64, kms_histogram_get_percentile (hist, 99),
+      "p999", G_TYPE_UINT64, kms_histogram_get_percentile (hist, 99.9),
+      "max", G_TYPE_UINT64, kms_histogram_get_max (hist), NULL);
+}
+
+KmsHistogram *
+kms_processing_latency_get (GstElement * element, gboolean create)
+{
+  KmsHistogram *hist;
+
+  hist = g_object_get_qdata (G_OBJECT (element), PROCESSING_LATENCY_QUARK);
+
+  if (hist != NULL || !create) {
+    return hist;
+  }
+
+  g_mutex_lock (&processing_latency_mutex);
+
+  hist = g_object_get_qdata (G_OBJECT (element), PROCESSING_LATENCY_QUARK);
+
+  if (hist == NULL) {
+    hist = kms_histogram_new ();
+    g_object_set_qdata_full (G_OBJECT (element), PROCESSING_LATENCY_QUARK,
+        hist, (GDestroyNotify) kms_histogram_free);
+  }
+
+  g_mutex_unlock (&processing_latency_mutex);
+
+  return hist;
+}
+
+typedef void (*KmsHistogramFunc) (GstElement * element, KmsHistogram * hist,
+    gpointer user_data);
+
+static void
+kms_processing_latency_foreach (GstElement * element, KmsHistogramFunc func,
+    gpointer user_data)
+{
+  KmsHistogram *hist;
+  GValue item = G_VALUE_INIT;
+  GstIterator *it;
+  gboolean done = FALSE;
+
+  hist = kms_processing_latency_get (element, FALSE);
+  if (hist != NULL) {
+    func (element, hist, user_data);
+  }
+
+  if (!GST_IS_BIN (element)) {
+    return;
+  }
+
+  it = gst_bin_iterate_recurse (GST_BIN (element));
+
+  while (!done) {
+    switch (gst_iterator_next (it, &item)) {
+      case GST_ITERATOR_OK:{
+        GstElement *child = g_value_get_object (&item);
+
+        hist = kms_processing_latency_get (child, FALSE);
+        if (hist != NULL) {
+          func (child, hist, user_data);
+        }
+
+        g_value_reset (&item);
+        break;
+      }
+      case GST_ITERATOR_RESYNC:
+        gst_iterator_resync (it);
+        break;
+      default:
+        done = TRUE;
+        break;
+    }
+  }
+
+  g_value_unset (&item);
+  gst_iterator_free (it);
+}
+
+static void
+add_histogram_stats (GstElement * element, KmsHistogram * hist,
+    GstStructure ** stats)
+{
+  GstStructure *hist_stats;
+  gchar *name;
+
+  if (*stats == NULL) {
+    *stats = gst_structure_new_empty ("processing-latency");
+  }
+
+  name = gst_element_get_name (element);
+  hist_stats = kms_histogram_to_structure (hist, name);
+  gst_structure_set (*stats, name, GST_TYPE_STRUCTURE, hist_stats, NULL);
+  gst_structure_free (hist_stats);
+  g_free (name);
+}
+
+GstStructure *
+kms_processing_latency_get_stats (GstElement * element)
+{
+  GstStructure *stats = NULL;
+
+  kms_processing_latency_foreach (element,
+      (KmsHistogramFunc) add_histogram_stats, &stats);
+
+  return stats;
+}
+
+static void
+dump_histogram (GstElement * element, KmsHistogram * hist, GString * dump)
+{
+  gchar *path = gst_object_get_path_string (GST_OBJECT (element));
+
+  g_string_append_printf (dump, "%s: count=%" G_GUINT64_FORMAT
+      " min=%" G_GUINT64_FORMAT " p50=%" G_GUINT64_FORMAT
+      " p99=%" G_GUINT64_FORMAT " p999=%" G_GUINT64_FORMAT
+      " max=%" G_GUINT64_FORMAT " ns\n", path,
+      kms_histogram_get_count (hist), kms_histogram_get_min (hist),
+      kms_histogram_get_percentile (hist, 50),
+      kms_histogram_get_percentile (hist, 99),
+      kms_histogram_get_percentile (hist, 99.9), kms_histogram_get_max (hist));
+
+  g_free (path);
+}
+
+gchar *
+kms_processing_latency_dump (GstElement * element)
+{
+  GString *dump = g_string_new ("");
+
+  kms_processing_latency_foreach (element, (KmsHistogramFunc) dump_histogram,
+      dump);
+
+  return g_string_free (dump, FALSE);
+}
@@ -0,0 +1,81 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __KMS_HISTOGRAM_H__
+#define __KMS_HISTOGRAM_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Log-linear histogram of nanosecond values. Every power of two is split in
+ * KMS_HISTOGRAM_SUB_BUCKETS buckets, so percentiles are accurate to about 6%
+ * of the value. Histograms have a fixed layout and merge by adding buckets.
+ */
+typedef struct _KmsHistogram KmsHistogram;
+
+#define KMS_HISTOGRAM_SUB_BUCKETS 16
+#define KMS_HISTOGRAM_MAX_BITS 46 /* ~19 hours */
+#define KMS_HISTOGRAM_BUCKETS \
+  ((KMS_HISTOGRAM_MAX_BITS - 3) * KMS_HISTOGRAM_SUB_BUCKETS)
+
+KmsHistogram * kms_histogram_new (void);
+void kms_histogram_free (KmsHistogram * hist);
+
+void kms_histogram_record (KmsHistogram * hist, guint64 value);
+void kms_histogram_merge (KmsHistogram * dst, KmsHistogram * src);
+void kms_histogram_reset (KmsHistogram * hist);
+
+guint64 kms_histogram_get_count (KmsHistogram * hist);
+/* Sum of all the recorded values */
+guint64 kms_histogram_get_sum (KmsHistogram * hist);
+guint64 kms_histogram_get_min (KmsHistogram * hist);
+guint64 kms_histogram_get_max (KmsHistogram * hist);
+guint64 kms_histogram_get_percentile (KmsHistogram * hist, gdouble percentile);
+
+/*
+ * Snapshot of the histogram in n_bounds + 1 non-cumulative counts: counts[i]
+ * holds the values up to bounds[i] (ascending) and above bounds[i - 1], and
+ * counts[n_bounds] the values above the last bound. Values are only known to
+ * bucket precision, a bucket crossing a bound is counted above it. sum, if
+ * not NULL, gets the sum of the values in the same snapshot.
+ */
+void kms_histogram_get_counts (KmsHistogram * hist, const guint64 * bounds,
+    guint n_bounds, guint64 * counts, guint64 * sum);
+
+/* Structure with count, min, p50, p90, p99, p999 and max fields */
+GstStructure * kms_histogram_to_structure (KmsHistogram * hist,
+    const gchar * name);
+
+/*
+ * Processing latency histograms, attached to elements by the kmslatency
+ * tracer. They hold the time buffers spend inside each element.
+ */
+KmsHistogram * kms_processing_latency_get (GstElement * element,
+    gboolean create);
+
+/* Structure with one field per tracked element inside element (including
+ * itself), or NULL if there is none */
+GstStructure * kms_processing_latency_get_stats (GstElement * element);
+
+/* Human readable dump of the histograms inside element */
+gchar * kms_processing_latency_dump (GstElement * element);
+
+G_END_DECLS
+
+#endif /* __KMS_HISTOGRAM_H__ */
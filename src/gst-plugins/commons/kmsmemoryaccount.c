@@ -0,0 +1,249 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <string.h>
+
+#include "kmsmemoryaccount.h"
+#include "kmsrefstruct.h"
+
+#define GST_DEFAULT_NAME "kmsmemoryaccount"
+#define GST_CAT_DEFAULT kms_memory_account_debug
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+
+struct _KmsMemoryAccount
+{
+  KmsRefStruct ref;
+  /* Only accessed with the __atomic builtins, GLib has no gssize atomics */
+  gssize used;
+  gssize peak;
+};
+
+static GPrivate current_account =
+G_PRIVATE_INIT ((GDestroyNotify) kms_memory_account_unref);
+
+static void
+kms_memory_account_destroy (KmsMemoryAccount * account)
+{
+  g_slice_free (KmsMemoryAccount, account);
+}
+
+KmsMemoryAccount *
+kms_memory_account_new (void)
+{
+  KmsMemoryAccount *account;
+
+  account = g_slice_new0 (KmsMemoryAccount);
+  kms_ref_struct_init (KMS_REF_STRUCT_CAST (account),
+      (GDestroyNotify) kms_memory_account_destroy);
+
+  return account;
+}
+
+KmsMemoryAccount *
+kms_memory_account_ref (KmsMemoryAccount * account)
+{
+  return (KmsMemoryAccount *) kms_ref_struct_ref (KMS_REF_STRUCT_CAST
+      (account));
+}
+
+void
+kms_memory_account_unref (KmsMemoryAccount * account)
+{
+  kms_ref_struct_unref (KMS_REF_STRUCT_CAST (account));
+}
+
+void
+kms_memory_account_charge (KmsMemoryAccount * account, gssize bytes)
+{
+  gssize used, peak;
+
+  used = __atomic_add_fetch (&account->used, bytes, __ATOMIC_RELAXED);
+
+  if (bytes <= 0) {
+    return;
+  }
+
+  /* On failure peak is reloaded with the current value */
+  peak = __atomic_load_n (&account->peak, __ATOMIC_RELAXED);
+  while (used > peak && !__atomic_compare_exchange_n (&account->peak, &peak,
+          used, TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+gssize
+kms_memory_account_get_used (KmsMemoryAccount * account)
+{
+  return __atomic_load_n (&account->used, __ATOMIC_RELAXED);
+}
+
+gssize
+kms_memory_account_get_peak (KmsMemoryAccount * account)
+{
+  return __atomic_load_n (&account->peak, __ATOMIC_RELAXED);
+}
+
+void
+kms_memory_account_set_current (KmsMemoryAccount * account)
+{
+  if (account == g_private_get (&current_account)) {
+    return;
+  }
+
+  g_private_replace (&current_account,
+      account != NULL ? kms_memory_account_ref (account) : NULL);
+}
+
+KmsMemoryAccount *
+kms_memory_account_get_current (void)
+{
+  return g_private_get (&current_account);
+}
+
+/* Accounting allocator */
+
+#define KMS_TYPE_ACCOUNTING_ALLOCATOR (kms_accounting_allocator_get_type ())
+
+typedef struct _KmsAccountingAllocator
+{
+  GstAllocator parent;
+
+  GstAllocator *sysmem;
+} KmsAccountingAllocator;
+
+typedef struct _KmsAccountingAllocatorClass
+{
+  GstAllocatorClass parent_class;
+} KmsAccountingAllocatorClass;
+
+static GType kms_accounting_allocator_get_type (void);
+
+G_DEFINE_TYPE (KmsAccountingAllocator, kms_accounting_allocator,
+    GST_TYPE_ALLOCATOR);
+
+/* Placed in the same block as the data it accounts for */
+typedef struct _KmsAccountedBlock
+{
+  KmsMemoryAccount *account;
+  gsize size;
+} KmsAccountedBlock;
+
+static void
+kms_accounted_block_free (KmsAccountedBlock * block)
+{
+  kms_memory_account_charge (block->account, -(gssize) block->size);
+  kms_memory_account_unref (block->account);
+  g_free (block);
+}
+
+static GstMemory *
+kms_accounting_allocator_alloc (GstAllocator * allocator, gsize size,
+    GstAllocationParams * params)
+{
+  KmsAccountingAllocator *self = (KmsAccountingAllocator *) allocator;
+  KmsMemoryAccount *account = kms_memory_account_get_current ();
+  KmsAccountedBlock *block;
+  gsize maxsize, align, aoffset;
+  guint8 *data;
+
+  if (account == NULL) {
+    return gst_allocator_alloc (self->sysmem, size, params);
+  }
+
+  maxsize = size + params->prefix + params->padding;
+  align = params->align | gst_memory_alignment;
+
+  block = g_malloc (sizeof (KmsAccountedBlock) + maxsize + align);
+  block->account = kms_memory_account_ref (account);
+  block->size = sizeof (KmsAccountedBlock) + maxsize + align;
+
+  data = (guint8 *) (block + 1);
+
+  if ((aoffset = ((guintptr) data & align))) {
+    data += (align + 1) - aoffset;
+  }
+
+  if (params->prefix && (params->flags & GST_MEMORY_FLAG_ZERO_PREFIXED)) {
+    memset (data, 0, params->prefix);
+  }
+
+  if (params->padding && (params->flags & GST_MEMORY_FLAG_ZERO_PADDED)) {
+    memset (data + params->prefix + size, 0, params->padding);
+  }
+
+  kms_memory_account_charge (account, block->size);
+
+  return gst_memory_new_wrapped (params->flags, data, maxsize, params->prefix,
+      size, block, (GDestroyNotify) kms_accounted_block_free);
+}
+
+static void
+kms_accounting_allocator_free (GstAllocator * allocator, GstMemory * memory)
+{
+  /* Memories are always system ones, freed by the system allocator */
+  g_assert_not_reached ();
+}
+
+static void
+kms_accounting_allocator_finalize (GObject * object)
+{
+  KmsAccountingAllocator *self = (KmsAccountingAllocator *) object;
+
+  gst_object_unref (self->sysmem);
+
+  G_OBJECT_CLASS (kms_accounting_allocator_parent_class)->finalize (object);
+}
+
+static void
+kms_accounting_allocator_class_init (KmsAccountingAllocatorClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstAllocatorClass *allocator_class = GST_ALLOCATOR_CLASS (klass);
+
+  gobject_class->finalize = kms_accounting_allocator_finalize;
+
+  allocator_class->alloc = kms_accounting_allocator_alloc;
+  allocator_class->free = kms_accounting_allocator_free;
+}
+
+static void
+kms_accounting_allocator_init (KmsAccountingAllocator * self)
+{
+  GstAllocator *allocator = GST_ALLOCATOR_CAST (self);
+
+  self->sysmem = gst_allocator_find (GST_ALLOCATOR_SYSMEM);
+  allocator->mem_type = GST_ALLOCATOR_SYSMEM;
+}
+
+void
+kms_memory_account_install_allocator (void)
+{
+  static gsize init = 0;
+
+  if (g_once_init_enter (&init)) {
+    GstAllocator *allocator;
+
+    GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, GST_DEFAULT_NAME, 0,
+        GST_DEFAULT_NAME);
+
+    allocator = g_object_new (KMS_TYPE_ACCOUNTING_ALLOCATOR, NULL);
+    gst_allocator_register ("KmsAccounting", gst_object_ref (allocator));
+    gst_allocator_set_default (allocator);
+
+    GST_INFO ("Accounting memory of pipelines");
+
+    g_once_init_leave (&init, 1);
+  }
+}
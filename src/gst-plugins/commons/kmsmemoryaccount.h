@@ -0,0 +1,57 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __KMS_MEMORY_ACCOUNT_H__
+#define __KMS_MEMORY_ACCOUNT_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Bytes of GstMemory owned by a group of threads, usually the streaming
+ * threads of one pipeline. Memory is charged to the account current in the
+ * allocating thread and given back to that same account when it is freed,
+ * whatever thread frees it.
+ */
+typedef struct _KmsMemoryAccount KmsMemoryAccount;
+
+KmsMemoryAccount * kms_memory_account_new (void);
+KmsMemoryAccount * kms_memory_account_ref (KmsMemoryAccount * account);
+void kms_memory_account_unref (KmsMemoryAccount * account);
+
+void kms_memory_account_charge (KmsMemoryAccount * account, gssize bytes);
+
+gssize kms_memory_account_get_used (KmsMemoryAccount * account);
+gssize kms_memory_account_get_peak (KmsMemoryAccount * account);
+
+/* Account of the calling thread, NULL if it has none. The thread keeps a
+ * reference until another account is set or the thread exits */
+void kms_memory_account_set_current (KmsMemoryAccount * account);
+KmsMemoryAccount * kms_memory_account_get_current (void);
+
+/*
+ * Makes the default GstAllocator charge system memory to the current
+ * account. Memory allocated by threads without account is not tracked and
+ * costs nothing extra. Buffer pools allocate through the default allocator,
+ * so their buffers are charged to the thread that fills the pool.
+ */
+void kms_memory_account_install_allocator (void);
+
+G_END_DECLS
+
+#endif /* __KMS_MEMORY_ACCOUNT_H__ */
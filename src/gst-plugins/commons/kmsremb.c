@@ -26,9 +26,6 @@ GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
 #define REMB_MIN 30000          /* bps */
 #define REMB_MAX 2000000        /* bps */
 
-#define KMS_REMB_REMOTE "kms-remb-remote"
-G_DEFINE_QUARK (KMS_REMB_REMOTE, kms_remb_remote);
-
 #define DEFAULT_REMB_PACKETS_RECV_INTERVAL_TOP 100
 #define DEFAULT_REMB_EXPONENTIAL_FACTOR 0.04
 #define DEFAULT_REMB_LINEAL_FACTOR_MIN 50       /* bps */
@@ -42,9 +39,10 @@ G_DEFINE_QUARK (KMS_REMB_REMOTE, kms_remb_remote);
 static void
 kms_remb_base_destroy (KmsRembBase * self)
 {
-  g_signal_handler_disconnect (self->rtpsess, self->signal_id);
-  self->signal_id = 0;
-  g_object_set_qdata (self->rtpsess, kms_remb_remote_quark (), NULL);
+  if (self->signal_id != 0) {
+    g_signal_handler_disconnect (self->rtpsess, self->signal_id);
+    self->signal_id = 0;
+  }
   g_clear_object (&self->rtpsess);
   g_rec_mutex_clear (&self->mutex);
   g_hash_table_unref (self->remb_stats);
@@ -404,6 +402,20 @@ add_ssrcs (KmsRlRemoteSession * rlrs, AddSsrcsData * data)
   kms_remb_base_update_stats (rb, rlrs->ssrc, data->remb_packet->bitrate);
 }
 
+KmsHistogram *
+kms_remb_local_get_estimates (void)
+{
+  static gsize init = 0;
+  static KmsHistogram *estimates;
+
+  if (g_once_init_enter (&init)) {
+    estimates = kms_histogram_new ();
+    g_once_init_leave (&init, 1);
+  }
+
+  return estimates;
+}
+
 // Signal "RTPSession::on-sending-rtcp" doc: GStreamer/rtpsession.c
 static gboolean
 kms_remb_local_on_sending_rtcp (GObject *rtpsession,
@@ -480,6 +492,8 @@ kms_remb_local_on_sending_rtcp (GObject *rtpsession,
     gst_rtcp_packet_remove (&packet);
   }
 
+  kms_histogram_record (kms_remb_local_get_estimates (), new_bitrate);
+
   self->last_sent_time = current_time;
   ret = TRUE;
 
@@ -710,7 +724,7 @@ kms_remb_remote_update (KmsRembRemote * rm,
 
 static void
 kms_remb_remote_update_target_ssrcs_stats (KmsRembRemote * rm,
-    KmsRTCPPSFBAFBREMBPacket * remb_packet)
+    const KmsRTCPPSFBAFBREMBPacket * remb_packet)
 {
   guint i;
 
@@ -720,62 +734,12 @@ kms_remb_remote_update_target_ssrcs_stats (KmsRembRemote * rm,
   }
 }
 
-static void
-process_psfb_afb (GObject * sess, guint ssrc, GstBuffer * fci_buffer)
-{
-  KmsRembRemote *rm;
-  KmsRTCPPSFBAFBBuffer afb_buffer = { NULL, };
-  KmsRTCPPSFBAFBPacket afb_packet;
-  KmsRTCPPSFBAFBREMBPacket remb_packet;
-  KmsRTCPPSFBAFBType type;
-
-  if (!G_IS_OBJECT (sess)) {
-    GST_WARNING ("Invalid session object");
-    return;
-  }
-
-  rm = g_object_get_qdata (sess, kms_remb_remote_quark ());
-
-  if (!rm) {
-    GST_WARNING ("Invalid RembRemote");
-    return;
-  }
-
-  if (!kms_rtcp_psfb_afb_buffer_map (fci_buffer, GST_MAP_READ, &afb_buffer)) {
-    GST_WARNING_OBJECT (fci_buffer, "Buffer cannot be mapped");
-    return;
-  }
-
-  if (!kms_rtcp_psfb_afb_get_packet (&afb_buffer, &afb_packet)) {
-    GST_WARNING_OBJECT (fci_buffer, "Cannot get RTCP PSFB AFB packet");
-    goto end;
-  }
-
-  type = kms_rtcp_psfb_afb_packet_get_type (&afb_packet);
-  switch (type) {
-    case KMS_RTCP_PSFB_AFB_TYPE_REMB:
-      kms_rtcp_psfb_afb_remb_get_packet (&afb_packet, &remb_packet);
-      kms_remb_remote_update (rm, &remb_packet);
-      kms_remb_remote_update_target_ssrcs_stats (rm, &remb_packet);
-      break;
-    default:
-      break;
-  }
-
-end:
-  kms_rtcp_psfb_afb_buffer_unmap (&afb_buffer);
-}
-
-static void
-kms_remb_remote_on_feedback_rtcp (GObject *rtpsession,
-    guint type, guint fbtype, guint sender_ssrc, guint media_ssrc,
-    GstBuffer *fci)
+void
+kms_remb_remote_process_remb (KmsRembRemote * rm,
+    const KmsRTCPPSFBAFBREMBPacket * remb_packet)
 {
-  GST_DEBUG_OBJECT (rtpsession, "REMB: Signal 'on-feedback-rtcp'");
-  if (type == GST_RTCP_TYPE_PSFB
-      && fbtype == GST_RTCP_PSFB_TYPE_AFB) {
-    process_psfb_afb (rtpsession, sender_ssrc, fci);
-  }
+  kms_remb_remote_update (rm, remb_packet);
+  kms_remb_remote_update_target_ssrcs_stats (rm, remb_packet);
 }
 
 void
@@ -800,11 +764,6 @@ kms_remb_remote_create (GObject * rtpsession, guint local_ssrc,
 {
   KmsRembRemote *self = g_slice_new0 (KmsRembRemote);
 
-  g_object_set_qdata (rtpsession, kms_remb_remote_quark (), self);
-
-  self->base.signal_id = g_signal_connect (rtpsession, "on-feedback-rtcp",
-      G_CALLBACK (kms_remb_remote_on_feedback_rtcp), self);
-
   kms_remb_base_create (KMS_REMB_BASE (self), rtpsession);
 
   self->local_ssrc = local_ssrc;
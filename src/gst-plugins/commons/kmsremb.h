@@ -19,6 +19,8 @@
 #define __KMS_REMB_H__
 
 #include "kmsutils.h" /* TODO: must be not needed */
+#include "kmshistogram.h"
+#include "kmsrtcp.h"
 
 G_BEGIN_DECLS
 
@@ -79,6 +81,9 @@ void kms_remb_local_destroy (KmsRembLocal *rl);
 void kms_remb_local_add_remote_session (KmsRembLocal *rl, GObject *rtpsess, guint ssrc);
 void kms_remb_local_set_params (KmsRembLocal *rl, GstStructure *params);
 void kms_remb_local_get_params (KmsRembLocal *rl, GstStructure **params);
+
+/* Bitrates (bps) of all the REMB packets sent by the process */
+KmsHistogram * kms_remb_local_get_estimates (void);
 /* KmsRembLocal end */
 
 /* KmsRembRemote begin */
@@ -104,6 +109,9 @@ KmsRembRemote * kms_remb_remote_create (GObject *rtpsess,
 void kms_remb_remote_destroy (KmsRembRemote *rm);
 void kms_remb_remote_set_params (KmsRembRemote *rm, GstStructure *params);
 void kms_remb_remote_get_params (KmsRembRemote *rm, GstStructure **params);
+/* Fed by the session RTCP dispatcher with every REMB received */
+void kms_remb_remote_process_remb (KmsRembRemote *rm,
+  const KmsRTCPPSFBAFBREMBPacket *remb_packet);
 /* KmsRembRemote end */
 
 G_END_DECLS
@@ -74,18 +74,23 @@ kms_rtcp_psfb_afb_buffer_unmap (KmsRTCPPSFBAFBBuffer * rtcp_psfb_afb)
 
 /* Inspired in The WebRTC project */
 static gboolean
-is_remb (KmsRTCPPSFBAFBPacket * packet)
+is_remb_fci (const guint8 * fci, guint size)
 {
-  GstMapInfo map = packet->rtcp_psfb_afb->map;
-  guint8 *fci = map.data;
-
-  if (map.size < 4) {
+  if (size < 4) {
     return FALSE;
   }
 
   return (memcmp (fci, "REMB", 4) == 0);
 }
 
+static gboolean
+is_remb (KmsRTCPPSFBAFBPacket * packet)
+{
+  GstMapInfo map = packet->rtcp_psfb_afb->map;
+
+  return is_remb_fci (map.data, map.size);
+}
+
 static gboolean
 read_packet_type (KmsRTCPPSFBAFBPacket * packet)
 {
@@ -120,33 +125,22 @@ kms_rtcp_psfb_afb_packet_get_type (KmsRTCPPSFBAFBPacket * packet)
 
 /* Inspired in The WebRTC project */
 gboolean
-kms_rtcp_psfb_afb_remb_get_packet (KmsRTCPPSFBAFBPacket * afb_packet,
+kms_rtcp_psfb_afb_remb_parse_fci (const guint8 * fci, guint size,
     KmsRTCPPSFBAFBREMBPacket * remb_packet)
 {
-  GstMapInfo map;
+  const guint8 *fci_end = fci + size;
   guint length;
-  guint8 *fci, *fci_end, br_exp;
+  guint8 br_exp;
   guint32 br_mantissa;
   int i;
 
-  g_return_val_if_fail (afb_packet != NULL, FALSE);
-  g_return_val_if_fail (afb_packet->type == KMS_RTCP_PSFB_AFB_TYPE_REMB, FALSE);
-  g_return_val_if_fail (GST_IS_BUFFER (afb_packet->rtcp_psfb_afb->buffer),
-      FALSE);
-  g_return_val_if_fail (afb_packet->rtcp_psfb_afb->map.flags & GST_MAP_READ,
-      FALSE);
   g_return_val_if_fail (remb_packet != NULL, FALSE);
 
-  map = afb_packet->rtcp_psfb_afb->map;
-  fci = map.data;
-  length = map.size;
-  fci_end = map.data + length;
-
-  if (!is_remb (afb_packet)) {
+  if (!is_remb_fci (fci, size)) {
     GST_ERROR ("This is not a REMB packet");
     return FALSE;
   }
-  fci += 4;                     /* Previously consumed by is_remb */
+  fci += 4;                     /* Previously consumed by is_remb_fci */
 
   length = fci_end - fci;
   if (length < 4) {
@@ -170,13 +164,31 @@ kms_rtcp_psfb_afb_remb_get_packet (KmsRTCPPSFBAFBPacket * afb_packet,
   }
 
   for (i = 0; i < remb_packet->n_ssrcs; i++) {
-    remb_packet->ssrcs[i] = g_ntohl (*(guint32 *) fci);
+    remb_packet->ssrcs[i] = GST_READ_UINT32_BE (fci);
     fci += 4;
   }
 
   return TRUE;
 }
 
+gboolean
+kms_rtcp_psfb_afb_remb_get_packet (KmsRTCPPSFBAFBPacket * afb_packet,
+    KmsRTCPPSFBAFBREMBPacket * remb_packet)
+{
+  GstMapInfo map;
+
+  g_return_val_if_fail (afb_packet != NULL, FALSE);
+  g_return_val_if_fail (afb_packet->type == KMS_RTCP_PSFB_AFB_TYPE_REMB, FALSE);
+  g_return_val_if_fail (GST_IS_BUFFER (afb_packet->rtcp_psfb_afb->buffer),
+      FALSE);
+  g_return_val_if_fail (afb_packet->rtcp_psfb_afb->map.flags & GST_MAP_READ,
+      FALSE);
+
+  map = afb_packet->rtcp_psfb_afb->map;
+
+  return kms_rtcp_psfb_afb_remb_parse_fci (map.data, map.size, remb_packet);
+}
+
 /* Inspired in The WebRTC project */
 static gboolean
 compute_mantissa_and_6_bit_base_2_expoonent (guint32 input_base10,
@@ -251,3 +263,249 @@ kms_rtcp_psfb_afb_remb_marshall_packet (GstRTCPPacket * rtcp_packet,
 }
 
 /* REMB end */
+
+/* KmsRTCPDispatcher begin */
+
+#define KMS_RTCP_RTPFB_TYPE_TWCC 15
+
+typedef struct _KmsRTCPConsumer
+{
+  gulong id;
+  guint types;
+  KmsRTCPDispatchFunc func;
+  gpointer user_data;
+  GDestroyNotify notify;
+} KmsRTCPConsumer;
+
+struct _KmsRTCPDispatcher
+{
+  GRWLock lock;
+  GSList *consumers;            /* List<KmsRTCPConsumer*> */
+  guint types;                  /* Union of the consumers' types */
+  gulong last_id;
+};
+
+KmsRTCPDispatcher *
+kms_rtcp_dispatcher_new (void)
+{
+  KmsRTCPDispatcher *self = g_slice_new0 (KmsRTCPDispatcher);
+
+  g_rw_lock_init (&self->lock);
+
+  return self;
+}
+
+static void
+kms_rtcp_consumer_destroy (KmsRTCPConsumer * consumer)
+{
+  if (consumer->notify != NULL) {
+    consumer->notify (consumer->user_data);
+  }
+
+  g_slice_free (KmsRTCPConsumer, consumer);
+}
+
+void
+kms_rtcp_dispatcher_destroy (KmsRTCPDispatcher * self)
+{
+  g_slist_free_full (self->consumers,
+      (GDestroyNotify) kms_rtcp_consumer_destroy);
+  g_rw_lock_clear (&self->lock);
+
+  g_slice_free (KmsRTCPDispatcher, self);
+}
+
+static void
+kms_rtcp_dispatcher_update_types (KmsRTCPDispatcher * self)
+{
+  GSList *l;
+
+  self->types = 0;
+
+  for (l = self->consumers; l != NULL; l = l->next) {
+    KmsRTCPConsumer *consumer = l->data;
+
+    self->types |= consumer->types;
+  }
+}
+
+gulong
+kms_rtcp_dispatcher_add_consumer (KmsRTCPDispatcher * self, guint types,
+    KmsRTCPDispatchFunc func, gpointer user_data, GDestroyNotify notify)
+{
+  KmsRTCPConsumer *consumer;
+  gulong id;
+
+  g_return_val_if_fail (func != NULL, 0);
+
+  consumer = g_slice_new0 (KmsRTCPConsumer);
+  consumer->types = types;
+  consumer->func = func;
+  consumer->user_data = user_data;
+  consumer->notify = notify;
+
+  g_rw_lock_writer_lock (&self->lock);
+  id = consumer->id = ++self->last_id;
+  self->consumers = g_slist_append (self->consumers, consumer);
+  self->types |= types;
+  g_rw_lock_writer_unlock (&self->lock);
+
+  return id;
+}
+
+void
+kms_rtcp_dispatcher_remove_consumer (KmsRTCPDispatcher * self, gulong id)
+{
+  KmsRTCPConsumer *found = NULL;
+  GSList *l;
+
+  g_rw_lock_writer_lock (&self->lock);
+
+  for (l = self->consumers; l != NULL; l = l->next) {
+    KmsRTCPConsumer *consumer = l->data;
+
+    if (consumer->id == id) {
+      found = consumer;
+      self->consumers = g_slist_delete_link (self->consumers, l);
+      kms_rtcp_dispatcher_update_types (self);
+      break;
+    }
+  }
+
+  g_rw_lock_writer_unlock (&self->lock);
+
+  if (found != NULL) {
+    kms_rtcp_consumer_destroy (found);
+  }
+}
+
+static KmsRTCPPacketViewType
+kms_rtcp_dispatcher_classify (GstRTCPPacket * packet, guint8 ** fci,
+    guint * fci_len)
+{
+  GstRTCPType type = gst_rtcp_packet_get_type (packet);
+  guint fbtype;
+
+  switch (type) {
+    case GST_RTCP_TYPE_SR:
+      return KMS_RTCP_PACKET_VIEW_SR;
+    case GST_RTCP_TYPE_RR:
+      return KMS_RTCP_PACKET_VIEW_RR;
+    case GST_RTCP_TYPE_RTPFB:
+    case GST_RTCP_TYPE_PSFB:
+      break;
+    default:
+      return KMS_RTCP_PACKET_VIEW_NONE;
+  }
+
+  *fci = gst_rtcp_packet_fb_get_fci (packet);
+  *fci_len = gst_rtcp_packet_fb_get_fci_length (packet) * 4;
+  fbtype = gst_rtcp_packet_fb_get_type (packet);
+
+  if (type == GST_RTCP_TYPE_RTPFB) {
+    switch (fbtype) {
+      case GST_RTCP_RTPFB_TYPE_NACK:
+        return KMS_RTCP_PACKET_VIEW_NACK;
+      case KMS_RTCP_RTPFB_TYPE_TWCC:
+        return KMS_RTCP_PACKET_VIEW_TWCC;
+      default:
+        return KMS_RTCP_PACKET_VIEW_NONE;
+    }
+  }
+
+  switch (fbtype) {
+    case GST_RTCP_PSFB_TYPE_PLI:
+      return KMS_RTCP_PACKET_VIEW_PLI;
+    case GST_RTCP_PSFB_TYPE_FIR:
+      return KMS_RTCP_PACKET_VIEW_FIR;
+    case GST_RTCP_PSFB_TYPE_AFB:
+      if (is_remb_fci (*fci, *fci_len)) {
+        return KMS_RTCP_PACKET_VIEW_REMB;
+      }
+      return KMS_RTCP_PACKET_VIEW_NONE;
+    default:
+      return KMS_RTCP_PACKET_VIEW_NONE;
+  }
+}
+
+static void
+kms_rtcp_dispatcher_fill_view (KmsRTCPPacketView * view,
+    KmsRTCPPSFBAFBREMBPacket * remb)
+{
+  switch (view->type) {
+    case KMS_RTCP_PACKET_VIEW_SR:
+      gst_rtcp_packet_sr_get_sender_info (view->packet, &view->sender_ssrc,
+          NULL, NULL, NULL, NULL);
+      break;
+    case KMS_RTCP_PACKET_VIEW_RR:
+      view->sender_ssrc = gst_rtcp_packet_rr_get_ssrc (view->packet);
+      break;
+    case KMS_RTCP_PACKET_VIEW_REMB:
+      if (kms_rtcp_psfb_afb_remb_parse_fci (view->fci, view->fci_len, remb)) {
+        view->remb = remb;
+      }
+      /* fall through */
+    default:
+      view->sender_ssrc = gst_rtcp_packet_fb_get_sender_ssrc (view->packet);
+      view->media_ssrc = gst_rtcp_packet_fb_get_media_ssrc (view->packet);
+      break;
+  }
+}
+
+gboolean
+kms_rtcp_dispatcher_process_buffer (KmsRTCPDispatcher * self,
+    GstBuffer * buffer)
+{
+  GstRTCPBuffer rtcp = GST_RTCP_BUFFER_INIT;
+  KmsRTCPPSFBAFBREMBPacket remb;
+  GstRTCPPacket packet;
+  gboolean more;
+
+  g_rw_lock_reader_lock (&self->lock);
+
+  if (self->types == KMS_RTCP_PACKET_VIEW_NONE) {
+    /* Nobody is interested, do not even map the buffer */
+    g_rw_lock_reader_unlock (&self->lock);
+    return TRUE;
+  }
+
+  if (!gst_rtcp_buffer_map (buffer, GST_MAP_READ, &rtcp)) {
+    g_rw_lock_reader_unlock (&self->lock);
+    GST_WARNING_OBJECT (buffer, "Buffer cannot be mapped as RTCP");
+    return FALSE;
+  }
+
+  for (more = gst_rtcp_buffer_get_first_packet (&rtcp, &packet); more;
+      more = gst_rtcp_packet_move_to_next (&packet)) {
+    KmsRTCPPacketView view = { 0, };
+    guint8 *fci = NULL;
+    guint fci_len = 0;
+    GSList *l;
+
+    view.type = kms_rtcp_dispatcher_classify (&packet, &fci, &fci_len);
+    if (!(view.type & self->types)) {
+      continue;
+    }
+
+    view.packet = &packet;
+    view.fci = fci;
+    view.fci_len = fci_len;
+    view.time = GST_BUFFER_DTS (buffer);
+    kms_rtcp_dispatcher_fill_view (&view, &remb);
+
+    for (l = self->consumers; l != NULL; l = l->next) {
+      KmsRTCPConsumer *consumer = l->data;
+
+      if (consumer->types & view.type) {
+        consumer->func (&view, consumer->user_data);
+      }
+    }
+  }
+
+  gst_rtcp_buffer_unmap (&rtcp);
+  g_rw_lock_reader_unlock (&self->lock);
+
+  return TRUE;
+}
+
+/* KmsRTCPDispatcher end */
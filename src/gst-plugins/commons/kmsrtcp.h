@@ -77,8 +77,63 @@ KmsRTCPPSFBAFBType kms_rtcp_psfb_afb_packet_get_type (KmsRTCPPSFBAFBPacket *
 /* KmsRTCPPSFBAFBREMBPacket */
 gboolean kms_rtcp_psfb_afb_remb_get_packet (KmsRTCPPSFBAFBPacket * afb_packet,
     KmsRTCPPSFBAFBREMBPacket * remb_packet);
+gboolean kms_rtcp_psfb_afb_remb_parse_fci (const guint8 * fci, guint size,
+    KmsRTCPPSFBAFBREMBPacket * remb_packet);
 
 gboolean kms_rtcp_psfb_afb_remb_marshall_packet (GstRTCPPacket *rtcp_packet, KmsRTCPPSFBAFBREMBPacket * remb_packet, guint32 sender_ssrc);
 
+/**
+ * KmsRTCPPacketViewType:
+ *
+ * Kinds of packets a #KmsRTCPDispatcher hands out. They are flags so a
+ * consumer can subscribe to several of them at once.
+ */
+typedef enum
+{
+  KMS_RTCP_PACKET_VIEW_NONE = 0,
+  KMS_RTCP_PACKET_VIEW_SR = (1 << 0),
+  KMS_RTCP_PACKET_VIEW_RR = (1 << 1),
+  KMS_RTCP_PACKET_VIEW_REMB = (1 << 2),
+  KMS_RTCP_PACKET_VIEW_NACK = (1 << 3),
+  KMS_RTCP_PACKET_VIEW_PLI = (1 << 4),
+  KMS_RTCP_PACKET_VIEW_FIR = (1 << 5),
+  /* draft-holmer-rmcat-transport-wide-cc-extensions */
+  KMS_RTCP_PACKET_VIEW_TWCC = (1 << 6),
+} KmsRTCPPacketViewType;
+
+#define KMS_RTCP_PACKET_VIEW_ALL 0x7F
+
+typedef struct _KmsRTCPPacketView KmsRTCPPacketView;
+typedef struct _KmsRTCPDispatcher KmsRTCPDispatcher;
+
+/*
+ * Typed view of one packet of a compound RTCP buffer. It points into the
+ * mapped buffer and is only valid during the consumer callback.
+ */
+struct _KmsRTCPPacketView
+{
+  KmsRTCPPacketViewType type;
+  GstRTCPPacket *packet;
+  GstClockTime time;            /* DTS of the compound buffer */
+  guint32 sender_ssrc;
+  guint32 media_ssrc;           /* Feedback packets only */
+  const guint8 *fci;            /* Feedback packets only */
+  guint fci_len;                /* In bytes */
+  const KmsRTCPPSFBAFBREMBPacket *remb; /* REMB packets only */
+};
+
+typedef void (*KmsRTCPDispatchFunc) (const KmsRTCPPacketView * view, gpointer user_data);
+
+/* KmsRTCPDispatcher: maps each compound buffer once and fans out its packets */
+KmsRTCPDispatcher * kms_rtcp_dispatcher_new (void);
+void kms_rtcp_dispatcher_destroy (KmsRTCPDispatcher * self);
+
+/* Consumers must not add or remove consumers from their callback */
+gulong kms_rtcp_dispatcher_add_consumer (KmsRTCPDispatcher * self, guint types,
+    KmsRTCPDispatchFunc func, gpointer user_data, GDestroyNotify notify);
+void kms_rtcp_dispatcher_remove_consumer (KmsRTCPDispatcher * self, gulong id);
+
+gboolean kms_rtcp_dispatcher_process_buffer (KmsRTCPDispatcher * self, GstBuffer * buffer);
+
 G_END_DECLS
 #endif /* __KMS_RTCP_H__ */
@@ -0,0 +1,388 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "kmsrtphdrext.h"
+#include "constants.h"
+
+#include <string.h>
+
+#define GST_DEFAULT_NAME "kmsrtphdrext"
+#define GST_CAT_DEFAULT kms_rtp_hdr_ext_debug
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+
+#define ONE_BYTE_PROFILE 0xBEDE
+#define TWO_BYTES_PROFILE_MASK 0xFFF0
+#define TWO_BYTES_PROFILE 0x1000
+#define ONE_BYTE_STOP_ID 15
+
+#define MAX_EXT_ID 255
+
+static const gchar *uris[KMS_RTP_HDR_EXT_TYPES] = {
+  RTP_HDR_EXT_ABS_SEND_TIME_URI,
+  RTP_HDR_EXT_AUDIO_LEVEL_URI,
+  RTP_HDR_EXT_TRANSPORT_CC_URI,
+  RTP_HDR_EXT_SDES_MID_URI,
+  RTP_HDR_EXT_SDES_RID_URI,
+  RTP_HDR_EXT_SDES_REPAIRED_RID_URI,
+  RTP_HDR_EXT_VIDEO_ORIENTATION_URI
+};
+
+typedef struct _KmsRtpHdrExtHandler
+{
+  guint types;
+  KmsRtpHdrExtFunc func;
+  gpointer user_data;
+  GDestroyNotify notify;
+} KmsRtpHdrExtHandler;
+
+struct _KmsRtpHdrExtMap
+{
+  guint8 ids[KMS_RTP_HDR_EXT_TYPES];    /* 0 when not negotiated */
+  gint8 types[MAX_EXT_ID + 1];  /* id -> KmsRtpHdrExtType, -1 if unknown */
+  guint handled_types;
+  GSList *handlers;             /* List<KmsRtpHdrExtHandler*> */
+};
+
+static void init_debug (void) __attribute__ ((constructor));
+
+static void
+init_debug (void)
+{
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, GST_DEFAULT_NAME, 0,
+      GST_DEFAULT_NAME);
+}
+
+const gchar *
+kms_rtp_hdr_ext_type_get_uri (KmsRtpHdrExtType type)
+{
+  g_return_val_if_fail (type < KMS_RTP_HDR_EXT_TYPES, NULL);
+
+  return uris[type];
+}
+
+gboolean
+kms_rtp_hdr_ext_type_from_uri (const gchar * uri, KmsRtpHdrExtType * type)
+{
+  guint i;
+
+  for (i = 0; i < KMS_RTP_HDR_EXT_TYPES; i++) {
+    if (g_strcmp0 (uris[i], uri) == 0) {
+      *type = i;
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+KmsRtpHdrExtMap *
+kms_rtp_hdr_ext_map_new (void)
+{
+  KmsRtpHdrExtMap *map = g_slice_new0 (KmsRtpHdrExtMap);
+
+  memset (map->types, -1, sizeof (map->types));
+
+  return map;
+}
+
+static void
+kms_rtp_hdr_ext_handler_destroy (KmsRtpHdrExtHandler * handler)
+{
+  if (handler->notify != NULL) {
+    handler->notify (handler->user_data);
+  }
+
+  g_slice_free (KmsRtpHdrExtHandler, handler);
+}
+
+void
+kms_rtp_hdr_ext_map_free (KmsRtpHdrExtMap * map)
+{
+  g_slist_free_full (map->handlers,
+      (GDestroyNotify) kms_rtp_hdr_ext_handler_destroy);
+
+  g_slice_free (KmsRtpHdrExtMap, map);
+}
+
+void
+kms_rtp_hdr_ext_map_set_id (KmsRtpHdrExtMap * map, KmsRtpHdrExtType type,
+    guint8 id)
+{
+  g_return_if_fail (type < KMS_RTP_HDR_EXT_TYPES);
+
+  if (map->ids[type] != 0) {
+    map->types[map->ids[type]] = -1;
+  }
+
+  map->ids[type] = id;
+
+  if (id != 0) {
+    map->types[id] = type;
+  }
+}
+
+guint8
+kms_rtp_hdr_ext_map_get_id (const KmsRtpHdrExtMap * map,
+    KmsRtpHdrExtType type)
+{
+  g_return_val_if_fail (type < KMS_RTP_HDR_EXT_TYPES, 0);
+
+  return map->ids[type];
+}
+
+void
+kms_rtp_hdr_ext_map_add_from_sdp_media (KmsRtpHdrExtMap * map,
+    const GstSDPMedia * media)
+{
+  guint a;
+
+  for (a = 0;; a++) {
+    KmsRtpHdrExtType type;
+    const gchar *attr;
+    gchar **tokens;
+    gint64 id;
+
+    attr = gst_sdp_media_get_attribute_val_n (media, "extmap", a);
+    if (attr == NULL) {
+      break;
+    }
+
+    /* "<id>[/<direction>] <uri> [<attributes>]" */
+    tokens = g_strsplit (attr, " ", 0);
+    id = g_ascii_strtoll (tokens[0], NULL, 10);
+
+    if (tokens[1] != NULL && id > 0 && id <= MAX_EXT_ID
+        && kms_rtp_hdr_ext_type_from_uri (tokens[1], &type)) {
+      GST_DEBUG ("Extension '%s' negotiated with id %" G_GINT64_FORMAT,
+          tokens[1], id);
+      kms_rtp_hdr_ext_map_set_id (map, type, id);
+    }
+
+    g_strfreev (tokens);
+  }
+}
+
+void
+kms_rtp_hdr_ext_map_add_handler (KmsRtpHdrExtMap * map, guint types,
+    KmsRtpHdrExtFunc func, gpointer user_data, GDestroyNotify notify)
+{
+  KmsRtpHdrExtHandler *handler;
+
+  g_return_if_fail (func != NULL);
+
+  handler = g_slice_new0 (KmsRtpHdrExtHandler);
+  handler->types = types;
+  handler->func = func;
+  handler->user_data = user_data;
+  handler->notify = notify;
+
+  map->handlers = g_slist_append (map->handlers, handler);
+  map->handled_types |= types;
+}
+
+static void
+kms_rtp_hdr_ext_read_value (KmsRtpHdrExtType type, const guint8 * data,
+    guint len, KmsRtpHdrExtValues * values)
+{
+  switch (type) {
+    case KMS_RTP_HDR_EXT_ABS_SEND_TIME:
+      if (len != RTP_HDR_EXT_ABS_SEND_TIME_SIZE) {
+        return;
+      }
+      values->abs_send_time = GST_READ_UINT24_BE (data);
+      break;
+    case KMS_RTP_HDR_EXT_AUDIO_LEVEL:
+      if (len < 1) {
+        return;
+      }
+      values->voice_activity = (data[0] & 0x80) != 0;
+      values->audio_level = data[0] & 0x7F;
+      break;
+    case KMS_RTP_HDR_EXT_TRANSPORT_CC:
+      if (len < 2) {
+        return;
+      }
+      values->transport_seq = GST_READ_UINT16_BE (data);
+      break;
+    case KMS_RTP_HDR_EXT_MID:
+      values->mid = (const gchar *) data;
+      values->mid_len = len;
+      break;
+    case KMS_RTP_HDR_EXT_RID:
+      values->rid = (const gchar *) data;
+      values->rid_len = len;
+      break;
+    case KMS_RTP_HDR_EXT_REPAIRED_RID:
+      values->repaired_rid = (const gchar *) data;
+      values->repaired_rid_len = len;
+      break;
+    case KMS_RTP_HDR_EXT_VIDEO_ORIENTATION:
+      if (len < 1) {
+        return;
+      }
+      /* 0 0 0 0 C F R1 R0 */
+      values->camera_back = (data[0] & 0x08) != 0;
+      values->horizontal_flip = (data[0] & 0x04) != 0;
+      values->video_rotation = (data[0] & 0x03) * 90;
+      break;
+    default:
+      return;
+  }
+
+  values->present |= KMS_RTP_HDR_EXT_FLAG (type);
+}
+
+static void
+kms_rtp_hdr_ext_map_read_element (const KmsRtpHdrExtMap * map, guint8 id,
+    const guint8 * data, guint len, KmsRtpHdrExtValues * values)
+{
+  gint8 type = map->types[id];
+
+  if (type >= 0) {
+    kms_rtp_hdr_ext_read_value (type, data, len, values);
+  }
+}
+
+gboolean
+kms_rtp_hdr_ext_map_parse (const KmsRtpHdrExtMap * map, GstRTPBuffer * rtp,
+    KmsRtpHdrExtValues * values)
+{
+  const guint8 *data, *end;
+  gpointer ext_data;
+  guint16 bits;
+  guint wordlen;
+
+  values->present = 0;
+
+  if (!gst_rtp_buffer_get_extension_data (rtp, &bits, &ext_data, &wordlen)) {
+    return FALSE;
+  }
+
+  data = ext_data;
+  end = data + wordlen * 4;
+
+  /* Single pass over every element of the extension block */
+  if (bits == ONE_BYTE_PROFILE) {
+    while (data < end) {
+      guint8 id = data[0] >> 4;
+      guint len = (data[0] & 0x0F) + 1;
+
+      if (id == 0) {            /* padding */
+        data++;
+        continue;
+      }
+
+      if (id == ONE_BYTE_STOP_ID || data + 1 + len > end) {
+        break;
+      }
+
+      kms_rtp_hdr_ext_map_read_element (map, id, data + 1, len, values);
+      data += 1 + len;
+    }
+  } else if ((bits & TWO_BYTES_PROFILE_MASK) == TWO_BYTES_PROFILE) {
+    while (data < end) {
+      guint8 id = data[0];
+      guint len;
+
+      if (id == 0) {            /* padding */
+        data++;
+        continue;
+      }
+
+      if (data + 2 > end) {
+        break;
+      }
+
+      len = data[1];
+      if (data + 2 + len > end) {
+        break;
+      }
+
+      kms_rtp_hdr_ext_map_read_element (map, id, data + 2, len, values);
+      data += 2 + len;
+    }
+  }
+
+  return values->present != 0;
+}
+
+void
+kms_rtp_hdr_ext_map_process (const KmsRtpHdrExtMap * map, GstRTPBuffer * rtp)
+{
+  KmsRtpHdrExtValues values;
+  GSList *l;
+
+  if (map->handled_types == 0) {
+    return;
+  }
+
+  if (!kms_rtp_hdr_ext_map_parse (map, rtp, &values)) {
+    return;
+  }
+
+  if (!(values.present & map->handled_types)) {
+    return;
+  }
+
+  for (l = map->handlers; l != NULL; l = l->next) {
+    KmsRtpHdrExtHandler *handler = l->data;
+
+    if (handler->types & values.present) {
+      handler->func (&values, rtp, handler->user_data);
+    }
+  }
+}
+
+gboolean
+kms_rtp_hdr_ext_map_process_buffer (const KmsRtpHdrExtMap * map,
+    GstBuffer * buffer)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+
+  if (map->handled_types == 0) {
+    /* Nobody is interested, do not even map the buffer */
+    return TRUE;
+  }
+
+  if (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp)) {
+    GST_WARNING_OBJECT (buffer, "Buffer cannot be mapped as RTP");
+    return FALSE;
+  }
+
+  kms_rtp_hdr_ext_map_process (map, &rtp);
+  gst_rtp_buffer_unmap (&rtp);
+
+  return TRUE;
+}
+
+void
+kms_rtp_hdr_ext_abs_send_time_encode (GstClockTime time, guint8 data[3])
+{
+  GstClockTime ms;
+  guint value;
+
+  ms = GST_TIME_AS_MSECONDS (time);
+  value = (((ms << 18) / 1000) & 0x00ffffff);
+
+  data[0] = (guint8) (value >> 16);
+  data[1] = (guint8) (value >> 8);
+  data[2] = (guint8) (value);
+}
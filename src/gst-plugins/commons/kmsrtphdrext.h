@@ -0,0 +1,102 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __KMS_RTP_HDR_EXT_H__
+#define __KMS_RTP_HDR_EXT_H__
+
+#include <gst/gst.h>
+#include <gst/rtp/gstrtpbuffer.h>
+#include <gst/sdp/gstsdpmessage.h>
+
+G_BEGIN_DECLS
+
+/**
+ * KmsRtpHdrExtType:
+ *
+ * RTP header extensions known by the registry.
+ */
+typedef enum
+{
+  KMS_RTP_HDR_EXT_ABS_SEND_TIME,
+  KMS_RTP_HDR_EXT_AUDIO_LEVEL,          /* RFC 6464 */
+  KMS_RTP_HDR_EXT_TRANSPORT_CC,
+  KMS_RTP_HDR_EXT_MID,
+  KMS_RTP_HDR_EXT_RID,
+  KMS_RTP_HDR_EXT_REPAIRED_RID,
+  KMS_RTP_HDR_EXT_VIDEO_ORIENTATION,    /* 3GPP TS 26.114 (CVO) */
+  KMS_RTP_HDR_EXT_TYPES
+} KmsRtpHdrExtType;
+
+#define KMS_RTP_HDR_EXT_FLAG(type) (1 << (type))
+
+typedef struct _KmsRtpHdrExtMap KmsRtpHdrExtMap;
+typedef struct _KmsRtpHdrExtValues KmsRtpHdrExtValues;
+
+/*
+ * Typed values of the extensions found in one packet. Only the fields whose
+ * flag is set in @present are valid. SDES items point into the mapped
+ * packet, so they are only valid while it stays mapped.
+ */
+struct _KmsRtpHdrExtValues
+{
+  guint present;
+
+  guint32 abs_send_time;        /* 6.18 fixed point seconds */
+
+  gboolean voice_activity;
+  guint8 audio_level;           /* -dBov, 127 is silence */
+
+  guint16 transport_seq;
+
+  const gchar *mid;
+  guint mid_len;
+  const gchar *rid;
+  guint rid_len;
+  const gchar *repaired_rid;
+  guint repaired_rid_len;
+
+  guint video_rotation;         /* degrees */
+  gboolean camera_back;
+  gboolean horizontal_flip;
+};
+
+typedef void (*KmsRtpHdrExtFunc) (const KmsRtpHdrExtValues * values, GstRTPBuffer * rtp, gpointer user_data);
+
+const gchar * kms_rtp_hdr_ext_type_get_uri (KmsRtpHdrExtType type);
+gboolean kms_rtp_hdr_ext_type_from_uri (const gchar * uri, KmsRtpHdrExtType * type);
+
+/* KmsRtpHdrExtMap: negotiated ids plus the handlers interested in them.
+ * It is not locked, so configure it before data flows or protect it. */
+KmsRtpHdrExtMap * kms_rtp_hdr_ext_map_new (void);
+void kms_rtp_hdr_ext_map_free (KmsRtpHdrExtMap * map);
+
+void kms_rtp_hdr_ext_map_set_id (KmsRtpHdrExtMap * map, KmsRtpHdrExtType type, guint8 id);
+guint8 kms_rtp_hdr_ext_map_get_id (const KmsRtpHdrExtMap * map, KmsRtpHdrExtType type);
+void kms_rtp_hdr_ext_map_add_from_sdp_media (KmsRtpHdrExtMap * map, const GstSDPMedia * media);
+
+void kms_rtp_hdr_ext_map_add_handler (KmsRtpHdrExtMap * map, guint types, KmsRtpHdrExtFunc func, gpointer user_data, GDestroyNotify notify);
+
+gboolean kms_rtp_hdr_ext_map_parse (const KmsRtpHdrExtMap * map, GstRTPBuffer * rtp, KmsRtpHdrExtValues * values);
+void kms_rtp_hdr_ext_map_process (const KmsRtpHdrExtMap * map, GstRTPBuffer * rtp);
+gboolean kms_rtp_hdr_ext_map_process_buffer (const KmsRtpHdrExtMap * map, GstBuffer * buffer);
+
+/* Writers for outgoing packets */
+void kms_rtp_hdr_ext_abs_send_time_encode (GstClockTime time, guint8 data[3]);
+
+G_END_DECLS
+
+#endif /* __KMS_RTP_HDR_EXT_H__ */
@@ -21,6 +21,7 @@
 
 #include "kmsrtppaytreebin.h"
 #include "kmsutils.h"
+#include "kmsslaballocator.h"
 
 #define GST_DEFAULT_NAME "rtppaytreebin"
 #define GST_CAT_DEFAULT kms_rtp_pay_tree_bin_debug
@@ -100,6 +101,11 @@ kms_rtp_pay_tree_bin_configure (KmsRtpPayTreeBin * self, const GstCaps * caps)
   kms_utils_drop_until_keyframe (pad, TRUE);
   gst_object_unref (pad);
 
+  /* RTP packets are MTU sized, serve them from the slab allocator */
+  pad = gst_element_get_static_pad (pay, "src");
+  kms_slab_allocator_propose_on_pad (pad);
+  gst_object_unref (pad);
+
   gst_bin_add (GST_BIN (self), pay);
   gst_element_sync_state_with_parent (pay);
 
@@ -0,0 +1,576 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <string.h>
+
+#include "kmsslaballocator.h"
+#include "kmsmemoryaccount.h"
+
+#define GST_DEFAULT_NAME "kmsslaballocator"
+#define GST_CAT_DEFAULT kms_slab_allocator_debug
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+
+/* Size classes of 256, 512, 1024 and 2048 bytes */
+#define KMS_SLAB_MIN_SHIFT 8
+#define KMS_SLAB_CLASSES 4
+#define KMS_SLAB_SIZE(slab) ((gsize) 1 << (KMS_SLAB_MIN_SHIFT + (slab)))
+
+/* Free blocks move between threads in magazines of this many blocks */
+#define KMS_SLAB_MAGAZINE_SIZE 32
+
+/* Full magazines kept in the depot of each size class */
+#define KMS_SLAB_DEPOT_DEPTH 16
+
+typedef struct _KmsSlabMemory KmsSlabMemory;
+
+struct _KmsSlabMemory
+{
+  GstMemory mem;
+
+  guint8 *data;
+  /* Size class, -1 for memories shared from another one */
+  gint slab;
+  KmsMemoryAccount *account;
+};
+
+typedef struct _KmsSlabMagazine KmsSlabMagazine;
+
+struct _KmsSlabMagazine
+{
+  /* Next magazine while in the depot */
+  KmsSlabMagazine *next;
+  guint count;
+  KmsSlabMemory *blocks[KMS_SLAB_MAGAZINE_SIZE];
+};
+
+/*
+ * Magazines shared by all the threads. A thread that frees a whole
+ * magazine hands it over here and a thread that runs out of blocks takes
+ * one, so blocks freed by a consumer go back to the producer thread.
+ */
+typedef struct _KmsSlabDepot
+{
+  GMutex mutex;
+  KmsSlabMagazine *full;
+  guint n_full;
+  KmsSlabMagazine *empty;
+  guint n_empty;
+} KmsSlabDepot;
+
+typedef struct _KmsSlabCache
+{
+  KmsSlabMagazine *loaded[KMS_SLAB_CLASSES];
+
+  /* Only written by the owner thread, read by others with the __atomic
+   * builtins, GLib has no gsize atomics */
+  gsize hits;
+  gsize misses;
+  gssize in_use;
+  gssize cached;
+} KmsSlabCache;
+
+#define KMS_SLAB_CACHE_ADD(cache, stat, n) \
+  __atomic_store_n (&(cache)->stat, (cache)->stat + (n), __ATOMIC_RELAXED)
+
+static void kms_slab_cache_free (KmsSlabCache * cache);
+
+static GPrivate slab_cache = G_PRIVATE_INIT ((GDestroyNotify)
+    kms_slab_cache_free);
+
+static KmsSlabDepot depots[KMS_SLAB_CLASSES];
+
+/* Caches of live threads, and the totals of the ones already gone */
+static GMutex caches_mutex;
+static GList *caches;
+static KmsSlabCache retired;
+
+#define KMS_TYPE_SLAB_ALLOCATOR (kms_slab_allocator_get_type ())
+
+typedef struct _KmsSlabAllocator
+{
+  GstAllocator parent;
+
+  GstAllocator *sysmem;
+} KmsSlabAllocator;
+
+typedef struct _KmsSlabAllocatorClass
+{
+  GstAllocatorClass parent_class;
+} KmsSlabAllocatorClass;
+
+static GType kms_slab_allocator_get_type (void);
+
+G_DEFINE_TYPE (KmsSlabAllocator, kms_slab_allocator, GST_TYPE_ALLOCATOR);
+
+static void
+kms_slab_magazine_free (KmsSlabMagazine * mag)
+{
+  while (mag->count > 0) {
+    g_free (mag->blocks[--mag->count]);
+  }
+
+  g_slice_free (KmsSlabMagazine, mag);
+}
+
+/* FALSE if the depot has no room for it. Called with the depot lock */
+static gboolean
+kms_slab_depot_push_full (KmsSlabDepot * depot, KmsSlabMagazine * full)
+{
+  if (depot->n_full >= KMS_SLAB_DEPOT_DEPTH) {
+    return FALSE;
+  }
+
+  full->next = depot->full;
+  depot->full = full;
+  depot->n_full++;
+
+  return TRUE;
+}
+
+/* Takes a full magazine from the depot in exchange for the loaded one, which
+ * is empty. FALSE if the depot has none */
+static gboolean
+kms_slab_cache_reload (KmsSlabCache * cache, gint slab)
+{
+  KmsSlabDepot *depot = &depots[slab];
+  KmsSlabMagazine *full, *empty = cache->loaded[slab];
+
+  g_mutex_lock (&depot->mutex);
+
+  full = depot->full;
+
+  if (full == NULL) {
+    g_mutex_unlock (&depot->mutex);
+    return FALSE;
+  }
+
+  depot->full = full->next;
+  depot->n_full--;
+
+  if (empty != NULL && depot->n_empty < KMS_SLAB_DEPOT_DEPTH) {
+    empty->next = depot->empty;
+    depot->empty = empty;
+    depot->n_empty++;
+    empty = NULL;
+  }
+
+  g_mutex_unlock (&depot->mutex);
+
+  if (empty != NULL) {
+    g_slice_free (KmsSlabMagazine, empty);
+  }
+
+  cache->loaded[slab] = full;
+  KMS_SLAB_CACHE_ADD (cache, cached, full->count * KMS_SLAB_SIZE (slab));
+
+  return TRUE;
+}
+
+/* Gives the loaded magazine, if full, to the depot and loads an empty one.
+ * FALSE if the depot has no room for it */
+static gboolean
+kms_slab_cache_unload (KmsSlabCache * cache, gint slab)
+{
+  KmsSlabDepot *depot = &depots[slab];
+  KmsSlabMagazine *full = cache->loaded[slab], *empty;
+
+  g_mutex_lock (&depot->mutex);
+
+  if (full != NULL && !kms_slab_depot_push_full (depot, full)) {
+    g_mutex_unlock (&depot->mutex);
+    return FALSE;
+  }
+
+  empty = depot->empty;
+
+  if (empty != NULL) {
+    depot->empty = empty->next;
+    depot->n_empty--;
+  }
+
+  g_mutex_unlock (&depot->mutex);
+
+  if (full != NULL) {
+    KMS_SLAB_CACHE_ADD (cache, cached, -(gssize) (full->count *
+            KMS_SLAB_SIZE (slab)));
+  }
+
+  if (empty == NULL) {
+    empty = g_slice_new (KmsSlabMagazine);
+  }
+
+  empty->next = NULL;
+  empty->count = 0;
+  cache->loaded[slab] = empty;
+
+  return TRUE;
+}
+
+static KmsSlabCache *
+kms_slab_cache_get (void)
+{
+  KmsSlabCache *cache = g_private_get (&slab_cache);
+
+  if (G_UNLIKELY (cache == NULL)) {
+    cache = g_slice_new0 (KmsSlabCache);
+    g_private_set (&slab_cache, cache);
+
+    g_mutex_lock (&caches_mutex);
+    caches = g_list_prepend (caches, cache);
+    g_mutex_unlock (&caches_mutex);
+  }
+
+  return cache;
+}
+
+static void
+kms_slab_cache_free (KmsSlabCache * cache)
+{
+  KmsSlabMagazine *mag;
+  KmsSlabDepot *depot;
+  gint slab;
+
+  g_mutex_lock (&caches_mutex);
+  caches = g_list_remove (caches, cache);
+  retired.hits += cache->hits;
+  retired.misses += cache->misses;
+  retired.in_use += cache->in_use;
+  g_mutex_unlock (&caches_mutex);
+
+  /* Full magazines are still useful to other threads, the rest is trimmed */
+  for (slab = 0; slab < KMS_SLAB_CLASSES; slab++) {
+    depot = &depots[slab];
+    mag = cache->loaded[slab];
+
+    if (mag == NULL) {
+      continue;
+    }
+
+    if (mag->count == KMS_SLAB_MAGAZINE_SIZE) {
+      g_mutex_lock (&depot->mutex);
+
+      if (kms_slab_depot_push_full (depot, mag)) {
+        mag = NULL;
+      }
+
+      g_mutex_unlock (&depot->mutex);
+    }
+
+    if (mag != NULL) {
+      kms_slab_magazine_free (mag);
+    }
+  }
+
+  g_slice_free (KmsSlabCache, cache);
+}
+
+static gint
+kms_slab_size_class (gsize size)
+{
+  gint slab;
+
+  for (slab = 0; slab < KMS_SLAB_CLASSES; slab++) {
+    if (size <= KMS_SLAB_SIZE (slab)) {
+      return slab;
+    }
+  }
+
+  return -1;
+}
+
+static GstMemory *
+kms_slab_allocator_alloc (GstAllocator * allocator, gsize size,
+    GstAllocationParams * params)
+{
+  KmsSlabAllocator *self = (KmsSlabAllocator *) allocator;
+  gsize maxsize, align, aoffset;
+  KmsSlabMagazine *mag;
+  KmsSlabCache *cache;
+  KmsSlabMemory *mem;
+  guint8 *data;
+  gint slab;
+
+  maxsize = size + params->prefix + params->padding;
+  align = params->align | gst_memory_alignment;
+  slab = kms_slab_size_class (maxsize + align);
+
+  if (slab < 0) {
+    return gst_allocator_alloc (self->sysmem, size, params);
+  }
+
+  cache = kms_slab_cache_get ();
+  mag = cache->loaded[slab];
+
+  if ((mag != NULL && mag->count > 0) || kms_slab_cache_reload (cache, slab)) {
+    mag = cache->loaded[slab];
+    mem = mag->blocks[--mag->count];
+    KMS_SLAB_CACHE_ADD (cache, cached, -(gssize) KMS_SLAB_SIZE (slab));
+    KMS_SLAB_CACHE_ADD (cache, hits, 1);
+  } else {
+    mem = g_malloc (sizeof (KmsSlabMemory) + KMS_SLAB_SIZE (slab));
+    mem->slab = slab;
+    KMS_SLAB_CACHE_ADD (cache, misses, 1);
+  }
+
+  KMS_SLAB_CACHE_ADD (cache, in_use, KMS_SLAB_SIZE (slab));
+
+  data = (guint8 *) (mem + 1);
+
+  if ((aoffset = ((guintptr) data & align))) {
+    data += (align + 1) - aoffset;
+  }
+
+  gst_memory_init (GST_MEMORY_CAST (mem), params->flags, allocator, NULL,
+      maxsize, align, params->prefix, size);
+  mem->data = data;
+
+  if (params->prefix && (params->flags & GST_MEMORY_FLAG_ZERO_PREFIXED)) {
+    memset (data, 0, params->prefix);
+  }
+
+  if (params->padding && (params->flags & GST_MEMORY_FLAG_ZERO_PADDED)) {
+    memset (data + params->prefix + size, 0, params->padding);
+  }
+
+  /* Same accounting as system memory, see kmsmemoryaccount.h */
+  mem->account = kms_memory_account_get_current ();
+
+  if (mem->account != NULL) {
+    kms_memory_account_ref (mem->account);
+    kms_memory_account_charge (mem->account, KMS_SLAB_SIZE (slab));
+  }
+
+  return GST_MEMORY_CAST (mem);
+}
+
+static void
+kms_slab_allocator_free (GstAllocator * allocator, GstMemory * memory)
+{
+  KmsSlabMemory *mem = (KmsSlabMemory *) memory;
+  KmsSlabMagazine *mag;
+  KmsSlabCache *cache;
+  gint slab = mem->slab;
+
+  if (slab < 0) {
+    /* The parent is released by GstMemory */
+    g_slice_free (KmsSlabMemory, mem);
+    return;
+  }
+
+  if (mem->account != NULL) {
+    kms_memory_account_charge (mem->account, -(gssize) KMS_SLAB_SIZE (slab));
+    kms_memory_account_unref (mem->account);
+  }
+
+  cache = kms_slab_cache_get ();
+  KMS_SLAB_CACHE_ADD (cache, in_use, -(gssize) KMS_SLAB_SIZE (slab));
+  mag = cache->loaded[slab];
+
+  if ((mag == NULL || mag->count == KMS_SLAB_MAGAZINE_SIZE) &&
+      !kms_slab_cache_unload (cache, slab)) {
+    /* This thread and the depot are full */
+    g_free (mem);
+    return;
+  }
+
+  mag = cache->loaded[slab];
+  mag->blocks[mag->count++] = mem;
+  KMS_SLAB_CACHE_ADD (cache, cached, KMS_SLAB_SIZE (slab));
+}
+
+static gpointer
+kms_slab_memory_map (KmsSlabMemory * mem, gsize maxsize, GstMapFlags flags)
+{
+  return mem->data;
+}
+
+static void
+kms_slab_memory_unmap (KmsSlabMemory * mem)
+{
+}
+
+static KmsSlabMemory *
+kms_slab_memory_share (KmsSlabMemory * mem, gssize offset, gssize size)
+{
+  KmsSlabMemory *sub;
+  GstMemory *parent;
+
+  if (size == -1) {
+    size = mem->mem.size - offset;
+  }
+
+  if ((parent = mem->mem.parent) == NULL) {
+    parent = GST_MEMORY_CAST (mem);
+  }
+
+  sub = g_slice_new (KmsSlabMemory);
+  gst_memory_init (GST_MEMORY_CAST (sub),
+      GST_MINI_OBJECT_FLAGS (parent) | GST_MINI_OBJECT_FLAG_LOCK_READONLY,
+      mem->mem.allocator, parent, mem->mem.maxsize, mem->mem.align,
+      mem->mem.offset + offset, size);
+  sub->data = mem->data;
+  sub->slab = -1;
+  sub->account = NULL;
+
+  return sub;
+}
+
+static void
+kms_slab_allocator_finalize (GObject * object)
+{
+  KmsSlabAllocator *self = (KmsSlabAllocator *) object;
+
+  gst_object_unref (self->sysmem);
+
+  G_OBJECT_CLASS (kms_slab_allocator_parent_class)->finalize (object);
+}
+
+static void
+kms_slab_allocator_class_init (KmsSlabAllocatorClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstAllocatorClass *allocator_class = GST_ALLOCATOR_CLASS (klass);
+
+  gobject_class->finalize = kms_slab_allocator_finalize;
+
+  allocator_class->alloc = kms_slab_allocator_alloc;
+  allocator_class->free = kms_slab_allocator_free;
+
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, GST_DEFAULT_NAME, 0,
+      GST_DEFAULT_NAME);
+}
+
+static void
+kms_slab_allocator_init (KmsSlabAllocator * self)
+{
+  GstAllocator *allocator = GST_ALLOCATOR_CAST (self);
+
+  self->sysmem = gst_allocator_find (GST_ALLOCATOR_SYSMEM);
+
+  allocator->mem_type = KMS_SLAB_ALLOCATOR_NAME;
+  allocator->mem_map = (GstMemoryMapFunction) kms_slab_memory_map;
+  allocator->mem_unmap = (GstMemoryUnmapFunction) kms_slab_memory_unmap;
+  allocator->mem_share = (GstMemoryShareFunction) kms_slab_memory_share;
+  /* Copy and span use the GstAllocator fallbacks */
+}
+
+GstAllocator *
+kms_slab_allocator_get (void)
+{
+  static gsize init = 0;
+  static GstAllocator *allocator;
+
+  if (g_once_init_enter (&init)) {
+    allocator = g_object_new (KMS_TYPE_SLAB_ALLOCATOR, NULL);
+    gst_allocator_register (KMS_SLAB_ALLOCATOR_NAME,
+        gst_object_ref (allocator));
+
+    g_once_init_leave (&init, 1);
+  }
+
+  return allocator;
+}
+
+GstStructure *
+kms_slab_allocator_get_stats (void)
+{
+  guint64 hits, misses;
+  gint64 in_use, cached = 0;
+  gint slab;
+  GList *l;
+
+  g_mutex_lock (&caches_mutex);
+
+  hits = retired.hits;
+  misses = retired.misses;
+  in_use = retired.in_use;
+
+  for (l = caches; l != NULL; l = l->next) {
+    KmsSlabCache *cache = l->data;
+
+    hits += __atomic_load_n (&cache->hits, __ATOMIC_RELAXED);
+    misses += __atomic_load_n (&cache->misses, __ATOMIC_RELAXED);
+    in_use += __atomic_load_n (&cache->in_use, __ATOMIC_RELAXED);
+    cached += __atomic_load_n (&cache->cached, __ATOMIC_RELAXED);
+  }
+
+  g_mutex_unlock (&caches_mutex);
+
+  for (slab = 0; slab < KMS_SLAB_CLASSES; slab++) {
+    g_mutex_lock (&depots[slab].mutex);
+    cached += (gint64) depots[slab].n_full * KMS_SLAB_MAGAZINE_SIZE *
+        KMS_SLAB_SIZE (slab);
+    g_mutex_unlock (&depots[slab].mutex);
+  }
+
+  return gst_structure_new ("slab-allocator",
+      "hits", G_TYPE_UINT64, hits,
+      "misses", G_TYPE_UINT64, misses,
+      "bytes-in-use", G_TYPE_UINT64, (guint64) MAX (in_use, 0),
+      "bytes-cached", G_TYPE_UINT64, (guint64) MAX (cached, 0), NULL);
+}
+
+void
+kms_slab_allocator_add_to_query (GstQuery * query)
+{
+  GstAllocator *allocator = NULL;
+  GstAllocationParams params;
+
+  if (gst_query_get_n_allocation_params (query) == 0) {
+    gst_allocation_params_init (&params);
+    gst_query_add_allocation_param (query, kms_slab_allocator_get (),
+        &params);
+    return;
+  }
+
+  gst_query_parse_nth_allocation_param (query, 0, &allocator, &params);
+
+  if (allocator != NULL) {
+    /* Downstream needs its own memory */
+    gst_object_unref (allocator);
+    return;
+  }
+
+  gst_query_set_nth_allocation_param (query, 0, kms_slab_allocator_get (),
+      &params);
+}
+
+static GstPadProbeReturn
+kms_slab_allocator_query_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  GstQuery *query = GST_PAD_PROBE_INFO_QUERY (info);
+
+  /* Only once the query has been answered downstream */
+  if (GST_QUERY_TYPE (query) == GST_QUERY_ALLOCATION &&
+      (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_PULL)) {
+    GST_DEBUG_OBJECT (pad, "Proposing slab allocator");
+    kms_slab_allocator_add_to_query (query);
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+void
+kms_slab_allocator_propose_on_pad (GstPad * pad)
+{
+  /* Ensure the debug category is ready for the probe */
+  kms_slab_allocator_get ();
+
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_QUERY_DOWNSTREAM,
+      kms_slab_allocator_query_probe, NULL, NULL);
+}
@@ -0,0 +1,55 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __KMS_SLAB_ALLOCATOR_H__
+#define __KMS_SLAB_ALLOCATOR_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Allocator for packet sized memory. Memories up to
+ * KMS_SLAB_ALLOCATOR_MAX_SIZE bytes (including prefix, padding and
+ * alignment) come from a few size classes. Freed blocks are kept in a
+ * magazine of the freeing thread and reused by its next allocations, so the
+ * common case takes no lock and does not reach malloc. Full magazines go
+ * through a shared depot to the threads that ran out of blocks, which
+ * covers memory allocated on one thread and freed on another. Bigger
+ * memories are system ones.
+ */
+#define KMS_SLAB_ALLOCATOR_NAME "KmsSlab"
+#define KMS_SLAB_ALLOCATOR_MAX_SIZE 2048
+
+/* The allocator of the process, transfer none */
+GstAllocator * kms_slab_allocator_get (void);
+
+/* Structure with the allocations served from a cache (hits) and from
+ * malloc (misses), and the bytes of the blocks in use and cached. Values
+ * are approximate while other threads allocate */
+GstStructure * kms_slab_allocator_get_stats (void);
+
+/* Offers the allocator in an ALLOCATION query, unless downstream already
+ * asked for a specific one */
+void kms_slab_allocator_add_to_query (GstQuery * query);
+
+/* Offers the allocator in the ALLOCATION queries answered through pad */
+void kms_slab_allocator_propose_on_pad (GstPad * pad);
+
+G_END_DECLS
+
+#endif /* __KMS_SLAB_ALLOCATOR_H__ */
@@ -30,8 +30,14 @@ typedef struct _BufferLatencyValues
 {
   gboolean valid;
   KmsMediaType type;
+  /* Sampling state, only used from the streaming thread of the pad */
+  guint count;
+  GstClockTime last;
 } BufferLatencyValues;
 
+static volatile gint latency_sample_rate = 1;
+static volatile gint latency_sample_interval = 0;
+
 typedef struct _ProbeData ProbeData;
 typedef void (*BufferCb) (GstBuffer * buffer, ProbeData * pdata);
 
@@ -57,6 +63,8 @@ buffer_latency_values_new (gboolean is_valid, KmsMediaType type)
 
   blv->valid = is_valid;
   blv->type = type;
+  blv->count = 0;
+  blv->last = GST_CLOCK_TIME_NONE;
 
   return blv;
 }
@@ -164,6 +172,46 @@ kms_stats_get_element_stats (GstStructure * stats)
   return element_stats;
 }
 
+void
+kms_stats_set_latency_percentiles (GstStructure * latency, KmsHistogram * hist)
+{
+  gst_structure_set (latency,
+      "min", G_TYPE_UINT64, kms_histogram_get_min (hist),
+      "p50", G_TYPE_UINT64, kms_histogram_get_percentile (hist, 50),
+      "p90", G_TYPE_UINT64, kms_histogram_get_percentile (hist, 90),
+      "p99", G_TYPE_UINT64, kms_histogram_get_percentile (hist, 99),
+      "max", G_TYPE_UINT64, kms_histogram_get_max (hist), NULL);
+}
+
+void
+kms_stats_set_latency_sampling (guint rate, guint interval_ms)
+{
+  g_atomic_int_set (&latency_sample_rate, MAX (rate, 1));
+  g_atomic_int_set (&latency_sample_interval, interval_ms);
+}
+
+static gboolean
+buffer_latency_values_sample (BufferLatencyValues * blv, GstClockTime now)
+{
+  guint interval = g_atomic_int_get (&latency_sample_interval);
+  guint rate;
+
+  if (interval > 0) {
+    if (GST_CLOCK_TIME_IS_VALID (blv->last) &&
+        GST_CLOCK_DIFF (blv->last, now) < interval * GST_MSECOND) {
+      return FALSE;
+    }
+
+    blv->last = now;
+
+    return TRUE;
+  }
+
+  rate = g_atomic_int_get (&latency_sample_rate);
+
+  return rate <= 1 || blv->count++ % rate == 0;
+}
+
 static void
 buffer_latency_probe_cb (GstBuffer * buffer, ProbeData * pdata)
 {
@@ -172,6 +220,10 @@ buffer_latency_probe_cb (GstBuffer * buffer, ProbeData * pdata)
 
   time = kms_utils_get_time_nsecs ();
 
+  if (!buffer_latency_values_sample (blv, time)) {
+    return;
+  }
+
   kms_buffer_add_buffer_latency_meta (buffer, time, blv->valid, blv->type);
 }
 
@@ -216,6 +268,11 @@ buffer_for_each_meta_update_data_cb (GstBuffer * buffer, GstMeta ** meta,
 static void
 buffer_update_latency_probe_cb (GstBuffer * buffer, ProbeData * pdata)
 {
+  /* Unsampled buffers are discarded without walking all their metas */
+  if (kms_buffer_get_buffer_latency_meta (buffer) == NULL) {
+    return;
+  }
+
   gst_buffer_foreach_meta (buffer,
       (GstBufferForeachMetaFunc) buffer_for_each_meta_update_data_cb, pdata);
 }
@@ -282,6 +339,10 @@ buffer_for_each_meta_cb (GstBuffer * buffer, GstMeta ** meta, ProbeData * pdata)
 static void
 buffer_latency_calculation_cb (GstBuffer * buffer, ProbeData * pdata)
 {
+  if (kms_buffer_get_buffer_latency_meta (buffer) == NULL) {
+    return;
+  }
+
   gst_buffer_foreach_meta (buffer,
       (GstBufferForeachMetaFunc) buffer_for_each_meta_cb, pdata);
 }
@@ -378,6 +439,7 @@ kms_stats_create_id_for_pad (GstElement * obj, GstPad * pad)
 static void
 kms_stats_stream_e2e_avg_stat_destroy (StreamE2EAvgStat * stat)
 {
+  kms_histogram_free (stat->hist);
   g_slice_free (StreamE2EAvgStat, stat);
 }
 
@@ -390,6 +452,7 @@ kms_stats_stream_e2e_avg_stat_new (KmsMediaType type)
   kms_ref_struct_init (KMS_REF_STRUCT_CAST (stat),
       (GDestroyNotify) kms_stats_stream_e2e_avg_stat_destroy);
   stat->type = type;
+  stat->hist = kms_histogram_new ();
 
   return stat;
 }
@@ -21,6 +21,7 @@
 #include "kmsmediatype.h"
 #include "kmslist.h"
 #include "kmsrefstruct.h"
+#include "kmshistogram.h"
 
 G_BEGIN_DECLS
 
@@ -40,7 +41,15 @@ G_BEGIN_DECLS
 
 GstStructure * kms_stats_get_element_stats (GstStructure *stats);
 
+/* Adds min, p50, p90, p99 and max fields with the latencies in hist */
+void kms_stats_set_latency_percentiles (GstStructure *latency, KmsHistogram *hist);
+
 /* buffer latency */
+
+/* Only one of every rate buffers carries latency metadata, or one buffer per
+ * interval_ms milliseconds if interval_ms is not 0. Defaults to every buffer */
+void kms_stats_set_latency_sampling (guint rate, guint interval_ms);
+
 typedef void (*BufferLatencyCallback) (GstPad * pad, KmsMediaType type, GstClockTimeDiff t, KmsList *data, gpointer user_data);
 gulong kms_stats_add_buffer_latency_meta_probe (GstPad * pad, gboolean is_valid, KmsMediaType type);
 gulong kms_stats_add_buffer_update_latency_meta_probe (GstPad * pad, gboolean is_valid, KmsMediaType type);
@@ -61,6 +70,7 @@ typedef struct _StreamE2EAvgStat
   KmsRefStruct ref;
   KmsMediaType type;
   gdouble avg;
+  KmsHistogram *hist;
 } StreamE2EAvgStat;
 
 gchar * kms_stats_create_id_for_pad (GstElement * obj, GstPad * pad);
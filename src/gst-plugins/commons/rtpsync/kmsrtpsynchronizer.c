@@ -123,6 +123,18 @@ kms_rtp_synchronizer_new (KmsRtpSyncContext * context, gboolean feeded_sorted)
   return self;
 }
 
+guint32
+kms_rtp_synchronizer_get_ssrc (KmsRtpSynchronizer * self)
+{
+  guint32 ssrc;
+
+  KMS_RTP_SYNCHRONIZER_LOCK (self);
+  ssrc = self->priv->ssrc;
+  KMS_RTP_SYNCHRONIZER_UNLOCK (self);
+
+  return ssrc;
+}
+
 gboolean
 kms_rtp_synchronizer_add_clock_rate_for_pt (KmsRtpSynchronizer * self,
     gint32 pt, gint32 clock_rate, GError ** error)
@@ -163,7 +175,7 @@ end:
   return ret;
 }
 
-static void
+void
 kms_rtp_synchronizer_process_rtcp_packet (KmsRtpSynchronizer * self,
     GstRTCPPacket * packet, GstClockTime current_time)
 {
@@ -94,6 +94,9 @@ GType kms_rtp_synchronizer_get_type ();
 KmsRtpSynchronizer * kms_rtp_synchronizer_new (KmsRtpSyncContext * context,
                                                gboolean feeded_ordered);
 
+/* SSRC of the synchronized stream, 0 until its first RTP buffer */
+guint32 kms_rtp_synchronizer_get_ssrc (KmsRtpSynchronizer * self);
+
 gboolean kms_rtp_synchronizer_add_clock_rate_for_pt (KmsRtpSynchronizer * self,
                                                      gint32 pt,
                                                      gint32 clock_rate,
@@ -103,6 +106,9 @@ gboolean kms_rtp_synchronizer_process_rtcp_buffer (KmsRtpSynchronizer * self,
                                                    GstBuffer * buffer,
                                                    GstClockTime current_time,
                                                    GError ** error);
+void kms_rtp_synchronizer_process_rtcp_packet (KmsRtpSynchronizer * self,
+                                               GstRTCPPacket * packet,
+                                               GstClockTime current_time);
 
 gboolean kms_rtp_synchronizer_process_rtp_buffer_mapped (KmsRtpSynchronizer * self,
                                                          GstRTPBuffer * rtp_buffer,
@@ -32,6 +32,7 @@
 #include "kmsdummyrtp.h"
 #include "kmsdummysdp.h"
 #include "kmsdummyuri.h"
+#include "kmslatencytracer.h"
 
 static gboolean
 kurento_init (GstPlugin * kurento)
@@ -81,6 +82,9 @@ kurento_init (GstPlugin * kurento)
   if (!kms_dummy_uri_plugin_init (kurento))
     return FALSE;
 
+  if (!kms_latency_tracer_plugin_init (kurento))
+    return FALSE;
+
   return TRUE;
 }
 
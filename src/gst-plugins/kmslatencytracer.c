@@ -0,0 +1,309 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/gst.h>
+#include <string.h>
+#include "kmslatencytracer.h"
+#include "kmselement.h"
+#include "kmstreebin.h"
+#include "kmsagnosticbin.h"
+#include "kmshistogram.h"
+
+#define PLUGIN_NAME "kmslatency"
+
+GST_DEBUG_CATEGORY_STATIC (kms_latency_tracer_debug_category);
+#define GST_CAT_DEFAULT kms_latency_tracer_debug_category
+
+#define ENTRIES_QUARK \
+  (g_quark_from_static_string ("kms-latency-tracer-entries"))
+#define STREAM_QUARK \
+  (g_quark_from_static_string ("kms-latency-tracer-stream"))
+
+/* Stream of pads of elements with a single input */
+#define SINGLE_STREAM 0
+
+/* Buffers remembered per element, enough to cover queues and fan-out */
+#define MAX_ENTRIES 128
+
+G_DEFINE_TYPE_WITH_CODE (KmsLatencyTracer, kms_latency_tracer,
+    GST_TYPE_TRACER,
+    GST_DEBUG_CATEGORY_INIT (kms_latency_tracer_debug_category, PLUGIN_NAME,
+        0, "debug category for kmslatency tracer"));
+
+typedef struct _KmsLatencyEntry
+{
+  guint stream;
+  GstClockTime pts;
+  GstClockTime ts;
+} KmsLatencyEntry;
+
+typedef struct _KmsLatencyEntries
+{
+  GMutex mutex;
+  guint next;
+  KmsLatencyEntry entries[MAX_ENTRIES];
+} KmsLatencyEntries;
+
+static GMutex entries_mutex;
+
+static KmsLatencyEntries *
+kms_latency_entries_new (void)
+{
+  KmsLatencyEntries *entries;
+  guint i;
+
+  entries = g_slice_new0 (KmsLatencyEntries);
+  g_mutex_init (&entries->mutex);
+
+  for (i = 0; i < MAX_ENTRIES; i++) {
+    entries->entries[i].pts = GST_CLOCK_TIME_NONE;
+  }
+
+  return entries;
+}
+
+static void
+kms_latency_entries_free (KmsLatencyEntries * entries)
+{
+  g_mutex_clear (&entries->mutex);
+  g_slice_free (KmsLatencyEntries, entries);
+}
+
+static KmsLatencyEntries *
+kms_latency_entries_get (GstElement * element)
+{
+  KmsLatencyEntries *entries;
+
+  entries = g_object_get_qdata (G_OBJECT (element), ENTRIES_QUARK);
+
+  if (entries != NULL) {
+    return entries;
+  }
+
+  g_mutex_lock (&entries_mutex);
+
+  entries = g_object_get_qdata (G_OBJECT (element), ENTRIES_QUARK);
+
+  if (entries == NULL) {
+    entries = kms_latency_entries_new ();
+    g_object_set_qdata_full (G_OBJECT (element), ENTRIES_QUARK, entries,
+        (GDestroyNotify) kms_latency_entries_free);
+  }
+
+  g_mutex_unlock (&entries_mutex);
+
+  return entries;
+}
+
+static gboolean
+is_tracked_element (GstObject * object)
+{
+  return object != NULL && (KMS_IS_ELEMENT (object) ||
+      KMS_IS_TREE_BIN (object) || KMS_IS_AGNOSTIC_BIN2 (object));
+}
+
+/* KmsElement pads are named after their media type (sink_video_default,
+ * video_src_default_0...), so audio and video buffers with the same
+ * timestamp are told apart. Other tracked elements have a single input */
+static guint
+compute_pad_stream (GstPad * pad, GstObject * parent)
+{
+  const gchar *name;
+  guint stream = SINGLE_STREAM;
+
+  if (!KMS_IS_ELEMENT (parent)) {
+    return stream;
+  }
+
+  GST_OBJECT_LOCK (pad);
+  name = GST_OBJECT_NAME (pad);
+
+  if (g_str_has_prefix (name, "sink_")) {
+    name += strlen ("sink_");
+  }
+
+  if (g_str_has_prefix (name, "audio")) {
+    stream = KMS_ELEMENT_PAD_TYPE_AUDIO + 1;
+  } else if (g_str_has_prefix (name, "video")) {
+    stream = KMS_ELEMENT_PAD_TYPE_VIDEO + 1;
+  } else if (g_str_has_prefix (name, "data")) {
+    stream = KMS_ELEMENT_PAD_TYPE_DATA + 1;
+  }
+
+  GST_OBJECT_UNLOCK (pad);
+
+  return stream;
+}
+
+static guint
+get_pad_stream (GstPad * pad, GstObject * parent)
+{
+  gpointer stream;
+
+  /* Cached shifted by one, so NULL means not computed yet */
+  stream = g_object_get_qdata (G_OBJECT (pad), STREAM_QUARK);
+
+  if (stream == NULL) {
+    stream = GUINT_TO_POINTER (compute_pad_stream (pad, parent) + 1);
+    /* Streaming threads may race here; all of them compute the same value,
+     * so only the first one needs to store it */
+    g_object_replace_qdata (G_OBJECT (pad), STREAM_QUARK, NULL, stream, NULL,
+        NULL);
+  }
+
+  return GPOINTER_TO_UINT (stream) - 1;
+}
+
+static GstClockTime
+get_buffer_time (GstBuffer * buffer)
+{
+  if (GST_BUFFER_PTS_IS_VALID (buffer)) {
+    return GST_BUFFER_PTS (buffer);
+  }
+
+  return GST_BUFFER_DTS (buffer);
+}
+
+static void
+buffer_enters (GstElement * element, guint stream, GstClockTime pts,
+    GstClockTime ts)
+{
+  KmsLatencyEntries *entries = kms_latency_entries_get (element);
+
+  g_mutex_lock (&entries->mutex);
+  entries->entries[entries->next].stream = stream;
+  entries->entries[entries->next].pts = pts;
+  entries->entries[entries->next].ts = ts;
+  entries->next = (entries->next + 1) % MAX_ENTRIES;
+  g_mutex_unlock (&entries->mutex);
+}
+
+static void
+buffer_leaves (GstElement * element, guint stream, GstClockTime pts,
+    GstClockTime ts)
+{
+  KmsLatencyEntries *entries;
+  GstClockTime entered = GST_CLOCK_TIME_NONE;
+  guint i, pos;
+
+  entries = g_object_get_qdata (G_OBJECT (element), ENTRIES_QUARK);
+
+  if (entries == NULL) {
+    /* Buffers generated inside the element, nothing to measure */
+    return;
+  }
+
+  g_mutex_lock (&entries->mutex);
+
+  /* Newest first. Entries are not removed because a buffer that entered
+   * once may leave through several branches */
+  for (i = 1; i <= MAX_ENTRIES; i++) {
+    pos = (entries->next + MAX_ENTRIES - i) % MAX_ENTRIES;
+
+    if (entries->entries[pos].pts == pts &&
+        entries->entries[pos].stream == stream) {
+      entered = entries->entries[pos].ts;
+      break;
+    }
+  }
+
+  g_mutex_unlock (&entries->mutex);
+
+  if (!GST_CLOCK_TIME_IS_VALID (entered) || ts < entered) {
+    return;
+  }
+
+  kms_histogram_record (kms_processing_latency_get (element, TRUE),
+      ts - entered);
+}
+
+static void
+kms_latency_tracer_buffer_pushed (GstClockTime ts, GstPad * pad,
+    GstBuffer * buffer)
+{
+  GstObject *parent;
+  GstPad *peer;
+  GstClockTime pts;
+
+  pts = get_buffer_time (buffer);
+
+  if (!GST_CLOCK_TIME_IS_VALID (pts)) {
+    return;
+  }
+
+  /* Ghost pads make this work for bins: buffers enter through the push
+   * into the sink ghost pad and leave through the push from the src one */
+  parent = GST_OBJECT_PARENT (pad);
+  if (is_tracked_element (parent)) {
+    buffer_leaves (GST_ELEMENT (parent), get_pad_stream (pad, parent), pts,
+        ts);
+  }
+
+  peer = GST_PAD_PEER (pad);
+  if (peer == NULL) {
+    return;
+  }
+
+  parent = GST_OBJECT_PARENT (peer);
+  if (is_tracked_element (parent)) {
+    buffer_enters (GST_ELEMENT (parent), get_pad_stream (peer, parent), pts,
+        ts);
+  }
+}
+
+static void
+do_push_buffer_pre (GstTracer * self, GstClockTime ts, GstPad * pad,
+    GstBuffer * buffer)
+{
+  kms_latency_tracer_buffer_pushed (ts, pad, buffer);
+}
+
+static void
+do_push_buffer_list_pre (GstTracer * self, GstClockTime ts, GstPad * pad,
+    GstBufferList * list)
+{
+  if (gst_buffer_list_length (list) == 0) {
+    return;
+  }
+
+  kms_latency_tracer_buffer_pushed (ts, pad, gst_buffer_list_get (list, 0));
+}
+
+static void
+kms_latency_tracer_class_init (KmsLatencyTracerClass * klass)
+{
+}
+
+static void
+kms_latency_tracer_init (KmsLatencyTracer * self)
+{
+  GstTracer *tracer = GST_TRACER (self);
+
+  gst_tracing_register_hook (tracer, "pad-push-pre",
+      G_CALLBACK (do_push_buffer_pre));
+  gst_tracing_register_hook (tracer, "pad-push-list-pre",
+      G_CALLBACK (do_push_buffer_list_pre));
+}
+
+gboolean
+kms_latency_tracer_plugin_init (GstPlugin * plugin)
+{
+  return gst_tracer_register (plugin, PLUGIN_NAME, KMS_TYPE_LATENCY_TRACER);
+}
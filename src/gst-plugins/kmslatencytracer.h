@@ -0,0 +1,73 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef _KMS_LATENCY_TRACER_H_
+#define _KMS_LATENCY_TRACER_H_
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+#define KMS_TYPE_LATENCY_TRACER (kms_latency_tracer_get_type())
+#define KMS_LATENCY_TRACER(obj) (               \
+  G_TYPE_CHECK_INSTANCE_CAST (                  \
+    (obj),                                      \
+    KMS_TYPE_LATENCY_TRACER,                    \
+    KmsLatencyTracer                            \
+  )                                             \
+)
+#define KMS_LATENCY_TRACER_CLASS(klass) (       \
+  G_TYPE_CHECK_CLASS_CAST (                     \
+    (klass),                                    \
+    KMS_TYPE_LATENCY_TRACER,                    \
+    KmsLatencyTracerClass                       \
+  )                                             \
+)
+#define KMS_IS_LATENCY_TRACER(obj) (            \
+  G_TYPE_CHECK_INSTANCE_TYPE (                  \
+    (obj),                                      \
+    KMS_TYPE_LATENCY_TRACER                     \
+    )                                           \
+)
+#define KMS_IS_LATENCY_TRACER_CLASS(klass) (    \
+  G_TYPE_CHECK_CLASS_TYPE (                     \
+  (klass),                                      \
+  KMS_TYPE_LATENCY_TRACER                       \
+  )                                             \
+)
+typedef struct _KmsLatencyTracer KmsLatencyTracer;
+typedef struct _KmsLatencyTracerClass KmsLatencyTracerClass;
+
+/*
+ * Records the time each buffer spends inside KmsElements, tree bins and
+ * agnosticbins in their processing latency histograms (see kmshistogram.h).
+ * Enabled with GST_TRACERS=kmslatency.
+ */
+struct _KmsLatencyTracer
+{
+  GstTracer parent;
+};
+
+struct _KmsLatencyTracerClass
+{
+  GstTracerClass parent_class;
+};
+
+GType kms_latency_tracer_get_type (void);
+
+gboolean kms_latency_tracer_plugin_init (GstPlugin * plugin);
+
+G_END_DECLS
+#endif
@@ -15,23 +15,141 @@
  *
  */
 
+#include <gst/gst.h>
+
 #include "EventHandler.hpp"
+#include <MediaObjectImpl.hpp>
 #include <WorkerPool.hpp>
+#include "Metrics.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#define GST_CAT_DEFAULT kurento_event_handler
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+#define GST_DEFAULT_NAME "KurentoEventHandler"
+
+const size_t EVENT_DISPATCH_MAX_SHARDS = 8;
+const uint64_t EVENT_DISPATCH_WARN_LATENCY_US = 1000000;
 
 namespace kurento
 {
 
-static void
-post_task (std::function <void () > cb)
+/*
+ * Events are dispatched by a set of single threaded shards. Every object
+ * of a pipeline is assigned to the same shard, so events of a session keep
+ * their order while different sessions are dispatched in parallel.
+ */
+class EventDispatcher
+{
+public:
+  EventDispatcher ()
+  {
+    size_t n = std::thread::hardware_concurrency ();
+
+    n = std::max<size_t> (1, std::min (n, EVENT_DISPATCH_MAX_SHARDS) );
+
+    for (size_t i = 0; i < n; i++) {
+      shards.push_back (std::unique_ptr<Shard> (new Shard () ) );
+    }
+
+    GST_INFO ("Dispatching events with %" G_GSIZE_FORMAT " shards", n);
+  }
+
+  size_t getShard (const std::string &key)
+  {
+    return std::hash<std::string>() (key) % shards.size ();
+  }
+
+  void post (size_t shardIndex, std::function <void () > cb)
+  {
+    Shard *shard = shards[shardIndex % shards.size ()].get ();
+    auto posted = std::chrono::steady_clock::now ();
+
+    shard->queueDepth++;
+
+    shard->workers.post ([shard, posted, cb] () {
+      uint64_t latency = std::chrono::duration_cast<std::chrono::microseconds>
+                         (std::chrono::steady_clock::now () - posted).count ();
+      uint64_t max = shard->maxLatencyUs;
+
+      shard->queueDepth--;
+      shard->dispatched++;
+      shard->totalLatencyUs += latency;
+
+      while (latency > max &&
+             !shard->maxLatencyUs.compare_exchange_weak (max, latency) ) {
+      }
+
+      if (latency > EVENT_DISPATCH_WARN_LATENCY_US) {
+        GST_WARNING ("Event dispatched %" G_GUINT64_FORMAT " us after being "
+                     "posted, %" G_GSIZE_FORMAT " events still queued", latency,
+                     (gsize) shard->queueDepth);
+      }
+
+      cb ();
+    });
+  }
+
+  std::vector<EventDispatchStats> getStats ()
+  {
+    std::vector<EventDispatchStats> stats;
+
+    for (auto &shard : shards) {
+      EventDispatchStats s;
+
+      s.queueDepth = shard->queueDepth;
+      s.dispatched = shard->dispatched;
+      s.totalLatencyUs = shard->totalLatencyUs;
+      s.maxLatencyUs = shard->maxLatencyUs;
+      stats.push_back (s);
+    }
+
+    return stats;
+  }
+
+private:
+  struct Shard {
+    Shard () : workers (1) {}
+
+    WorkerPool workers;
+    std::atomic<size_t> queueDepth {0};
+    std::atomic<uint64_t> dispatched {0};
+    std::atomic<uint64_t> totalLatencyUs {0};
+    std::atomic<uint64_t> maxLatencyUs {0};
+  };
+
+  std::vector<std::unique_ptr<Shard>> shards;
+};
+
+static EventDispatcher &
+get_dispatcher ()
+{
+  static EventDispatcher dispatcher;
+
+  return dispatcher;
+}
+
+static std::string
+get_shard_key (std::shared_ptr <MediaObjectImpl> object)
 {
-  static WorkerPool workers (1);
+  std::string id;
+
+  if (!object) {
+    return id;
+  }
 
-  workers.post (cb);
+  /* Children ids are prefixed with the id of their pipeline */
+  id = object->getId ();
+
+  return id.substr (0, id.find ('/') );
 }
 
 EventHandler::EventHandler (std::shared_ptr <MediaObjectImpl> object) :
   object (object)
 {
+  shard = get_dispatcher ().getShard (get_shard_key (object) );
 }
 
 EventHandler::~EventHandler()
@@ -49,7 +167,41 @@ EventHandler::~EventHandler()
 void
 EventHandler::sendEventAsync  (std::function <void () > cb)
 {
-  post_task (cb);
+  get_dispatcher ().post (shard, cb);
+}
+
+std::vector<EventDispatchStats>
+EventHandler::getDispatchStats ()
+{
+  return get_dispatcher ().getStats ();
+}
+
+EventHandler::StaticConstructor EventHandler::staticConstructor;
+
+EventHandler::StaticConstructor::StaticConstructor()
+{
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, GST_DEFAULT_NAME, 0,
+                           GST_DEFAULT_NAME);
+
+  MetricsRegistry::getRegistry ().addCollector ([] (MetricsWriter & writer) {
+    std::vector<EventDispatchStats> stats = getDispatchStats ();
+
+    for (size_t i = 0; i < stats.size (); i++) {
+      std::string labels = "shard=\"" + std::to_string (i) + "\"";
+
+      writer.gauge ("kms_event_queue_depth",
+                    "Events posted to the shard and not yet dispatched",
+                    stats[i].queueDepth, labels);
+      writer.counter ("kms_events_dispatched_total",
+                      "Events dispatched by the shard", stats[i].dispatched, labels);
+      writer.counter ("kms_event_dispatch_latency_seconds_total",
+                      "Time from post to dispatch of the shard events",
+                      stats[i].totalLatencyUs / 1000000.0, labels);
+      writer.gauge ("kms_event_dispatch_latency_max_seconds",
+                    "Longest time from post to dispatch of a shard event",
+                    stats[i].maxLatencyUs / 1000000.0, labels);
+    }
+  });
 }
 
 } /* kurento */
@@ -23,12 +23,24 @@
 #include <string>
 #include <json/json.h>
 #include <functional>
+#include <vector>
+#include <cstdint>
 
 namespace kurento
 {
 
 class MediaObjectImpl;
 
+struct EventDispatchStats {
+  /* Events posted to the shard and not yet run */
+  size_t queueDepth;
+  /* Events already run by the shard */
+  uint64_t dispatched;
+  /* Time from post to run, in microseconds */
+  uint64_t totalLatencyUs;
+  uint64_t maxLatencyUs;
+};
+
 class EventHandler : public std::enable_shared_from_this<EventHandler>
 {
 public:
@@ -44,9 +56,21 @@ public:
     this->conn = conn;
   }
 
+  /* Returns the metrics of every dispatch shard */
+  static std::vector<EventDispatchStats> getDispatchStats ();
+
 private:
   std::weak_ptr<MediaObjectImpl> object;
   sigc::connection conn;
+  size_t shard;
+
+  class StaticConstructor
+  {
+  public:
+    StaticConstructor();
+  };
+
+  static StaticConstructor staticConstructor;
 };
 
 } /* kurento */
@@ -21,7 +21,9 @@
 #include <KurentoException.hpp>
 #include <MediaPipelineImpl.hpp>
 #include <ServerManagerImpl.hpp>
+#include "Metrics.hpp"
 
+#include <algorithm>
 #include <functional>
 
 /* This is included to avoid problems with slots and lamdas */
@@ -34,6 +36,11 @@ GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
 
 const int MEDIASET_THREADS_DEFAULT = 1;
 
+/* Session expiry is checked this many times per collector interval */
+const int COLLECTOR_TICKS = 8;
+/* Expired sessions released at once while holding the lock */
+const size_t SESSION_EXPIRY_BATCH = 32;
+
 namespace kurento
 {
 
@@ -114,26 +121,32 @@ MediaSet::deleteMediaSet()
 
 void MediaSet::doGarbageCollection ()
 {
-  std::unique_lock <std::recursive_mutex> lock (recMutex);
-  auto sessions = sessionInUse;
+  std::vector<std::string> expired = registry.expireSessions ();
 
-  lock.unlock();
+  GST_LOG ("Running garbage collector, %zu sessions expired", expired.size () );
 
-  GST_DEBUG ("Running garbage collector");
+  for (size_t i = 0; i < expired.size (); i += SESSION_EXPIRY_BATCH) {
+    size_t end = std::min (expired.size (), i + SESSION_EXPIRY_BATCH);
+    std::unique_lock <std::recursive_mutex> lock (recMutex);
+
+    if (terminated) {
+      return;
+    }
 
-  for (auto it : sessions) {
-    if (it.second) {
-      lock.lock();
-      sessionInUse[it.first] = false;
-      lock.unlock();
-    } else {
-      GST_WARNING ("Session timeout: %s", it.first.c_str() );
-      unrefSession (it.first);
+    for (size_t j = i; j < end; j++) {
+      GST_WARNING ("Session timeout: %s", expired[j].c_str() );
+      unrefSession (expired[j]);
     }
+
+    lock.unlock ();
+    std::this_thread::yield ();
   }
 }
 
-MediaSet::MediaSet()
+/* Sessions expire two collector intervals after their last keepalive. The
+ * old collector let them live between one and two intervals, so clients
+ * sending keepalives once per interval are never dropped */
+MediaSet::MediaSet() : registry (2 * COLLECTOR_TICKS)
 {
   terminated = false;
 
@@ -141,38 +154,89 @@ MediaSet::MediaSet()
       MEDIASET_THREADS_DEFAULT) );
 
   thread = std::thread ( [&] () {
-    std::unique_lock <std::recursive_mutex> lock (recMutex);
-
+    std::unique_lock <std::mutex> lock (collectorMutex);
 
     while (!terminated && waitCond.wait_for (lock,
-           collectorInterval) == std::cv_status::timeout) {
+           std::chrono::duration_cast<std::chrono::milliseconds>
+           (collectorInterval) / COLLECTOR_TICKS) == std::cv_status::timeout) {
 
       if (terminated) {
         return;
       }
 
+      lock.unlock ();
+
       try {
         doGarbageCollection();
       } catch (...) {
         GST_ERROR ("Error during garbage collection");
       }
+
+      lock.lock ();
     }
 
   });
+
+  metricsCollector = MetricsRegistry::getRegistry ().addCollector ([this] (
+  MetricsWriter & writer) {
+    std::unique_lock <std::recursive_mutex> lock (recMutex);
+    std::vector<double> bounds;
+    WorkerPoolStats stats;
+    double sum = 0;
+
+    writer.gauge ("kms_mediaset_objects", "Media objects alive",
+                  registry.size () );
+    writer.gauge ("kms_mediaset_sessions", "Sessions referencing objects",
+                  sessionMap.size () );
+
+    if (!workers) {
+      return;
+    }
+
+    stats = workers->getStats ();
+    lock.unlock ();
+
+    for (int i = 0; i < WorkerPool::LATENCY_BUCKETS - 1; i++) {
+      bounds.push_back ( (1 << i) / 1000000.0);
+    }
+
+    writer.gauge ("kms_workerpool_queue_depth",
+                  "Tasks posted to the media set workers and not yet started",
+                  stats.queueDepth);
+    writer.counter ("kms_workerpool_tasks_total",
+                    "Tasks run by the media set workers", stats.executed);
+    writer.counter ("kms_workerpool_steals_total",
+                    "Tasks run by a worker other than the one they were queued to",
+                    stats.steals);
+
+    /* The pool does not track the sum, approximate it with lower bounds */
+    for (size_t i = 1; i < stats.latencyHistogram.size (); i++) {
+      sum += stats.latencyHistogram[i] * bounds[i - 1];
+    }
+
+    writer.histogram ("kms_workerpool_task_latency_seconds",
+                      "Time from post to run of media set tasks", bounds,
+                      stats.latencyHistogram, sum);
+  });
 }
 
 MediaSet::~MediaSet ()
 {
+  /* Before taking recMutex, a running scrape may be waiting for it */
+  MetricsRegistry::getRegistry ().removeCollector (metricsCollector);
+
   std::unique_lock <std::recursive_mutex> lock (recMutex);
 
-  if (!objectsMap.empty() ) {
-    GST_DEBUG ("Still %zu object/s alive", objectsMap.size() );
+  if (registry.size () > 0) {
+    GST_DEBUG ("Still %zu object/s alive", registry.size () );
   }
 
+  std::unique_lock <std::mutex> collectorLock (collectorMutex);
   terminated = true;
+  waitCond.notify_all();
+  collectorLock.unlock ();
 
   serverManager.reset();
-  waitCond.notify_all();
 
   lock.unlock();
 
@@ -236,7 +300,9 @@ MediaSet::ref (MediaObjectImpl *mediaObjectPtr)
     this->releasePointer (obj);
   });
 
-  objectsMap[mediaObject->getId()] = std::weak_ptr<MediaObjectImpl> (mediaObject);
+  registry.add (mediaObject->getId(),
+                std::weak_ptr<MediaObjectImpl> (mediaObject),
+                !!std::dynamic_pointer_cast <MediaPipelineImpl> (mediaObject) );
 
   if (mediaObject->getParent() ) {
     std::shared_ptr<MediaObjectImpl> parent = std::dynamic_pointer_cast
@@ -248,14 +314,15 @@ MediaSet::ref (MediaObjectImpl *mediaObjectPtr)
   auto parent = mediaObject->getParent();
 
   if (parent) {
-    for (auto session : reverseSessionMap[parent->getId()]) {
+    for (auto session : registry.getSessions (parent->getId() ) ) {
       ref (session, mediaObject);
     }
   }
 
   mediaObject->postConstructor ();
 
-  if (this->serverManager) {
+  if (this->serverManager
+      && !serverManager->signalObjectCreated.empty () ) {
     lock.unlock ();
     serverManager->signalObjectCreated (ObjectCreated (this->serverManager,
                                         std::dynamic_pointer_cast<MediaObject> (mediaObject) ) );
@@ -268,9 +335,17 @@ void
 MediaSet::ref (const std::string &sessionId,
                std::shared_ptr<MediaObjectImpl> mediaObject)
 {
+  std::string id = mediaObject->getId();
+
+  /* Already referenced by this session, so are its parents */
+  if (registry.hasSession (id, sessionId) ) {
+    keepAliveSession (sessionId, true);
+    return;
+  }
+
   std::unique_lock <std::recursive_mutex> lock (recMutex);
 
-  if (objectsMap.find (mediaObject->getId() ) == objectsMap.end() ) {
+  if (!registry.contains (id) ) {
     throw KurentoException (MEDIA_OBJECT_NOT_FOUND,
                             "Cannot register media object, it was not created by MediaSet");
   }
@@ -282,8 +357,8 @@ MediaSet::ref (const std::string &sessionId,
          std::dynamic_pointer_cast<MediaObjectImpl> (mediaObject->getParent() ) );
   }
 
-  sessionMap[sessionId][mediaObject->getId()] = mediaObject;
-  reverseSessionMap[mediaObject->getId()].insert (sessionId);
+  sessionMap[sessionId][id] = mediaObject;
+  registry.addSession (id, sessionId);
 }
 
 void
@@ -304,18 +379,8 @@ MediaSet::keepAliveSession (const std::string &sessionId)
 void
 MediaSet::keepAliveSession (const std::string &sessionId, bool create)
 {
-  std::unique_lock <std::recursive_mutex> lock (recMutex);
-
-  auto it = sessionInUse.find (sessionId);
-
-  if (it == sessionInUse.end() ) {
-    if (create) {
-      sessionInUse[sessionId] = true;
-    } else {
-      throw KurentoException (INVALID_SESSION, "Invalid session");
-    }
-  } else {
-    it->second = true;
+  if (!registry.touchSession (sessionId, create) ) {
+    throw KurentoException (INVALID_SESSION, "Invalid session");
   }
 }
 
@@ -335,7 +400,7 @@ MediaSet::releaseSession (const std::string &sessionId)
   }
 
   sessionMap.erase (sessionId);
-  sessionInUse.erase (sessionId);
+  registry.eraseSession (sessionId);
   eventHandler.erase (sessionId);
   lock.unlock ();
 
@@ -357,17 +422,27 @@ MediaSet::unrefSession (const std::string &sessionId)
   }
 
   sessionMap.erase (sessionId);
-  sessionInUse.erase (sessionId);
+  registry.eraseSession (sessionId);
   eventHandler.erase (sessionId);
 
   lock.unlock();
 }
 
 static void
-call_release (std::shared_ptr<MediaObjectImpl> mediaObject)
+call_release (std::vector<std::shared_ptr<MediaObjectImpl>> mediaObjects)
 {
-  if (mediaObject) {
-    mediaObject->release();
+  /* Pipelines are released first so that their elements find the pipeline
+   * tearing down and skip the per connection cleanup */
+  for (auto mediaObject : mediaObjects) {
+    if (std::dynamic_pointer_cast<MediaPipelineImpl> (mediaObject) ) {
+      mediaObject->release();
+    }
+  }
+
+  for (auto mediaObject : mediaObjects) {
+    if (!std::dynamic_pointer_cast<MediaPipelineImpl> (mediaObject) ) {
+      mediaObject->release();
+    }
   }
 }
 
@@ -386,7 +461,24 @@ MediaSet::unref (const std::string &sessionId,
                  std::shared_ptr< MediaObjectImpl > mediaObject)
 {
   std::unique_lock <std::recursive_mutex> lock (recMutex);
-  bool released = false;
+  std::vector<std::shared_ptr<MediaObjectImpl>> released;
+
+  unrefTree (sessionId, mediaObject, released);
+
+  /* A whole tree is released in one task */
+  if (!released.empty () ) {
+    post (std::bind (call_release, std::move (released) ) );
+  }
+
+  lock.unlock();
+}
+
+void
+MediaSet::unrefTree (const std::string &sessionId,
+                     std::shared_ptr< MediaObjectImpl > mediaObject,
+                     std::vector<std::shared_ptr<MediaObjectImpl>> &released)
+{
+  bool objectReleased = false;
 
   if (!mediaObject) {
     return;
@@ -408,23 +500,13 @@ MediaSet::unref (const std::string &sessionId,
     auto childMap = childrenIt->second;
 
     for (auto child : childMap) {
-      unref (sessionId, child.second);
+      unrefTree (sessionId, child.second, released);
     }
   }
 
-  auto it3 = reverseSessionMap.find (mediaObject->getId() );
-
-  if (it3 != reverseSessionMap.end() ) {
-    it3->second.erase (sessionId);
-
-    if (it3->second.empty() ) {
-      released = true;
-    }
-  } else {
-    released = true;
-  }
+  objectReleased = registry.removeSession (mediaObject->getId(), sessionId);
 
-  if (released && !isServerManager (mediaObject) ) {
+  if (objectReleased && !isServerManager (mediaObject) ) {
     std::shared_ptr<MediaObjectImpl> parent;
     parent = std::dynamic_pointer_cast<MediaObjectImpl> (mediaObject->getParent() );
 
@@ -441,11 +523,9 @@ MediaSet::unref (const std::string &sessionId,
     eventIt->second.erase (mediaObject->getId() );
   }
 
-  if (released) {
-    post (std::bind (call_release, mediaObject) );
+  if (objectReleased) {
+    released.push_back (mediaObject);
   }
-
-  lock.unlock();
 }
 
 void
@@ -476,11 +556,12 @@ void MediaSet::releasePointer (MediaObjectImpl *mediaObject)
   std::unique_lock <std::recursive_mutex> lock (recMutex);
   std::string id = mediaObject->getId();
 
-  objectsMap.erase (id );
+  registry.remove (id);
 
   post (std::bind (async_delete, mediaObject, id) );
 
-  if (this->serverManager && !terminated) {
+  if (this->serverManager && !terminated
+      && !serverManager->signalObjectDestroyed.empty () ) {
     serverManager->signalObjectDestroyed (ObjectDestroyed (this->serverManager,
                                           id) );
   }
@@ -494,14 +575,8 @@ void MediaSet::release (std::shared_ptr< MediaObjectImpl > mediaObject)
 {
   std::unique_lock <std::recursive_mutex> lock (recMutex);
 
-  auto it = reverseSessionMap.find (mediaObject->getId() );
-
-  if (it == reverseSessionMap.end() ) {
-    /* Already released */
-    return;
-  }
-
-  auto sessions = it->second;
+  /* Nothing to do if it is already released */
+  auto sessions = registry.getSessions (mediaObject->getId() );
 
   for (auto it2 : sessions) {
     unref (it2, mediaObject);
@@ -535,30 +610,18 @@ MediaSet::getMediaObject (const std::string &mediaObjectRef)
   }
 
   std::shared_ptr <MediaObjectImpl> objectLocked;
-  std::unique_lock <std::recursive_mutex> lock (recMutex);
-
-  auto it = objectsMap.find (mediaObjectRef);
-
-  if (it == objectsMap.end() ) {
-    throw KurentoException (MEDIA_OBJECT_NOT_FOUND,
-                            "Object '" + mediaObjectRef + "' not found");
-  }
+  bool referenced;
 
-  try {
-    objectLocked = it->second.lock();
-  } catch (...) {
-    throw KurentoException (MEDIA_OBJECT_NOT_FOUND,
-                            "Object '" + mediaObjectRef + "' not found");
-  }
+  objectLocked = registry.get (mediaObjectRef, referenced);
 
   if (!objectLocked) {
     throw KurentoException (MEDIA_OBJECT_NOT_FOUND,
                             "Object '" + mediaObjectRef + "' not found");
   }
 
-  auto it2 = reverseSessionMap.find (objectLocked->getId() );
+  if (!referenced) {
+    std::unique_lock <std::recursive_mutex> lock (recMutex);
 
-  if (it2 == reverseSessionMap.end() || it2->second.empty() ) {
     if (serverManager && mediaObjectRef == serverManager->getId() ) {
       return serverManager;
     }
@@ -627,9 +690,9 @@ MediaSet::empty()
   std::unique_lock <std::recursive_mutex> lock (recMutex);
 
   if (serverManager) {
-    return objectsMap.size () == 1;
+    return registry.size () == 1;
   } else {
-    return objectsMap.empty();
+    return registry.size () == 0;
   }
 }
 
@@ -649,20 +712,18 @@ MediaSet::getSessions ()
 std::list<std::shared_ptr<MediaObjectImpl>>
     MediaSet::getPipelines (const std::string &sessionId)
 {
-  std::unique_lock <std::recursive_mutex> lock (recMutex);
   std::list<std::shared_ptr<MediaObjectImpl>> ret;
 
-  auto copy = objectsMap;
-
-  for (auto it : copy) {
-    try {
-      auto obj = getMediaObject (sessionId, it.first);
-
-      if (std::dynamic_pointer_cast <MediaPipelineImpl> (obj) ) {
-        ret.push_back (obj);
+  for (auto obj : registry.getPipelines () ) {
+    if (!sessionId.empty () ) {
+      try {
+        ref (sessionId, obj);
+      } catch (KurentoException &e) {
+        continue;
       }
-    } catch (KurentoException &e) {
     }
+
+    ret.push_back (obj);
   }
 
   return ret;
@@ -29,6 +29,7 @@
 #include <atomic>
 
 #include "WorkerPool.hpp"
+#include "ObjectRegistry.hpp"
 
 namespace kurento
 {
@@ -97,6 +98,9 @@ private:
   std::thread thread;
 
   void releasePointer (MediaObjectImpl *obj);
+  void unrefTree (const std::string &sessionId,
+                  std::shared_ptr<MediaObjectImpl> mediaObject,
+                  std::vector<std::shared_ptr<MediaObjectImpl>> &released);
 
   void checkEmpty ();
   bool isServerManager (std::shared_ptr< MediaObjectImpl > mediaObject);
@@ -106,12 +110,15 @@ private:
   MediaSet ();
 
   std::recursive_mutex recMutex;
-  std::condition_variable_any waitCond;
+  std::mutex collectorMutex;
+  std::condition_variable waitCond;
   std::atomic<bool> terminated;
 
   std::shared_ptr <ServerManagerImpl> serverManager;
 
-  std::map<std::string, std::weak_ptr <MediaObjectImpl>> objectsMap;
+  /* Objects, the sessions referencing them and session liveness. Lookups
+   * only take the registry shard lock, recMutex serializes updates */
+  ObjectRegistry registry;
 
   std::map<std::string, std::map <std::string, std::shared_ptr <MediaObjectImpl>>>
   childrenMap;
@@ -119,14 +126,13 @@ private:
   std::map<std::string, std::map <std::string, std::shared_ptr<MediaObjectImpl>>>
   sessionMap;
 
-  std::map<std::string, bool> sessionInUse;
   std::map<std::string, std::map<std::string, std::map<std::string, std::shared_ptr<EventHandler>>>>
   eventHandler;
 
-  std::map<std::string, std::unordered_set<std::string>> reverseSessionMap;
-
   std::shared_ptr<WorkerPool> workers;
 
+  int metricsCollector;
+
   static std::chrono::seconds collectorInterval;
 
   class StaticConstructor
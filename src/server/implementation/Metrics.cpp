@@ -0,0 +1,373 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <gst/gst.h>
+#include "Metrics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#define GST_CAT_DEFAULT kurento_metrics
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+#define GST_DEFAULT_NAME "KurentoMetrics"
+
+namespace kurento
+{
+
+static std::string
+format_value (double value)
+{
+  std::ostringstream ss;
+
+  if (std::isinf (value) ) {
+    return value > 0 ? "+Inf" : "-Inf";
+  }
+
+  ss.precision (15);
+  ss << value;
+
+  return ss.str ();
+}
+
+static std::string
+format_labels (const std::string &labels, const std::string &extra = "")
+{
+  if (labels.empty () && extra.empty () ) {
+    return "";
+  }
+
+  if (labels.empty () || extra.empty () ) {
+    return "{" + labels + extra + "}";
+  }
+
+  return "{" + labels + "," + extra + "}";
+}
+
+MetricHistogram::MetricHistogram (const std::vector<double> &bounds) :
+  bounds (bounds), buckets (new std::atomic<uint64_t>[bounds.size () + 1]),
+  count (0), sum (0)
+{
+  std::sort (this->bounds.begin (), this->bounds.end () );
+
+  for (size_t i = 0; i <= bounds.size (); i++) {
+    buckets[i] = 0;
+  }
+}
+
+void
+MetricHistogram::observe (double value)
+{
+  size_t bucket = std::lower_bound (bounds.begin (), bounds.end (), value) -
+                  bounds.begin ();
+  double current = sum.load (std::memory_order_relaxed);
+
+  buckets[bucket].fetch_add (1, std::memory_order_relaxed);
+  count.fetch_add (1, std::memory_order_relaxed);
+
+  while (!sum.compare_exchange_weak (current, current + value,
+                                     std::memory_order_relaxed) ) {
+  }
+}
+
+std::string &
+MetricsWriter::samples (const std::string &name, const std::string &help,
+                        const std::string &type)
+{
+  Family &family = families[name];
+
+  if (family.type.empty () ) {
+    family.help = help;
+    family.type = type;
+  }
+
+  return family.samples;
+}
+
+void
+MetricsWriter::counter (const std::string &name, const std::string &help,
+                        double value, const std::string &labels)
+{
+  samples (name, help, "counter") += name + format_labels (labels) + " " +
+                                     format_value (value) + "\n";
+}
+
+void
+MetricsWriter::gauge (const std::string &name, const std::string &help,
+                      double value, const std::string &labels)
+{
+  samples (name, help, "gauge") += name + format_labels (labels) + " " +
+                                   format_value (value) + "\n";
+}
+
+void
+MetricsWriter::histogram (const std::string &name, const std::string &help,
+                          const std::vector<double> &bounds,
+                          const std::vector<uint64_t> &counts, double sum, const std::string &labels)
+{
+  std::string &out = samples (name, help, "histogram");
+  uint64_t cumulative = 0;
+
+  for (size_t i = 0; i < counts.size (); i++) {
+    double bound = i < bounds.size () ? bounds[i] : INFINITY;
+
+    cumulative += counts[i];
+    out += name + "_bucket" + format_labels (labels,
+           "le=\"" + format_value (bound) + "\"") + " " +
+           std::to_string (cumulative) + "\n";
+  }
+
+  out += name + "_sum" + format_labels (labels) + " " + format_value (sum) +
+         "\n";
+  out += name + "_count" + format_labels (labels) + " " +
+         std::to_string (cumulative) + "\n";
+}
+
+void
+MetricsWriter::summary (const std::string &name, const std::string &help,
+                        const std::vector<std::pair<double, double>> &quantiles, uint64_t count,
+                        double sum, const std::string &labels)
+{
+  std::string &out = samples (name, help, "summary");
+
+  for (auto &quantile : quantiles) {
+    out += name + format_labels (labels,
+                                 "quantile=\"" + format_value (quantile.first) + "\"") + " " +
+           format_value (quantile.second) + "\n";
+  }
+
+  out += name + "_sum" + format_labels (labels) + " " + format_value (sum) +
+         "\n";
+  out += name + "_count" + format_labels (labels) + " " +
+         std::to_string (count) + "\n";
+}
+
+std::string
+MetricsWriter::str ()
+{
+  std::string out;
+
+  for (auto &it : families) {
+    out += "# HELP " + it.first + " " + it.second.help + "\n";
+    out += "# TYPE " + it.first + " " + it.second.type + "\n";
+    out += it.second.samples;
+  }
+
+  return out;
+}
+
+MetricsRegistry::MetricsRegistry () : nextCollector (1)
+{
+}
+
+MetricsRegistry &
+MetricsRegistry::getRegistry ()
+{
+  static MetricsRegistry registry;
+
+  return registry;
+}
+
+MetricsRegistry::Metric &
+MetricsRegistry::getMetric (const std::string &name, const std::string &help,
+                            const std::string &labels)
+{
+  Metric &metric = metrics[name + format_labels (labels)];
+
+  if (metric.name.empty () ) {
+    metric.name = name;
+    metric.help = help;
+    metric.labels = labels;
+  }
+
+  return metric;
+}
+
+std::shared_ptr<MetricCounter>
+MetricsRegistry::getCounter (const std::string &name, const std::string &help,
+                             const std::string &labels)
+{
+  std::unique_lock<std::mutex> lock (mutex);
+  Metric &metric = getMetric (name, help, labels);
+
+  if (!metric.counter) {
+    metric.counter = std::make_shared<MetricCounter> ();
+  }
+
+  return metric.counter;
+}
+
+std::shared_ptr<MetricGauge>
+MetricsRegistry::getGauge (const std::string &name, const std::string &help,
+                           const std::string &labels)
+{
+  std::unique_lock<std::mutex> lock (mutex);
+  Metric &metric = getMetric (name, help, labels);
+
+  if (!metric.gauge) {
+    metric.gauge = std::make_shared<MetricGauge> ();
+  }
+
+  return metric.gauge;
+}
+
+std::shared_ptr<MetricHistogram>
+MetricsRegistry::getHistogram (const std::string &name,
+                               const std::string &help, const std::vector<double> &bounds,
+                               const std::string &labels)
+{
+  std::unique_lock<std::mutex> lock (mutex);
+  Metric &metric = getMetric (name, help, labels);
+
+  if (!metric.histogram) {
+    metric.histogram = std::make_shared<MetricHistogram> (bounds);
+  }
+
+  return metric.histogram;
+}
+
+int
+MetricsRegistry::addCollector (Collector collector)
+{
+  std::unique_lock<std::mutex> lock (collectorsMutex);
+  int id = nextCollector++;
+
+  collectors[id] = collector;
+
+  return id;
+}
+
+void
+MetricsRegistry::removeCollector (int id)
+{
+  std::unique_lock<std::mutex> lock (collectorsMutex);
+
+  collectors.erase (id);
+}
+
+std::string
+MetricsRegistry::scrape ()
+{
+  MetricsWriter writer;
+  std::unique_lock<std::mutex> lock (mutex);
+
+  for (auto &it : metrics) {
+    Metric &metric = it.second;
+
+    if (metric.counter) {
+      writer.counter (metric.name, metric.help, metric.counter->get (),
+                      metric.labels);
+    } else if (metric.gauge) {
+      writer.gauge (metric.name, metric.help, metric.gauge->get (),
+                    metric.labels);
+    } else if (metric.histogram) {
+      std::vector<uint64_t> counts;
+
+      for (size_t i = 0; i <= metric.histogram->bounds.size (); i++) {
+        counts.push_back (metric.histogram->buckets[i].load (
+                            std::memory_order_relaxed) );
+      }
+
+      writer.histogram (metric.name, metric.help, metric.histogram->bounds,
+                        counts, metric.histogram->sum.load (std::memory_order_relaxed),
+                        metric.labels);
+    }
+  }
+
+  lock.unlock ();
+
+  std::unique_lock<std::mutex> collectorsLock (collectorsMutex);
+
+  for (auto &it : collectors) {
+    try {
+      it.second (writer);
+    } catch (std::exception &e) {
+      GST_WARNING ("Error collecting metrics: %s", e.what () );
+    }
+  }
+
+  collectorsLock.unlock ();
+
+  return writer.str ();
+}
+
+MetricsExporter::MetricsExporter (const std::string &path,
+                                  std::chrono::milliseconds interval) : path (path), interval (interval),
+  stop (false)
+{
+  thread = std::thread ( [this] () {
+    std::unique_lock<std::mutex> lock (mutex);
+
+    while (!stop) {
+      lock.unlock ();
+      write ();
+      lock.lock ();
+
+      cond.wait_for (lock, this->interval, [this] () {
+        return stop;
+      });
+    }
+  });
+
+  GST_INFO ("Exporting metrics to %s every %lld ms", path.c_str (),
+            (long long) interval.count () );
+}
+
+MetricsExporter::~MetricsExporter ()
+{
+  std::unique_lock<std::mutex> lock (mutex);
+
+  stop = true;
+  cond.notify_all ();
+  lock.unlock ();
+
+  if (thread.joinable () ) {
+    thread.join ();
+  }
+}
+
+void
+MetricsExporter::write ()
+{
+  std::string tmpPath = path + ".tmp";
+  std::ofstream file (tmpPath, std::ios::trunc);
+
+  file << MetricsRegistry::getRegistry ().scrape ();
+  file.close ();
+
+  if (file.fail () ) {
+    GST_WARNING ("Cannot write metrics to %s", tmpPath.c_str () );
+    return;
+  }
+
+  /* Readers never see a half written file */
+  if (std::rename (tmpPath.c_str (), path.c_str () ) != 0) {
+    GST_WARNING ("Cannot replace metrics file %s", path.c_str () );
+  }
+}
+
+MetricsRegistry::StaticConstructor MetricsRegistry::staticConstructor;
+
+MetricsRegistry::StaticConstructor::StaticConstructor()
+{
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, GST_DEFAULT_NAME, 0,
+                           GST_DEFAULT_NAME);
+}
+
+} // kurento
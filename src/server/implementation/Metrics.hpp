@@ -0,0 +1,223 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __METRICS_HPP__
+#define __METRICS_HPP__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace kurento
+{
+
+/* Counters, gauges and histograms are updated with relaxed atomics only, so
+ * they can be used from streaming threads. State read by collectors keeps
+ * its own synchronization, which may be a lock (as the KmsHistogram behind
+ * the REMB estimates histogram) */
+
+class MetricCounter
+{
+public:
+  MetricCounter () : value (0) {}
+
+  void inc (uint64_t n = 1)
+  {
+    value.fetch_add (n, std::memory_order_relaxed);
+  }
+
+  uint64_t get ()
+  {
+    return value.load (std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<uint64_t> value;
+};
+
+class MetricGauge
+{
+public:
+  MetricGauge () : value (0) {}
+
+  void set (int64_t v)
+  {
+    value.store (v, std::memory_order_relaxed);
+  }
+
+  void add (int64_t n)
+  {
+    value.fetch_add (n, std::memory_order_relaxed);
+  }
+
+  int64_t get ()
+  {
+    return value.load (std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<int64_t> value;
+};
+
+class MetricHistogram
+{
+public:
+  /* Upper bounds of the buckets, in increasing order. Values above the last
+   * one go to an implicit +Inf bucket */
+  MetricHistogram (const std::vector<double> &bounds);
+
+  void observe (double value);
+
+private:
+  std::vector<double> bounds;
+  std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+  std::atomic<uint64_t> count;
+  std::atomic<double> sum;
+
+  friend class MetricsRegistry;
+};
+
+/*
+ * Renders metrics in the Prometheus text exposition format. Samples of the
+ * same metric are grouped under a single HELP and TYPE header. Labels are
+ * given already formatted, as in: shard="0",type="video"
+ */
+class MetricsWriter
+{
+public:
+  void counter (const std::string &name, const std::string &help,
+                double value, const std::string &labels = "");
+  void gauge (const std::string &name, const std::string &help, double value,
+              const std::string &labels = "");
+  /* Counts of each bucket (not cumulative), the last one is the +Inf bucket */
+  void histogram (const std::string &name, const std::string &help,
+                  const std::vector<double> &bounds, const std::vector<uint64_t> &counts,
+                  double sum, const std::string &labels = "");
+  /* Quantiles as (quantile, value) pairs */
+  void summary (const std::string &name, const std::string &help,
+                const std::vector<std::pair<double, double>> &quantiles, uint64_t count,
+                double sum, const std::string &labels = "");
+
+  std::string str ();
+
+private:
+  struct Family {
+    std::string help;
+    std::string type;
+    std::string samples;
+  };
+
+  std::string &samples (const std::string &name, const std::string &help,
+                        const std::string &type);
+
+  std::map<std::string, Family> families;
+};
+
+/*
+ * Metrics of the process. Components either keep the counters, gauges and
+ * histograms created here and update them as things happen, or add a
+ * collector that reads their current state on every scrape.
+ */
+class MetricsRegistry
+{
+public:
+  typedef std::function<void (MetricsWriter &) > Collector;
+
+  static MetricsRegistry &getRegistry ();
+
+  /* Asking twice for the same name and labels returns the same metric */
+  std::shared_ptr<MetricCounter> getCounter (const std::string &name,
+      const std::string &help, const std::string &labels = "");
+  std::shared_ptr<MetricGauge> getGauge (const std::string &name,
+                                         const std::string &help, const std::string &labels = "");
+  std::shared_ptr<MetricHistogram> getHistogram (const std::string &name,
+      const std::string &help, const std::vector<double> &bounds,
+      const std::string &labels = "");
+
+  /* Collectors run on the scraping thread. removeCollector waits for a
+   * running scrape, so do not call it holding locks the collector takes */
+  int addCollector (Collector collector);
+  void removeCollector (int id);
+
+  /* All the metrics in Prometheus text format */
+  std::string scrape ();
+
+private:
+  MetricsRegistry ();
+
+  struct Metric {
+    std::string name;
+    std::string help;
+    std::string labels;
+    std::shared_ptr<MetricCounter> counter;
+    std::shared_ptr<MetricGauge> gauge;
+    std::shared_ptr<MetricHistogram> histogram;
+  };
+
+  Metric &getMetric (const std::string &name, const std::string &help,
+                     const std::string &labels);
+
+  std::mutex mutex;
+  std::map<std::string, Metric> metrics;
+
+  std::mutex collectorsMutex;
+  std::map<int, Collector> collectors;
+  int nextCollector;
+
+  class StaticConstructor
+  {
+  public:
+    StaticConstructor();
+  };
+
+  static StaticConstructor staticConstructor;
+};
+
+/*
+ * Periodically writes a scrape of the registry to a file, replacing it
+ * atomically, for a node exporter textfile collector or a local agent.
+ */
+class MetricsExporter
+{
+public:
+  MetricsExporter (const std::string &path, std::chrono::milliseconds interval);
+  ~MetricsExporter ();
+
+private:
+  void write ();
+
+  std::string path;
+  std::chrono::milliseconds interval;
+
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool stop;
+  std::thread thread;
+};
+
+} // kurento
+
+#endif /* __METRICS_HPP__ */
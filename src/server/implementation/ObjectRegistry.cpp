@@ -0,0 +1,347 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "ObjectRegistry.hpp"
+
+#include <algorithm>
+#include <functional>
+
+namespace kurento
+{
+
+class ReadLock
+{
+public:
+  ReadLock (GRWLock *lock) : lock (lock)
+  {
+    g_rw_lock_reader_lock (lock);
+  }
+
+  ~ReadLock ()
+  {
+    g_rw_lock_reader_unlock (lock);
+  }
+
+private:
+  GRWLock *lock;
+};
+
+class WriteLock
+{
+public:
+  WriteLock (GRWLock *lock) : lock (lock)
+  {
+    g_rw_lock_writer_lock (lock);
+  }
+
+  ~WriteLock ()
+  {
+    g_rw_lock_writer_unlock (lock);
+  }
+
+private:
+  GRWLock *lock;
+};
+
+ObjectRegistry::ObjectRegistry (uint64_t sessionTimeoutTicks) : count (0),
+  sessionTimeoutTicks (std::min<uint64_t> (sessionTimeoutTicks,
+                       WHEEL_SLOTS - 1) ), currentTick (0)
+{
+  for (size_t i = 0; i < SHARDS; i++) {
+    g_rw_lock_init (&shards[i].lock);
+  }
+
+  g_rw_lock_init (&pipelinesLock);
+}
+
+ObjectRegistry::~ObjectRegistry ()
+{
+  for (size_t i = 0; i < SHARDS; i++) {
+    g_rw_lock_clear (&shards[i].lock);
+  }
+
+  g_rw_lock_clear (&pipelinesLock);
+}
+
+ObjectRegistry::Shard &
+ObjectRegistry::getShard (const std::string &id)
+{
+  return shards[std::hash<std::string>() (id) % SHARDS];
+}
+
+void
+ObjectRegistry::add (const std::string &id,
+                     std::weak_ptr<MediaObjectImpl> object, bool pipeline)
+{
+  Shard &shard = getShard (id);
+  WriteLock lock (&shard.lock);
+  auto it = shard.entries.find (id);
+
+  if (it == shard.entries.end () ) {
+    shard.entries[id].object = object;
+    count++;
+  } else {
+    it->second.object = object;
+  }
+
+  if (pipeline) {
+    WriteLock pipelinesWriteLock (&pipelinesLock);
+
+    pipelines[id] = object;
+  }
+}
+
+void
+ObjectRegistry::remove (const std::string &id)
+{
+  Shard &shard = getShard (id);
+  WriteLock lock (&shard.lock);
+
+  if (shard.entries.erase (id) > 0) {
+    count--;
+
+    WriteLock pipelinesWriteLock (&pipelinesLock);
+
+    pipelines.erase (id);
+  }
+}
+
+bool
+ObjectRegistry::contains (const std::string &id)
+{
+  Shard &shard = getShard (id);
+  ReadLock lock (&shard.lock);
+
+  return shard.entries.find (id) != shard.entries.end ();
+}
+
+std::shared_ptr<MediaObjectImpl>
+ObjectRegistry::get (const std::string &id, bool &referenced)
+{
+  Shard &shard = getShard (id);
+  ReadLock lock (&shard.lock);
+  auto it = shard.entries.find (id);
+
+  referenced = false;
+
+  if (it == shard.entries.end () ) {
+    return std::shared_ptr<MediaObjectImpl> ();
+  }
+
+  referenced = !it->second.sessions.empty ();
+
+  return it->second.object.lock ();
+}
+
+bool
+ObjectRegistry::hasSession (const std::string &id,
+                            const std::string &sessionId)
+{
+  Shard &shard = getShard (id);
+  ReadLock lock (&shard.lock);
+  auto it = shard.entries.find (id);
+
+  return it != shard.entries.end ()
+         && it->second.sessions.find (sessionId) != it->second.sessions.end ();
+}
+
+void
+ObjectRegistry::addSession (const std::string &id,
+                            const std::string &sessionId)
+{
+  Shard &shard = getShard (id);
+  WriteLock lock (&shard.lock);
+  auto it = shard.entries.find (id);
+
+  if (it != shard.entries.end () ) {
+    it->second.sessions.insert (sessionId);
+  }
+}
+
+bool
+ObjectRegistry::removeSession (const std::string &id,
+                               const std::string &sessionId)
+{
+  Shard &shard = getShard (id);
+  WriteLock lock (&shard.lock);
+  auto it = shard.entries.find (id);
+
+  if (it == shard.entries.end () ) {
+    return true;
+  }
+
+  it->second.sessions.erase (sessionId);
+
+  return it->second.sessions.empty ();
+}
+
+std::unordered_set<std::string>
+ObjectRegistry::getSessions (const std::string &id)
+{
+  Shard &shard = getShard (id);
+  ReadLock lock (&shard.lock);
+  auto it = shard.entries.find (id);
+
+  if (it == shard.entries.end () ) {
+    return std::unordered_set<std::string> ();
+  }
+
+  return it->second.sessions;
+}
+
+std::vector<std::string>
+ObjectRegistry::getIds ()
+{
+  std::vector<std::string> ids;
+
+  for (size_t i = 0; i < SHARDS; i++) {
+    ReadLock lock (&shards[i].lock);
+
+    for (auto &it : shards[i].entries) {
+      ids.push_back (it.first);
+    }
+  }
+
+  return ids;
+}
+
+std::vector<std::shared_ptr<MediaObjectImpl>>
+ObjectRegistry::getPipelines ()
+{
+  std::vector<std::pair<std::string, std::shared_ptr<MediaObjectImpl>>> alive;
+  std::vector<std::shared_ptr<MediaObjectImpl>> ret;
+
+  {
+    ReadLock lock (&pipelinesLock);
+
+    for (auto &it : pipelines) {
+      std::shared_ptr<MediaObjectImpl> pipeline = it.second.lock ();
+
+      if (pipeline) {
+        alive.push_back (std::make_pair (it.first, pipeline) );
+      }
+    }
+  }
+
+  /* Shard locks cannot be taken while holding the pipelines lock */
+  for (auto &it : alive) {
+    Shard &shard = getShard (it.first);
+    ReadLock lock (&shard.lock);
+    auto entry = shard.entries.find (it.first);
+
+    if (entry != shard.entries.end () && !entry->second.sessions.empty () ) {
+      ret.push_back (it.second);
+    }
+  }
+
+  return ret;
+}
+
+size_t
+ObjectRegistry::size ()
+{
+  return count;
+}
+
+void
+ObjectRegistry::schedule (const std::string &sessionId, uint64_t deadline)
+{
+  std::unique_lock <std::mutex> lock (wheelMutex);
+
+  wheel[deadline % WHEEL_SLOTS].insert (sessionId);
+}
+
+bool
+ObjectRegistry::touchSession (const std::string &sessionId, bool create)
+{
+  Shard &shard = getShard (sessionId);
+  uint64_t deadline = currentTick + sessionTimeoutTicks;
+
+  {
+    ReadLock lock (&shard.lock);
+    auto it = shard.sessionDeadlines.find (sessionId);
+
+    if (it != shard.sessionDeadlines.end () ) {
+      /* The slot is updated lazily, when the old deadline is reached */
+      it->second = deadline;
+      return true;
+    }
+  }
+
+  if (!create) {
+    return false;
+  }
+
+  WriteLock lock (&shard.lock);
+  auto it = shard.sessionDeadlines.find (sessionId);
+
+  if (it != shard.sessionDeadlines.end () ) {
+    it->second = deadline;
+    return true;
+  }
+
+  shard.sessionDeadlines[sessionId] = deadline;
+  schedule (sessionId, deadline);
+
+  return true;
+}
+
+void
+ObjectRegistry::eraseSession (const std::string &sessionId)
+{
+  Shard &shard = getShard (sessionId);
+  WriteLock lock (&shard.lock);
+
+  /* Its wheel entry is dropped when its slot is visited */
+  shard.sessionDeadlines.erase (sessionId);
+}
+
+std::vector<std::string>
+ObjectRegistry::expireSessions ()
+{
+  std::vector<std::string> expired;
+  std::unordered_set<std::string> due;
+  uint64_t tick = ++currentTick;
+
+  {
+    std::unique_lock <std::mutex> lock (wheelMutex);
+
+    due.swap (wheel[tick % WHEEL_SLOTS]);
+  }
+
+  for (auto &sessionId : due) {
+    Shard &shard = getShard (sessionId);
+    ReadLock lock (&shard.lock);
+    auto it = shard.sessionDeadlines.find (sessionId);
+
+    if (it == shard.sessionDeadlines.end () ) {
+      continue;
+    }
+
+    uint64_t deadline = it->second;
+
+    if (deadline > tick) {
+      schedule (sessionId, deadline);
+    } else {
+      expired.push_back (sessionId);
+    }
+  }
+
+  return expired;
+}
+
+} // kurento
@@ -0,0 +1,115 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __OBJECT_REGISTRY_HPP__
+#define __OBJECT_REGISTRY_HPP__
+
+#include <glib.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace kurento
+{
+
+class MediaObjectImpl;
+
+/*
+ * Concurrent registry of media objects, of the sessions referencing them
+ * and of the liveness of those sessions. Entries are spread among shards
+ * by id, each shard protected by a reader/writer lock, so lookups of
+ * different objects never contend.
+ *
+ * Session expiry uses a hashed timer wheel: a keepalive only stores a new
+ * deadline and each tick visits the sessions of a single slot, moving the
+ * ones that were kept alive to the slot of their new deadline.
+ */
+class ObjectRegistry
+{
+public:
+  ObjectRegistry (uint64_t sessionTimeoutTicks);
+  ~ObjectRegistry ();
+
+  void add (const std::string &id, std::weak_ptr<MediaObjectImpl> object,
+            bool pipeline = false);
+  void remove (const std::string &id);
+  bool contains (const std::string &id);
+
+  /* Returns the object if it is still alive, referenced is set to whether
+   * any session holds it */
+  std::shared_ptr<MediaObjectImpl> get (const std::string &id,
+                                        bool &referenced);
+
+  bool hasSession (const std::string &id, const std::string &sessionId);
+  void addSession (const std::string &id, const std::string &sessionId);
+  /* Returns true if no session references the object anymore */
+  bool removeSession (const std::string &id, const std::string &sessionId);
+  std::unordered_set<std::string> getSessions (const std::string &id);
+
+  std::vector<std::string> getIds ();
+  /* Alive pipelines referenced by any session, O(number of pipelines) */
+  std::vector<std::shared_ptr<MediaObjectImpl>> getPipelines ();
+  size_t size ();
+
+  /* Delays the expiry of the session, returns false if it does not exist
+   * and create is false */
+  bool touchSession (const std::string &sessionId, bool create);
+  void eraseSession (const std::string &sessionId);
+  /* Advances the wheel one tick and returns the sessions that expired */
+  std::vector<std::string> expireSessions ();
+
+private:
+  static const size_t SHARDS = 32;
+  static const size_t WHEEL_SLOTS = 64;
+
+  struct Entry {
+    std::weak_ptr<MediaObjectImpl> object;
+    std::unordered_set<std::string> sessions;
+  };
+
+  struct Shard {
+    GRWLock lock;
+    std::unordered_map<std::string, Entry> entries;
+    /* Session id to the tick it expires on */
+    std::unordered_map<std::string, std::atomic<uint64_t>> sessionDeadlines;
+  };
+
+  Shard &getShard (const std::string &id);
+  void schedule (const std::string &sessionId, uint64_t deadline);
+
+  Shard shards[SHARDS];
+  std::atomic<size_t> count;
+
+  uint64_t sessionTimeoutTicks;
+  std::atomic<uint64_t> currentTick;
+  /* Always taken after a shard lock, never before */
+  std::mutex wheelMutex;
+  std::unordered_set<std::string> wheel[WHEEL_SLOTS];
+
+  /* Always taken after a shard lock, never before */
+  GRWLock pipelinesLock;
+  std::unordered_map<std::string, std::weak_ptr<MediaObjectImpl>> pipelines;
+};
+
+} // kurento
+
+#endif /* __OBJECT_REGISTRY_HPP__ */
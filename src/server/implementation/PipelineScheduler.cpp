@@ -0,0 +1,465 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "PipelineScheduler.hpp"
+#include "Metrics.hpp"
+
+#include <thread>
+
+#define GST_CAT_DEFAULT kurento_pipeline_scheduler
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+#define GST_DEFAULT_NAME "KurentoPipelineScheduler"
+
+/* Added to the load of each pipeline so idle ones are spread too */
+const double PIPELINE_BASE_LOAD = 0.001;
+
+namespace kurento
+{
+
+static uint64_t
+read_cpu_clock (clockid_t clock)
+{
+  struct timespec ts;
+
+  if (clock_gettime (clock, &ts) != 0) {
+    return 0;
+  }
+
+  return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void
+pipeline_schedule_stream_status (GstBus *bus, GstMessage *message,
+                                 gpointer data)
+{
+  PipelineSchedule *self = static_cast<PipelineSchedule *> (data);
+
+  self->streamStatus (message);
+}
+
+static GstTaskPool *
+create_task_pool ()
+{
+  GstTaskPool *pool;
+  GError *err = NULL;
+
+  pool = gst_task_pool_new ();
+  gst_task_pool_prepare (pool, &err);
+
+  if (err != NULL) {
+    GST_WARNING ("Cannot prepare task pool: %s", err->message);
+    g_error_free (err);
+    gst_object_unref (pool);
+    return NULL;
+  }
+
+  return pool;
+}
+
+PipelineSchedule::PipelineSchedule (GstElement *pipeline, int cpu, int cpus,
+                                    GstTaskPool *sharedPool, bool accountMemory, bool accountThreads) :
+  pipeline (pipeline), bus (NULL), handlerId (0), pool (NULL), ownPool (false),
+  cpu (cpu), cpus (cpus), finishedCpuTime (0), memory (NULL),
+  created (std::chrono::steady_clock::now () )
+{
+  if (accountMemory) {
+    kms_memory_account_install_allocator ();
+    memory = kms_memory_account_new ();
+  }
+
+  if (sharedPool != NULL) {
+    pool = GST_TASK_POOL (gst_object_ref (sharedPool) );
+  } else if (cpu >= 0) {
+    /* Pinned threads are not handed over to other pipelines */
+    pool = create_task_pool ();
+    ownPool = true;
+  }
+
+  if (pool == NULL && memory == NULL && !accountThreads) {
+    /* Nothing to do on the streaming threads, keep the default task pool
+     * and leave the bus alone */
+    return;
+  }
+
+  /* stream-status is delivered synchronously from the streaming thread, so
+   * ENTER and LEAVE run on the thread they refer to */
+  bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline) );
+  gst_bus_enable_sync_message_emission (bus);
+  handlerId = g_signal_connect (bus, "sync-message::stream-status",
+                                G_CALLBACK (pipeline_schedule_stream_status), this);
+}
+
+PipelineSchedule::~PipelineSchedule ()
+{
+  if (bus != NULL) {
+    g_signal_handler_disconnect (bus, handlerId);
+    gst_bus_disable_sync_message_emission (bus);
+    g_object_unref (bus);
+  }
+
+  if (pool != NULL) {
+    if (ownPool) {
+      gst_task_pool_cleanup (pool);
+    }
+
+    gst_object_unref (pool);
+  }
+
+  for (auto &it : threads) {
+    if (it.second.element != NULL) {
+      gst_object_unref (it.second.element);
+    }
+  }
+
+  if (memory != NULL) {
+    /* Memory still alive keeps its own reference */
+    kms_memory_account_unref (memory);
+  }
+}
+
+void
+PipelineSchedule::streamStatus (GstMessage *message)
+{
+  GstStreamStatusType type;
+  GstElement *owner;
+  const GValue *val;
+
+  gst_message_parse_stream_status (message, &type, &owner);
+
+  switch (type) {
+  case GST_STREAM_STATUS_TYPE_CREATE:
+    val = gst_message_get_stream_status_object (message);
+
+    if (pool != NULL && val != NULL && G_VALUE_TYPE (val) == GST_TYPE_TASK) {
+      gst_task_set_pool (GST_TASK (g_value_get_object (val) ), pool);
+    }
+
+    break;
+
+  case GST_STREAM_STATUS_TYPE_ENTER:
+    threadEnter (owner);
+    break;
+
+  case GST_STREAM_STATUS_TYPE_LEAVE:
+    threadLeave ();
+    break;
+
+  default:
+    break;
+  }
+}
+
+GstElement *
+PipelineSchedule::getTopLevelElement (GstElement *owner)
+{
+  GstObject *current, *parent;
+
+  if (owner == NULL) {
+    return NULL;
+  }
+
+  current = GST_OBJECT (gst_object_ref (owner) );
+
+  while ( (parent = gst_object_get_parent (current) ) != NULL) {
+    if (parent == GST_OBJECT (pipeline) ) {
+      gst_object_unref (parent);
+      break;
+    }
+
+    gst_object_unref (current);
+    current = parent;
+  }
+
+  /* The reference is kept by the caller */
+  return GST_ELEMENT (current);
+}
+
+void
+PipelineSchedule::threadEnter (GstElement *owner)
+{
+  ThreadUsage usage;
+  pthread_t thread = pthread_self ();
+
+  if (pthread_getcpuclockid (thread, &usage.clock) != 0) {
+    return;
+  }
+
+  usage.element = getTopLevelElement (owner);
+
+  CPU_ZERO (&usage.affinity);
+
+  if (cpu >= 0) {
+    cpu_set_t set;
+
+    pthread_getaffinity_np (thread, sizeof (usage.affinity), &usage.affinity);
+
+    CPU_ZERO (&set);
+
+    for (int i = cpu; i < cpu + cpus; i++) {
+      CPU_SET (i, &set);
+    }
+
+    if (pthread_setaffinity_np (thread, sizeof (set), &set) != 0) {
+      GST_WARNING ("Cannot pin streaming thread to cpu %d", cpu);
+    }
+  }
+
+  usage.start = read_cpu_clock (usage.clock);
+
+  std::unique_lock<std::mutex> lock (mutex);
+
+  if (threads.find (thread) != threads.end () ) {
+    /* Entered again without leaving, keep the first accounting */
+    lock.unlock ();
+
+    if (usage.element != NULL) {
+      gst_object_unref (usage.element);
+    }
+
+    return;
+  }
+
+  threads[thread] = usage;
+  elementThreads[usage.element]++;
+  lock.unlock ();
+
+  if (memory != NULL) {
+    kms_memory_account_set_current (memory);
+  }
+
+  PipelineScheduler::getScheduler ().threadStarted ();
+}
+
+void
+PipelineSchedule::threadLeave ()
+{
+  std::unique_lock<std::mutex> lock (mutex);
+  auto it = threads.find (pthread_self () );
+  GstElement *element;
+
+  if (it == threads.end () ) {
+    return;
+  }
+
+  finishedCpuTime += read_cpu_clock (CLOCK_THREAD_CPUTIME_ID) -
+                     it->second.start;
+
+  if (cpu >= 0 && CPU_COUNT (&it->second.affinity) > 0) {
+    pthread_setaffinity_np (pthread_self (), sizeof (it->second.affinity),
+                            &it->second.affinity);
+  }
+
+  element = it->second.element;
+
+  if (--elementThreads[element] <= 0) {
+    elementThreads.erase (element);
+  }
+
+  threads.erase (it);
+  lock.unlock ();
+
+  if (element != NULL) {
+    gst_object_unref (element);
+  }
+
+  if (memory != NULL) {
+    kms_memory_account_set_current (NULL);
+  }
+
+  PipelineScheduler::getScheduler ().threadFinished ();
+}
+
+int64_t
+PipelineSchedule::getMemory ()
+{
+  return memory != NULL ? kms_memory_account_get_used (memory) : 0;
+}
+
+int64_t
+PipelineSchedule::getPeakMemory ()
+{
+  return memory != NULL ? kms_memory_account_get_peak (memory) : 0;
+}
+
+int
+PipelineSchedule::getThreadCount ()
+{
+  std::unique_lock<std::mutex> lock (mutex);
+
+  return threads.size ();
+}
+
+int
+PipelineSchedule::getThreadCount (GstElement *element)
+{
+  std::unique_lock<std::mutex> lock (mutex);
+  auto it = elementThreads.find (element);
+
+  if (it == elementThreads.end () ) {
+    return 0;
+  }
+
+  return it->second;
+}
+
+uint64_t
+PipelineSchedule::getCpuTime ()
+{
+  std::unique_lock<std::mutex> lock (mutex);
+  uint64_t total = finishedCpuTime;
+
+  /* Threads remove themselves before exiting, so their clocks are valid */
+  for (auto &it : threads) {
+    total += read_cpu_clock (it.second.clock) - it.second.start;
+  }
+
+  return total;
+}
+
+double
+PipelineSchedule::getLoad ()
+{
+  std::chrono::duration<double, std::nano> age =
+    std::chrono::steady_clock::now () - created;
+
+  if (age.count () <= 0) {
+    return PIPELINE_BASE_LOAD;
+  }
+
+  return PIPELINE_BASE_LOAD + getCpuTime () / age.count ();
+}
+
+PipelineScheduler::PipelineScheduler () : sharedPool (NULL), threadCount (0),
+  threadBudget (0)
+{
+  cpuCount = std::thread::hardware_concurrency ();
+
+  if (cpuCount <= 0) {
+    cpuCount = 1;
+  }
+}
+
+PipelineScheduler &
+PipelineScheduler::getScheduler ()
+{
+  static PipelineScheduler scheduler;
+
+  return scheduler;
+}
+
+int
+PipelineScheduler::pickCpuSet (int sets, int cpusPerPipeline)
+{
+  std::vector<double> load (sets, 0);
+  int best = 0;
+
+  for (auto it = schedules.begin (); it != schedules.end ();) {
+    std::shared_ptr<PipelineSchedule> schedule = it->lock ();
+
+    if (!schedule) {
+      it = schedules.erase (it);
+      continue;
+    }
+
+    if (schedule->cpu >= 0) {
+      load[ (schedule->cpu / cpusPerPipeline) % sets] += schedule->getLoad ();
+    }
+
+    ++it;
+  }
+
+  for (int i = 1; i < sets; i++) {
+    if (load[i] < load[best]) {
+      best = i;
+    }
+  }
+
+  return best * cpusPerPipeline;
+}
+
+GstTaskPool *
+PipelineScheduler::getSharedPool ()
+{
+  if (sharedPool == NULL) {
+    sharedPool = create_task_pool ();
+  }
+
+  return sharedPool;
+}
+
+void
+PipelineScheduler::threadStarted ()
+{
+  int count = ++threadCount;
+  int budget = threadBudget;
+
+  if (budget > 0 && count == budget + 1) {
+    GST_WARNING ("Streaming thread budget exceeded: %d threads running, "
+                 "budget is %d", count, budget);
+  }
+}
+
+void
+PipelineScheduler::threadFinished ()
+{
+  threadCount--;
+}
+
+std::shared_ptr<PipelineSchedule>
+PipelineScheduler::schedule (GstElement *pipeline,
+                             const PipelineScheduleConfig &config)
+{
+  std::unique_lock<std::mutex> lock (mutex);
+  std::shared_ptr<PipelineSchedule> schedule;
+  int cpusPerPipeline = config.cpusPerPipeline;
+  int cpu = -1;
+
+  if (cpusPerPipeline <= 0 || cpusPerPipeline > cpuCount) {
+    cpusPerPipeline = cpuCount;
+  }
+
+  if (config.pin) {
+    cpu = pickCpuSet (cpuCount / cpusPerPipeline, cpusPerPipeline);
+    GST_DEBUG ("Pipeline %" GST_PTR_FORMAT " pinned to cpus %d-%d", pipeline,
+               cpu, cpu + cpusPerPipeline - 1);
+  }
+
+  schedule = std::shared_ptr<PipelineSchedule> (new PipelineSchedule (pipeline,
+             cpu, cpusPerPipeline,
+             config.sharedTaskPool ? getSharedPool () : NULL,
+             config.accountMemory,
+             config.accountThreads || threadBudget > 0) );
+  schedules.push_back (schedule);
+
+  return schedule;
+}
+
+PipelineScheduler::StaticConstructor PipelineScheduler::staticConstructor;
+
+PipelineScheduler::StaticConstructor::StaticConstructor()
+{
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, GST_DEFAULT_NAME, 0,
+                           GST_DEFAULT_NAME);
+
+  MetricsRegistry::getRegistry ().addCollector ([] (MetricsWriter & writer) {
+    writer.gauge ("kms_streaming_threads",
+                  "Streaming threads running in all the pipelines",
+                  PipelineScheduler::getScheduler ().getThreadCount () );
+  });
+}
+
+} // kurento
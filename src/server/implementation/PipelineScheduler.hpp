@@ -0,0 +1,184 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __PIPELINE_SCHEDULER_HPP__
+#define __PIPELINE_SCHEDULER_HPP__
+
+#include <gst/gst.h>
+#include "commons/kmsmemoryaccount.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+namespace kurento
+{
+
+struct PipelineScheduleConfig {
+  /* Bind the streaming threads to a set of cpusPerPipeline CPUs */
+  bool pin;
+  int cpusPerPipeline;
+  /* Run the tasks on a server wide pool instead of one per pipeline */
+  bool sharedTaskPool;
+  /* Charge the memory allocated by the streaming threads to the pipeline */
+  bool accountMemory;
+  /* Account CPU time and count of the streaming threads even if nothing
+   * above or the thread budget needs it. Without any of them the pipeline
+   * is left untouched */
+  bool accountThreads;
+};
+
+/*
+ * Streaming threads of one pipeline. Pinned pipelines run their tasks on
+ * their own GstTaskPool (or the shared one), others on the default one. If
+ * anything is configured, their CPU time and count are accounted to the
+ * pipeline.
+ */
+class PipelineSchedule
+{
+public:
+  ~PipelineSchedule ();
+
+  /* Nanoseconds of CPU used by the streaming threads of the pipeline, 0 if
+   * threads are not accounted */
+  uint64_t getCpuTime ();
+
+  /* First CPU of the set the pipeline is pinned to, -1 if not pinned */
+  int getCpu ()
+  {
+    return cpu;
+  }
+
+  /* Bytes of memory allocated by the streaming threads of the pipeline and
+   * not yet freed, and the highest it has been. 0 without accountMemory */
+  int64_t getMemory ();
+  int64_t getPeakMemory ();
+
+  /* Streaming threads currently running for the pipeline */
+  int getThreadCount ();
+
+  /* Streaming threads currently running inside a direct child of the
+   * pipeline (the GstElement of a media element) */
+  int getThreadCount (GstElement *element);
+
+private:
+  PipelineSchedule (GstElement *pipeline, int cpu, int cpus,
+                    GstTaskPool *sharedPool, bool accountMemory, bool accountThreads);
+
+  void streamStatus (GstMessage *message);
+  void threadEnter (GstElement *owner);
+  void threadLeave ();
+  GstElement *getTopLevelElement (GstElement *owner);
+
+  /* Fraction of a CPU used since the pipeline was created */
+  double getLoad ();
+
+  struct ThreadUsage {
+    clockid_t clock;
+    uint64_t start;
+    /* Reference held while the thread runs, so the key of elementThreads
+     * cannot be reused by another element */
+    GstElement *element;
+    /* Affinity to restore when the thread goes back to the shared pool */
+    cpu_set_t affinity;
+  };
+
+  GstElement *pipeline;
+  GstBus *bus;
+  gulong handlerId;
+  GstTaskPool *pool;
+  bool ownPool;
+
+  int cpu;
+  int cpus;
+
+  std::mutex mutex;
+  std::map<pthread_t, ThreadUsage> threads;
+  std::map<GstElement *, int> elementThreads;
+  std::atomic<uint64_t> finishedCpuTime;
+  KmsMemoryAccount *memory;
+  std::chrono::steady_clock::time_point created;
+
+  friend class PipelineScheduler;
+  friend void pipeline_schedule_stream_status (GstBus *bus,
+      GstMessage *message, gpointer data);
+};
+
+/*
+ * Places pipelines on CPU sets. A new pipeline goes to the set with the
+ * lowest measured load, so busy rooms do not share cores with new ones.
+ */
+class PipelineScheduler
+{
+public:
+  static PipelineScheduler &getScheduler ();
+
+  /* Takes over the stream-status messages of pipeline */
+  std::shared_ptr<PipelineSchedule> schedule (GstElement *pipeline,
+      const PipelineScheduleConfig &config);
+
+  /* Streaming threads currently running in all the pipelines */
+  int getThreadCount ()
+  {
+    return threadCount;
+  }
+
+  /* Server wide, set once at startup. Streaming threads above which a
+   * warning is logged, 0 disables it */
+  void setThreadBudget (int budget)
+  {
+    threadBudget = budget;
+  }
+
+private:
+  PipelineScheduler ();
+
+  int pickCpuSet (int sets, int cpusPerPipeline);
+  GstTaskPool *getSharedPool ();
+  void threadStarted ();
+  void threadFinished ();
+
+  int cpuCount;
+  GstTaskPool *sharedPool;
+  std::atomic<int> threadCount;
+  std::atomic<int> threadBudget;
+
+  std::mutex mutex;
+  std::vector<std::weak_ptr<PipelineSchedule>> schedules;
+
+  friend class PipelineSchedule;
+
+  class StaticConstructor
+  {
+  public:
+    StaticConstructor();
+  };
+
+  static StaticConstructor staticConstructor;
+};
+
+} // kurento
+
+#endif /* __PIPELINE_SCHEDULER_HPP__ */
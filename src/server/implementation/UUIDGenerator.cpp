@@ -15,68 +15,162 @@
  *
  */
 
-#include <boost/uuid/uuid.hpp>
-#include <boost/uuid/uuid_generators.hpp>
-#include <boost/uuid/uuid_io.hpp>
+#include "UUIDGenerator.hpp"
+
+#include <atomic>
 #include <chrono>
-#include <sstream>
+#include <cstdint>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 namespace kurento
 {
 
+/* Bumped in the child after a fork, so every generator reseeds */
+static std::atomic<unsigned> forkGeneration (0);
+
+static void
+on_fork_child ()
+{
+  forkGeneration++;
+}
+
+static uint64_t
+splitmix64 (uint64_t &state)
+{
+  uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+
+  z = (z ^ (z >> 30) ) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27) ) * 0x94d049bb133111ebULL;
+
+  return z ^ (z >> 31);
+}
+
+static bool
+read_entropy (void *buf, size_t len)
+{
+#ifdef SYS_getrandom
+
+  if (syscall (SYS_getrandom, buf, len, 0) == (long) len) {
+    return true;
+  }
+
+#endif
+  int fd = open ("/dev/urandom", O_RDONLY | O_CLOEXEC);
+  bool ok = false;
+
+  if (fd >= 0) {
+    ok = read (fd, buf, len) == (ssize_t) len;
+    close (fd);
+  }
+
+  return ok;
+}
+
+/* xoshiro256** generator, one per thread so no locking is needed */
 class RandomGenerator
 {
-  boost::uuids::basic_random_generator<boost::mt19937> gen;
-  boost::mt19937 ran;
-  pid_t pid;
+  uint64_t s[4];
+  unsigned generation;
+
+  static uint64_t rotl (uint64_t x, int k)
+  {
+    return (x << k) | (x >> (64 - k) );
+  }
 
 public:
-  RandomGenerator () : gen (&ran)
+  RandomGenerator ()
   {
-    init ();
+    seed ();
   }
 
-  void init ()
+  void seed ()
   {
-    std::chrono::high_resolution_clock::time_point now =
-      std::chrono::high_resolution_clock::now();
+    uint64_t seed;
 
-    std::chrono::nanoseconds time =
-      std::chrono::duration_cast<std::chrono::nanoseconds>
-      (now.time_since_epoch () );
+    generation = forkGeneration;
 
-    ran.seed (time.count() );
+    if (!read_entropy (&seed, sizeof (seed) ) ) {
+      seed = std::chrono::high_resolution_clock::now ().time_since_epoch ().count
+             ();
+      seed ^= (uint64_t) getpid () << 32;
+      seed ^= (uint64_t) (uintptr_t) this;
+    }
 
-    pid = getpid();
+    /* Expand the seed so the state is never all zeros */
+    for (int i = 0; i < 4; i++) {
+      s[i] = splitmix64 (seed);
+    }
   }
 
-  void reinit ()
+  uint64_t next ()
   {
-    if (pid != getpid() ) {
-      init();
+    if (generation != forkGeneration) {
+      seed ();
     }
-  }
 
-  std::string getUUID ()
-  {
-    reinit();
+    uint64_t result = rotl (s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
 
-    std::stringstream ss;
-    boost::uuids::uuid uuid = gen ();
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl (s[3], 45);
 
-    ss << uuid;
-    return ss.str();
+    return result;
   }
 };
 
-static RandomGenerator gen;
+static thread_local RandomGenerator gen;
+
+static int forkHandler = pthread_atfork (NULL, NULL, on_fork_child);
+
+void
+generateUUID (char uuid[UUID_STRING_LENGTH])
+{
+  static const char hex[] = "0123456789abcdef";
+  /* Position of each byte in xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx */
+  static const uint8_t offsets[16] = {
+    0, 2, 4, 6, 9, 11, 14, 16, 19, 21, 24, 26, 28, 30, 32, 34
+  };
+  uint8_t bytes[16];
+  uint64_t hi, lo;
+
+  (void) forkHandler;
+
+  hi = gen.next ();
+  lo = gen.next ();
+
+  for (int i = 0; i < 8; i++) {
+    bytes[i] = hi >> (56 - 8 * i);
+    bytes[i + 8] = lo >> (56 - 8 * i);
+  }
+
+  /* Version 4 (random), variant 1 */
+  bytes[6] = (bytes[6] & 0x0f) | 0x40;
+  bytes[8] = (bytes[8] & 0x3f) | 0x80;
+
+  for (int i = 0; i < 16; i++) {
+    uuid[offsets[i]] = hex[bytes[i] >> 4];
+    uuid[offsets[i] + 1] = hex[bytes[i] & 0x0f];
+  }
+
+  uuid[8] = uuid[13] = uuid[18] = uuid[23] = '-';
+}
 
 std::string
 generateUUID ()
 {
-  return gen.getUUID ();
+  char uuid[UUID_STRING_LENGTH];
+
+  generateUUID (uuid);
+
+  return std::string (uuid, UUID_STRING_LENGTH);
 }
 
 }
@@ -19,10 +19,17 @@
 #ifndef __UUID_GENERATOR_HPP__
 #define __UUID_GENERATOR_HPP__
 
+#include <string>
+
 namespace kurento
 {
 
+/* Length of the textual form of an UUID, without null terminator */
+const size_t UUID_STRING_LENGTH = 36;
+
 std::string generateUUID ();
+/* Writes a new UUID into uuid, without allocating */
+void generateUUID (char uuid[UUID_STRING_LENGTH]);
 
 }
 
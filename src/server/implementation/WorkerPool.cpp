@@ -19,6 +19,11 @@
 
 #include "WorkerPool.hpp"
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
 
 #define GST_CAT_DEFAULT kurento_worker_pool
 GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
@@ -29,143 +34,274 @@ const int WORKER_THREADS_TIMEOUT = 3; /* seconds */
 namespace kurento
 {
 
+const int WorkerPool::LATENCY_BUCKETS;
+
+struct WorkerPool::Core {
+  struct Task {
+    std::function <void () > func;
+    std::chrono::steady_clock::time_point posted;
+  };
+
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> workers;
+  std::thread watcher;
+
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::condition_variable watcherCond;
+  bool terminated = false;
+
+  std::atomic<size_t> pending {0};
+  std::atomic<size_t> nextQueue {0};
+  std::atomic<uint64_t> executed {0};
+  std::atomic<uint64_t> steals {0};
+  std::atomic<uint64_t> latencies[LATENCY_BUCKETS];
+
+  void push (std::function <void () > func);
+  bool pop (int index, Task &task);
+  void run (Task &task);
+};
+
+/* Worker running in the current thread, used to post to its own queue */
+static thread_local WorkerPool::Core *currentCore = nullptr;
+static thread_local int currentQueue = -1;
+
+void
+WorkerPool::Core::push (std::function <void () > func)
+{
+  size_t index;
+
+  if (currentCore == this && currentQueue >= 0) {
+    index = currentQueue;
+  } else {
+    index = nextQueue++ % queues.size ();
+  }
+
+  Queue &queue = *queues[index];
+  std::unique_lock <std::mutex> queueLock (queue.mutex);
+
+  /* Counted before the task can be popped, so pending never goes below 0 */
+  pending++;
+  queue.tasks.push_back ({func, std::chrono::steady_clock::now () });
+  queueLock.unlock ();
+
+  std::unique_lock <std::mutex> lock (mutex);
+  cond.notify_one ();
+}
+
+bool
+WorkerPool::Core::pop (int index, Task &task)
+{
+  size_t n = queues.size ();
+  /* Workers spawned by the watcher do not own a queue, they only steal */
+  size_t first = index >= 0 ? index : 0;
+
+  for (size_t i = 0; i < n; i++) {
+    Queue &queue = *queues[ (first + i) % n];
+    std::unique_lock <std::mutex> queueLock (queue.mutex);
+
+    if (queue.tasks.empty () ) {
+      continue;
+    }
+
+    task = std::move (queue.tasks.front () );
+    queue.tasks.pop_front ();
+    pending--;
+
+    if (index < 0 || i > 0) {
+      steals++;
+    }
+
+    return true;
+  }
+
+  return false;
+}
+
+void
+WorkerPool::Core::run (Task &task)
+{
+  uint64_t latency = std::chrono::duration_cast<std::chrono::microseconds>
+                     (std::chrono::steady_clock::now () - task.posted).count ();
+  int bucket = 0;
+
+  while (bucket < LATENCY_BUCKETS - 1 && (1ULL << bucket) <= latency) {
+    bucket++;
+  }
+
+  latencies[bucket]++;
+  /* Before running it, so stats read once the task signals its completion
+   * already count it */
+  executed++;
+
+  try {
+    task.func ();
+  } catch (std::exception &e) {
+    GST_ERROR ("Unexpected error while running the server: %s", e.what() );
+  } catch (...) {
+    GST_ERROR ("Unexpected error while running the server");
+  }
+}
+
 static void
-workerThreadLoop ( boost::shared_ptr< boost::asio::io_service > io_service )
+workerThreadLoop (std::shared_ptr<WorkerPool::Core> core, int index)
 {
-  bool running = true;
+  GST_DEBUG ("Working thread starting");
 
-  while (running) {
-    try {
-      GST_DEBUG ("Working thread starting");
-      io_service->run();
-      running = false;
-    } catch (std::exception &e) {
-      GST_ERROR ("Unexpected error while running the server: %s", e.what() );
-    } catch (...) {
-      GST_ERROR ("Unexpected error while running the server");
+  currentCore = core.get ();
+  currentQueue = index;
+
+  while (true) {
+    WorkerPool::Core::Task task;
+
+    if (core->pop (index, task) ) {
+      core->run (task);
+      continue;
+    }
+
+    std::unique_lock <std::mutex> lock (core->mutex);
+
+    core->cond.wait (lock, [core] () {
+      return core->terminated || core->pending > 0;
+    });
+
+    if (core->terminated) {
+      break;
     }
   }
 
+  currentCore = nullptr;
+  currentQueue = -1;
+
   GST_DEBUG ("Working thread finished");
 }
 
+/*
+ * Liveness is sampled instead of checked on every post: if tasks are
+ * waiting and none has finished during a whole period, every worker is
+ * considered locked and a new one is spawned.
+ */
+static void
+watcherThreadLoop (std::shared_ptr<WorkerPool::Core> core)
+{
+  std::unique_lock <std::mutex> lock (core->mutex);
+  uint64_t lastExecuted = core->executed;
+
+  while (!core->terminated) {
+    core->watcherCond.wait_for (lock,
+                                std::chrono::seconds (WORKER_THREADS_TIMEOUT) );
+
+    if (core->terminated) {
+      break;
+    }
+
+    uint64_t current = core->executed;
+
+    if (core->pending > 0 && current == lastExecuted) {
+      GST_WARNING ("Worker threads locked. Spawning a new one.");
+      core->workers.push_back (std::thread (&workerThreadLoop, core, -1) );
+    }
+
+    lastExecuted = current;
+  }
+}
+
 WorkerPool::WorkerPool (int threads)
 {
-  /* Prepare watcher */
-  watcher_service = boost::shared_ptr< boost::asio::io_service >
-                    ( new boost::asio::io_service () );
-  watcher_work = std::shared_ptr< boost::asio::io_service::work >
-                 ( new boost::asio::io_service::work (*watcher_service) );
-  watcher = std::thread (std::bind (&workerThreadLoop, watcher_service) );
-
-  /* Prepare pool of threads */
-  io_service = boost::shared_ptr< boost::asio::io_service >
-               ( new boost::asio::io_service () );
-  work = std::shared_ptr< boost::asio::io_service::work >
-         ( new boost::asio::io_service::work (*io_service) );
+  core = std::make_shared<Core> ();
+  threads = std::max (threads, 1);
+
+  for (int i = 0; i < LATENCY_BUCKETS; i++) {
+    core->latencies[i] = 0;
+  }
 
   for (int i = 0; i < threads; i++) {
-    workers.push_back (std::thread (std::bind (&workerThreadLoop, io_service) ) );
+    core->queues.push_back (std::unique_ptr<Core::Queue> (new Core::Queue () ) );
   }
+
+  for (int i = 0; i < threads; i++) {
+    core->workers.push_back (std::thread (&workerThreadLoop, core, i) );
+  }
+
+  core->watcher = std::thread (&watcherThreadLoop, core);
 }
 
 WorkerPool::~WorkerPool()
 {
-  std::unique_lock <std::mutex> lock (mutex);
-  terminated = true ;
+  std::unique_lock <std::mutex> lock (core->mutex);
+  core->terminated = true;
+  core->cond.notify_all ();
+  core->watcherCond.notify_all ();
   lock.unlock();
 
-  watcher_service->stop();
-  io_service->stop();
-
   try {
-    if (std::this_thread::get_id() != watcher.get_id() ) {
-      watcher.join();
+    if (std::this_thread::get_id() != core->watcher.get_id() ) {
+      core->watcher.join();
     }
   } catch (std::system_error &e) {
     GST_ERROR ("Error joining: %s", e.what() );
   }
 
   try {
-    if (watcher.joinable() ) {
-      watcher.detach();
+    if (core->watcher.joinable() ) {
+      core->watcher.detach();
     }
   } catch (std::system_error &e) {
     GST_ERROR ("Error detaching: %s", e.what() );
   }
 
-  for (uint i = 0; i < workers.size (); i++) {
+  /* No more workers can be spawned once the watcher is finished */
+  for (uint i = 0; i < core->workers.size (); i++) {
     try {
-      if (std::this_thread::get_id() != workers[i].get_id() ) {
-        workers[i].join();
+      if (std::this_thread::get_id() != core->workers[i].get_id() ) {
+        core->workers[i].join();
       }
     } catch (std::system_error &e) {
       GST_ERROR ("Error joining: %s", e.what() );
     }
 
     try {
-      if (workers[i].joinable() ) {
-        workers[i].detach();
+      if (core->workers[i].joinable() ) {
+        core->workers[i].detach();
       }
     } catch (std::system_error &e) {
       GST_ERROR ("Error detaching: %s", e.what() );
     }
   }
 
-  workers.empty();
-
   // Executing queued tasks
-  io_service->reset();
+  Core::Task task;
 
-  while (io_service->poll() ) {
+  while (core->pop (-1, task) ) {
+    core->run (task);
   }
 }
 
-static void
-async_worker_test (std::shared_ptr<std::atomic<bool>> alive)
+void
+WorkerPool::push (std::function <void () > func)
 {
-  *alive = true;
+  core->push (func);
 }
 
-void
-WorkerPool::checkWorkers ()
+WorkerPoolStats
+WorkerPool::getStats ()
 {
-  std::shared_ptr<std::atomic<bool>> alive;
-
-  alive = std::shared_ptr<std::atomic<bool>> ( new std::atomic<bool> (false) );
+  WorkerPoolStats stats;
 
-  io_service->post (std::bind (&async_worker_test, alive) );
+  stats.queueDepth = core->pending;
+  stats.executed = core->executed;
+  stats.steals = core->steals;
 
-  boost::shared_ptr< boost::asio::deadline_timer > timer (
-    new boost::asio::deadline_timer ( *watcher_service ) );
-
-  timer->expires_from_now ( boost::posix_time::seconds (
-                              WORKER_THREADS_TIMEOUT) );
-  timer->async_wait ( [timer, alive,
-  this] (const boost::system::error_code & error) {
-    if (error) {
-      GST_ERROR ("ERROR: %s", error.message().c_str() );
-      return;
-    }
-
-    if (*alive) {
-      return;
-    }
-
-    GST_WARNING ("Worker threads locked. Spawning a new one.");
-
-    std::unique_lock <std::mutex> lock (mutex);
-
-    if (!terminated) {
-      workers.push_back (std::thread (std::bind (&workerThreadLoop, io_service) ) );
-    }
-  });
-}
+  for (int i = 0; i < LATENCY_BUCKETS; i++) {
+    stats.latencyHistogram.push_back (core->latencies[i]);
+  }
 
-void
-WorkerPool::setWatcher ()
-{
-  watcher_service->post (std::bind (&WorkerPool::checkWorkers, this) );
+  return stats;
 }
 
 WorkerPool::StaticConstructor WorkerPool::staticConstructor;
@@ -18,13 +18,30 @@
 #ifndef __WORKERPOOL_HPP__
 #define __WORKERPOOL_HPP__
 
-#include <mutex>
-#include <thread>
-#include <boost/asio.hpp>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
 
 namespace kurento
 {
 
+struct WorkerPoolStats {
+  /* Tasks posted and not yet started */
+  size_t queueDepth;
+  /* Tasks started by a worker */
+  uint64_t executed;
+  /* Tasks run by a worker other than the one they were queued to */
+  uint64_t steals;
+  /* Time from post to run, bucket i counts latencies below 2^i us */
+  std::vector<uint64_t> latencyHistogram;
+};
+
+/*
+ * Work-stealing executor. Every worker owns a queue, tasks posted from a
+ * worker go to its own queue and tasks posted from other threads are
+ * spread among workers. Idle workers steal from the other queues.
+ */
 class WorkerPool
 {
 public:
@@ -32,28 +49,23 @@ public:
   ~WorkerPool();
 
   template <typename CompletionHandler>
-  BOOST_ASIO_INITFN_RESULT_TYPE (CompletionHandler, void () )
-  post (BOOST_ASIO_MOVE_ARG (CompletionHandler) handler)
+  void post (CompletionHandler handler)
   {
-    setWatcher();
-    return io_service->post (handler);
+    push (std::function <void () > (handler) );
   }
 
-private:
-  void setWatcher();
-  void checkWorkers();
+  WorkerPoolStats getStats ();
 
-  boost::shared_ptr< boost::asio::io_service > io_service;
-  std::shared_ptr< boost::asio::io_service::work > work;
-  std::vector<std::thread> workers;
+  static const int LATENCY_BUCKETS = 24;
 
-  boost::shared_ptr< boost::asio::io_service > watcher_service;
-  std::shared_ptr< boost::asio::io_service::work > watcher_work;
-  std::thread watcher;
+  /* State shared with the threads, so it outlives the pool if it is
+   * destroyed from one of its own workers */
+  struct Core;
 
-  std::mutex mutex;
+private:
+  void push (std::function <void () > func);
 
-  bool terminated = false;
+  std::shared_ptr<Core> core;
 
   class StaticConstructor
   {
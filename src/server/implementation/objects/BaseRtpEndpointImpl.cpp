@@ -33,6 +33,9 @@
 #include "EndpointStats.hpp"
 #include "kmsstats.h"
 #include "kmsutils.h"
+#include "kmsremb.h"
+#include "kmsslaballocator.h"
+#include <Metrics.hpp>
 
 #define GST_CAT_DEFAULT kurento_base_rtp_endpoint_impl
 GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
@@ -144,7 +147,8 @@ BaseRtpEndpointImpl::updateMediaState (guint new_state)
     return;
   }
 
-  if (old_state->getValue() != current_media_state->getValue() ) {
+  if (old_state->getValue() != current_media_state->getValue()
+      && !signalMediaStateChanged.empty () ) {
     /* Emit state change signal */
     MediaStateChanged event (shared_from_this(),
                              MediaStateChanged::getName (), old_state, current_media_state);
@@ -175,7 +179,8 @@ BaseRtpEndpointImpl::updateConnectionState (gchar *sessId, guint new_state)
     return;
   }
 
-  if (old_state->getValue() != current_conn_state->getValue() ) {
+  if (old_state->getValue() != current_conn_state->getValue()
+      && !signalConnectionStateChanged.empty () ) {
     /* Emit state change signal */
     ConnectionStateChanged event (shared_from_this(),
                                   ConnectionStateChanged::getName (), old_state, current_conn_state);
@@ -653,6 +658,48 @@ BaseRtpEndpointImpl::StaticConstructor::StaticConstructor()
 {
   GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, GST_DEFAULT_NAME, 0,
                            GST_DEFAULT_NAME);
+
+  MetricsRegistry::getRegistry ().addCollector ([] (MetricsWriter & writer) {
+    /* bps */
+    static const guint64 bounds[] = {
+      50000, 100000, 250000, 500000, 1000000, 2000000, 5000000, 10000000
+    };
+    guint64 counts[G_N_ELEMENTS (bounds) + 1];
+    guint64 sum;
+
+    /* The estimates are never reset, so they are exported as cumulative
+     * buckets and the scraper computes rates and quantiles over time */
+    kms_histogram_get_counts (kms_remb_local_get_estimates (), bounds,
+                              G_N_ELEMENTS (bounds), counts, &sum);
+
+    writer.histogram ("kms_remb_estimate_bps",
+                      "Bitrates announced in REMB packets",
+                      std::vector<double> (bounds, bounds + G_N_ELEMENTS (bounds) ),
+                      std::vector<uint64_t> (counts, counts + G_N_ELEMENTS (counts) ),
+                      sum);
+  });
+
+  MetricsRegistry::getRegistry ().addCollector ([] (MetricsWriter & writer) {
+    GstStructure *stats = kms_slab_allocator_get_stats ();
+    guint64 hits = 0, misses = 0, inUse = 0, cached = 0;
+
+    gst_structure_get_uint64 (stats, "hits", &hits);
+    gst_structure_get_uint64 (stats, "misses", &misses);
+    gst_structure_get_uint64 (stats, "bytes-in-use", &inUse);
+    gst_structure_get_uint64 (stats, "bytes-cached", &cached);
+    gst_structure_free (stats);
+
+    writer.counter ("kms_slab_allocations_total",
+                    "Packet sized allocations, served from a thread cache (hit) or malloc (miss)",
+                    hits, "result=\"hit\"");
+    writer.counter ("kms_slab_allocations_total",
+                    "Packet sized allocations, served from a thread cache (hit) or malloc (miss)",
+                    misses, "result=\"miss\"");
+    writer.gauge ("kms_slab_bytes", "Footprint of the slab allocator", inUse,
+                  "state=\"in_use\"");
+    writer.gauge ("kms_slab_bytes", "Footprint of the slab allocator", cached,
+                  "state=\"cached\"");
+  });
 }
 
 } /* kurento */
@@ -17,6 +17,7 @@
 #include <gst/gst.h>
 #include "MediaType.hpp"
 #include "MediaLatencyStat.hpp"
+#include "ProcessingLatencyStat.hpp"
 #include "MediaType.hpp"
 #include "AudioCaps.hpp"
 #include "VideoCaps.hpp"
@@ -35,7 +36,9 @@
 #include <StatsType.hpp>
 #include "ElementStats.hpp"
 #include "kmsstats.h"
+#include "kmsenctreebin.h"
 #include <SignalHandler.hpp>
+#include <Metrics.hpp>
 
 #define GST_CAT_DEFAULT kurento_media_element_impl
 GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
@@ -46,6 +49,9 @@ GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
 #define MIN_OUTPUT_BITRATE "min-output-bitrate"
 #define MAX_OUTPUT_BITRATE "max-output-bitrate"
 
+/* milliseconds */
+#define MEDIA_FLOW_COALESCE_INTERVAL_DEFAULT 0
+
 #define TYPE_VIDEO "video_"
 #define TYPE_AUDIO "audio_"
 
@@ -54,6 +60,10 @@ namespace kurento
 
 const static std::string DEFAULT = "default";
 
+/* Indexed by direction (in, out) and state (not flowing, flowing) */
+static std::shared_ptr<MetricCounter> mediaFlowChanges[2][2];
+static std::shared_ptr<MetricCounter> mediaFlowSuppressed;
+
 class ElementConnectionDataInternal
 {
 public:
@@ -468,14 +478,8 @@ MediaElementImpl::mediaFlowOutStateChange (gboolean isFlowing, gchar *padName,
     mediaFlowDataOut[key] = data;
   }
 
-  try {
-    MediaFlowOutStateChange event (shared_from_this(),
-                                   MediaFlowOutStateChange::getName (),
-                                   state, padName, padTypeToMediaType (type) );
-
-    signalMediaFlowOutStateChange (event);
-  } catch (std::bad_weak_ptr &e) {
-  }
+  mediaFlowChanges[1][isFlowing ? 1 : 0]->inc ();
+  postMediaFlowEvent (true, key, state, padName, type);
 }
 
 void
@@ -513,14 +517,163 @@ MediaElementImpl::mediaFlowInStateChange (gboolean isFlowing, gchar *padName,
     mediaFlowDataIn[key] = data;
   }
 
+  mediaFlowChanges[0][isFlowing ? 1 : 0]->inc ();
+  postMediaFlowEvent (false, key, state, padName, type);
+}
+
+void
+MediaElementImpl::emitMediaFlowEvent (bool out,
+                                      std::shared_ptr<MediaFlowState> state,
+                                      const std::string &padName, KmsElementPadType type)
+{
   try {
-    MediaFlowInStateChange event (shared_from_this(),
-                                  MediaFlowInStateChange::getName (),
-                                  state, padName, padTypeToMediaType (type) );
+    if (out) {
+      MediaFlowOutStateChange event (shared_from_this(),
+                                     MediaFlowOutStateChange::getName (),
+                                     state, padName, padTypeToMediaType (type) );
+
+      signalMediaFlowOutStateChange (event);
+    } else {
+      MediaFlowInStateChange event (shared_from_this(),
+                                    MediaFlowInStateChange::getName (),
+                                    state, padName, padTypeToMediaType (type) );
+
+      signalMediaFlowInStateChange (event);
+    }
+  } catch (std::bad_weak_ptr &e) {
+  }
+}
+
+struct MediaFlowWindowData {
+  std::weak_ptr<MediaObjectImpl> element;
+  std::string key;
+};
+
+gboolean
+media_flow_window_timeout (gpointer user_data)
+{
+  MediaFlowWindowData *data = (MediaFlowWindowData *) user_data;
+  std::shared_ptr<MediaElementImpl> self =
+    std::dynamic_pointer_cast<MediaElementImpl> (data->element.lock () );
+
+  if (!self) {
+    return G_SOURCE_REMOVE;
+  }
+
+  return self->flushMediaFlowEvent (data->key) ? G_SOURCE_CONTINUE :
+         G_SOURCE_REMOVE;
+}
+
+static void
+media_flow_window_data_destroy (gpointer user_data)
+{
+  delete (MediaFlowWindowData *) user_data;
+}
+
+/*
+ * The first transition of a pad is sent at once and opens a coalescing
+ * window. Transitions received while the window is open only update the
+ * pending state, which is sent when the window expires unless it matches
+ * the last state that was notified.
+ */
+void
+MediaElementImpl::postMediaFlowEvent (bool out, const std::string &key,
+                                      std::shared_ptr<MediaFlowState> state,
+                                      const std::string &padName, KmsElementPadType type)
+{
+  if ( (out && signalMediaFlowOutStateChange.empty () ) ||
+       (!out && signalMediaFlowInStateChange.empty () ) ) {
+    return;
+  }
+
+  if (mediaFlowCoalesceInterval == 0) {
+    emitMediaFlowEvent (out, state, padName, type);
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock (mediaFlowWindowsMutex);
+  std::string windowKey = (out ? "out_" : "in_") + key;
+  auto it = mediaFlowWindows.find (windowKey);
+
+  if (it != mediaFlowWindows.end () ) {
+    MediaFlowWindow &window = it->second;
 
-    signalMediaFlowInStateChange (event);
+    if (window.pending) {
+      suppressedMediaFlowEvents++;
+      mediaFlowSuppressed->inc ();
+    }
+
+    window.pending = state;
+    return;
+  }
+
+  MediaFlowWindow window;
+  MediaFlowWindowData *data = new MediaFlowWindowData ();
+
+  try {
+    data->element = shared_from_this ();
   } catch (std::bad_weak_ptr &e) {
+    delete data;
+    return;
+  }
+
+  data->key = windowKey;
+
+  window.out = out;
+  window.padName = padName;
+  window.type = type;
+  window.notified = state;
+  window.source = g_timeout_add_full (G_PRIORITY_DEFAULT,
+                                      mediaFlowCoalesceInterval, media_flow_window_timeout, data,
+                                      media_flow_window_data_destroy);
+  mediaFlowWindows[windowKey] = window;
+
+  lock.unlock ();
+
+  emitMediaFlowEvent (out, state, padName, type);
+}
+
+bool
+MediaElementImpl::flushMediaFlowEvent (const std::string &key)
+{
+  std::unique_lock<std::mutex> lock (mediaFlowWindowsMutex);
+  auto it = mediaFlowWindows.find (key);
+
+  if (it == mediaFlowWindows.end () ) {
+    return false;
+  }
+
+  MediaFlowWindow &window = it->second;
+  std::shared_ptr<MediaFlowState> state = window.pending;
+
+  window.pending.reset ();
+
+  if (!state) {
+    /* Nothing happened during the window, close it */
+    mediaFlowWindows.erase (it);
+    return false;
+  }
+
+  if (state->getValue () == window.notified->getValue () ) {
+    /* Transitions cancelled each other out */
+    suppressedMediaFlowEvents++;
+    mediaFlowSuppressed->inc ();
+    GST_DEBUG_OBJECT (element, "Suppressed media flow events: %" G_GUINT64_FORMAT,
+                      (guint64) suppressedMediaFlowEvents);
+    return true;
   }
+
+  bool out = window.out;
+  std::string padName = window.padName;
+  KmsElementPadType type = window.type;
+
+  window.notified = state;
+  lock.unlock ();
+
+  /* Keep the window open while the state keeps changing */
+  emitMediaFlowEvent (out, state, padName, type);
+
+  return true;
 }
 
 void
@@ -571,6 +724,9 @@ MediaElementImpl::MediaElementImpl (const boost::property_tree::ptree &config,
   g_object_ref (element);
   pipe->addElement (element);
 
+  mediaFlowCoalesceInterval = getConfigValue<guint, MediaElement>
+                              ("mediaFlowCoalesceInterval", MEDIA_FLOW_COALESCE_INTERVAL_DEFAULT);
+
   //read default configuration for output bitrate
   try {
     int bitrate = getConfigValue<int, MediaElement> ("outputBitrate");
@@ -600,13 +756,32 @@ MediaElementImpl::~MediaElementImpl ()
     unregister_signal_handler (element, mediaFlowInHandler);
   }
 
-  disconnectAll();
+  std::unique_lock<std::mutex> windowsLock (mediaFlowWindowsMutex);
+
+  for (auto &it : mediaFlowWindows) {
+    g_source_remove (it.second.source);
+  }
+
+  mediaFlowWindows.clear ();
+  windowsLock.unlock ();
+
+  if (suppressedMediaFlowEvents > 0) {
+    GST_INFO ("%" G_GUINT64_FORMAT " media flow events suppressed in %s",
+              (guint64) suppressedMediaFlowEvents, getName().c_str () );
+  }
 
   pipe = std::dynamic_pointer_cast<MediaPipelineImpl> (getMediaPipeline() );
 
-  gst_element_set_locked_state (element, TRUE);
-  gst_element_set_state (element, GST_STATE_NULL);
-  gst_bin_remove (GST_BIN ( pipe->getPipeline() ), element);
+  if (pipe->isTearingDown () ) {
+    /* Pipeline is already stopped and removes its children when disposed */
+    dropConnections ();
+  } else {
+    disconnectAll();
+
+    gst_element_set_locked_state (element, TRUE);
+    gst_element_set_state (element, GST_STATE_NULL);
+    gst_bin_remove (GST_BIN ( pipe->getPipeline() ), element);
+  }
 
   g_object_unref (element);
 
@@ -617,11 +792,40 @@ MediaElementImpl::~MediaElementImpl ()
 void
 MediaElementImpl::release ()
 {
-  disconnectAll ();
+  if (isPipelineTearingDown () ) {
+    dropConnections ();
+  } else {
+    disconnectAll ();
+  }
 
   MediaObjectImpl::release();
 }
 
+bool
+MediaElementImpl::isPipelineTearingDown ()
+{
+  std::shared_ptr<MediaPipelineImpl> pipe =
+    std::dynamic_pointer_cast<MediaPipelineImpl> (getMediaPipeline() );
+
+  return pipe && pipe->isTearingDown ();
+}
+
+/*
+ * Forgets the connections of the element without unlinking pads nor emitting
+ * disconnection events. Only valid when the whole pipeline is being released,
+ * as the peers are going away too.
+ */
+void
+MediaElementImpl::dropConnections ()
+{
+  std::unique_lock<std::recursive_timed_mutex> sinkLock (sinksMutex);
+  sinks.clear ();
+  sinkLock.unlock ();
+
+  std::unique_lock<std::recursive_timed_mutex> sourceLock (sourcesMutex);
+  sources.clear ();
+}
+
 void MediaElementImpl::disconnectAll ()
 {
   while (!getSinkConnections().empty() ) {
@@ -900,6 +1104,10 @@ void MediaElementImpl::connect (std::shared_ptr<MediaElement> sink,
   sinkLock.unlock();
   lock.unlock ();
 
+  if (signalElementConnected.empty () ) {
+    return;
+  }
+
   ElementConnected elementConnected (shared_from_this(),
                                      ElementConnected::getName (),
                                      sink, mediaType, sourceMediaDescription,
@@ -907,6 +1115,165 @@ void MediaElementImpl::connect (std::shared_ptr<MediaElement> sink,
   signalElementConnected (elementConnected);
 }
 
+std::vector<std::shared_ptr<ElementConnectionData>>
+    MediaElementImpl::connectMany (const
+                                   std::vector<std::shared_ptr<MediaElement>> &sinks,
+                                   std::shared_ptr<MediaType> mediaType)
+{
+  return connectMany (sinks, mediaType, DEFAULT, DEFAULT);
+}
+
+std::vector<std::shared_ptr<ElementConnectionData>>
+    MediaElementImpl::connectMany (const
+                                   std::vector<std::shared_ptr<MediaElement>> &sinks,
+                                   std::shared_ptr<MediaType> mediaType,
+                                   const std::string &sourceMediaDescription)
+{
+  return connectMany (sinks, mediaType, sourceMediaDescription, DEFAULT);
+}
+
+std::vector<std::shared_ptr<ElementConnectionData>>
+    MediaElementImpl::connectMany (const
+                                   std::vector<std::shared_ptr<MediaElement>> &sinks,
+                                   std::shared_ptr<MediaType> mediaType,
+                                   const std::string &sourceMediaDescription,
+                                   const std::string &sinkMediaDescription)
+{
+  std::vector<std::shared_ptr<ElementConnectionData>> ret;
+  std::vector<std::shared_ptr<ElementConnectionDataInternal>> pending;
+  std::map<std::string, std::shared_ptr<MediaElementImpl>> sinkImpls;
+  std::vector<std::unique_lock<std::recursive_timed_mutex>> sinkLocks;
+  std::shared_ptr<MediaElement> self =
+    std::dynamic_pointer_cast<MediaElement> (shared_from_this () );
+  std::string pipelineId = getMediaPipeline ()->getId ();
+  KmsElementPadType type = convertMediaType (mediaType);
+  gchar **padNames = NULL;
+  size_t granted = 0;
+
+  /* Keyed by id, so duplicates are dropped and sinks are locked in the same
+   * order by every caller */
+  for (auto sink : sinks) {
+    std::shared_ptr<MediaElementImpl> sinkImpl =
+      std::dynamic_pointer_cast<MediaElementImpl> (sink);
+
+    if (!sinkImpl) {
+      continue;
+    }
+
+    if (sinkImpl->getMediaPipeline ()->getId () != pipelineId) {
+      GST_WARNING ("Cannot connect %s -> %s: elements do not share pipeline",
+                   getName ().c_str (), sinkImpl->getName ().c_str () );
+      continue;
+    }
+
+    sinkImpls[sinkImpl->getId ()] = sinkImpl;
+  }
+
+  if (sinkImpls.empty () ) {
+    return ret;
+  }
+
+  std::unique_lock<std::recursive_timed_mutex> lock (sinksMutex);
+
+  /* Held until every connection is recorded, so a concurrent connect cannot
+   * replace a source between both phases */
+  for (auto &it : sinkImpls) {
+    sinkLocks.push_back (std::unique_lock<std::recursive_timed_mutex>
+                         (it.second->sourcesMutex) );
+  }
+
+  /* Nothing is touched until every pad has been granted, so a failure
+   * leaves the sinks with their previous sources */
+  for (auto &it : sinkImpls) {
+    std::shared_ptr<MediaElement> sink =
+      std::dynamic_pointer_cast<MediaElement> (it.second);
+
+    pending.push_back (std::shared_ptr <ElementConnectionDataInternal> (
+                         new ElementConnectionDataInternal (self, sink, mediaType,
+                             sourceMediaDescription, sinkMediaDescription) ) );
+  }
+
+  GST_DEBUG ("Connecting %s -> %" G_GSIZE_FORMAT " sinks params %s %s %s",
+             getName().c_str(), pending.size (), mediaType->getString ().c_str (),
+             sourceMediaDescription.c_str(), sinkMediaDescription.c_str() );
+
+  /* One request for all the source pads instead of one per sink */
+  g_signal_emit_by_name (getGstreamerElement (), "request-new-pads", type,
+                         sourceMediaDescription.c_str (), (guint) pending.size (),
+                         &padNames, NULL);
+
+  while (padNames != NULL && padNames[granted] != NULL) {
+    granted++;
+  }
+
+  if (granted < pending.size () ) {
+    /* All or nothing, give back the pads already reserved */
+    for (size_t i = 0; i < granted; i++) {
+      gboolean released;
+
+      g_signal_emit_by_name (getGstreamerElement (), "release-requested-pad",
+                             padNames[i], &released, NULL);
+    }
+
+    g_strfreev (padNames);
+
+    throw KurentoException (CONNECT_ERROR, "Element: '" + getName() +
+                            "'does note provide " + std::to_string (pending.size () ) +
+                            " connections for " + mediaType->getString () + "-" +
+                            sourceMediaDescription);
+  }
+
+  for (size_t i = 0; i < pending.size (); i++) {
+    std::shared_ptr <ElementConnectionDataInternal> connectionData = pending[i];
+    std::shared_ptr<MediaElementImpl> sinkImpl = connectionData->getSink ();
+    std::shared_ptr<MediaElement> sink =
+      std::dynamic_pointer_cast<MediaElement> (sinkImpl);
+    std::vector <std::shared_ptr <ElementConnectionData>> connections;
+
+    connections = sink->getSourceConnections (mediaType, sinkMediaDescription);
+
+    if (!connections.empty () ) {
+      std::shared_ptr <ElementConnectionData> connection = connections.at (0);
+      connection->getSource()->disconnect (connection->getSink (), mediaType,
+                                           sourceMediaDescription,
+                                           connection->getSinkDescription () );
+    }
+
+    sinkImpl->prepareSinkConnection (self, mediaType, sourceMediaDescription,
+                                     sinkMediaDescription);
+
+    /* Connection data takes ownership of the pad name */
+    connectionData->setSourcePadName (padNames[i]);
+
+    this->sinks[mediaType][sourceMediaDescription].insert (connectionData);
+    sinkImpl->sources[mediaType][sinkMediaDescription] = connectionData;
+
+    performConnection (connectionData);
+
+    ret.push_back (connectionData->toInterface () );
+  }
+
+  g_free (padNames);
+
+  sinkLocks.clear ();
+  lock.unlock ();
+
+  if (signalElementConnected.empty () ) {
+    return ret;
+  }
+
+  for (auto connection : ret) {
+    ElementConnected elementConnected (shared_from_this(),
+                                       ElementConnected::getName (),
+                                       connection->getSink (), mediaType,
+                                       sourceMediaDescription,
+                                       sinkMediaDescription);
+    signalElementConnected (elementConnected);
+  }
+
+  return ret;
+}
+
 void
 MediaElementImpl::performConnection (std::shared_ptr
                                      <ElementConnectionDataInternal> data)
@@ -1020,6 +1387,10 @@ void MediaElementImpl::disconnect (std::shared_ptr<MediaElement> sink,
   sinkLock.unlock();
   lock.unlock ();
 
+  if (signalElementDisconnected.empty () ) {
+    return;
+  }
+
   ElementDisconnected elementDisconnected (shared_from_this(),
       ElementDisconnected::getName (),
       sink, mediaType, sourceMediaDescription,
@@ -1202,6 +1573,32 @@ std::map <std::string, std::shared_ptr<Stats>>
   return statsReport;
 }
 
+void
+MediaElementImpl::collectStats (std::map <std::string, std::shared_ptr<Stats>>
+                                &report, double timestamp)
+{
+  std::map <std::string, std::shared_ptr<Stats>> elementReport;
+  GstStructure *stats = NULL;
+  std::string id = getId ();
+
+  g_signal_emit_by_name (getGstreamerElement(), "stats", NULL, &stats);
+
+  if (stats == NULL) {
+    return;
+  }
+
+  fillStatsReport (elementReport, stats, timestamp);
+  gst_structure_free (stats);
+
+  for (auto &it : elementReport) {
+    if (it.first == id) {
+      report[id] = it.second;
+    } else {
+      report[id + "/" + it.first] = it.second;
+    }
+  }
+}
+
 std::map <std::string, std::shared_ptr<Stats>>
     MediaElementImpl::getStats ()
 {
@@ -1258,8 +1655,9 @@ MediaElementImpl::collectLatencyStats (
   for (i = 0; i < fields; i ++) {
     const gchar *fieldname;
     const GValue *val;
+    const GstStructure *padStats;
     gchar *mediaType;
-    guint64 avg;
+    guint64 avg, min, p50, p90, p99, max;
 
     fieldname = gst_structure_nth_field_name (stats, i);
     val = gst_structure_get_value (stats, fieldname);
@@ -1269,18 +1667,60 @@ MediaElementImpl::collectLatencyStats (
       continue;
     }
 
-    gst_structure_get (gst_value_get_structure (val), "type", G_TYPE_STRING,
-                       &mediaType, "avg", G_TYPE_UINT64, &avg, NULL);
+    padStats = gst_value_get_structure (val);
+    gst_structure_get (padStats, "type", G_TYPE_STRING, &mediaType, "avg",
+                       G_TYPE_UINT64, &avg, NULL);
 
     std::shared_ptr<MediaType> type = getMediaTypeFromTypeSelector (mediaType);
     std::shared_ptr<MediaLatencyStat> latency =
       std::make_shared <MediaLatencyStat> (fieldname, type, avg);
     g_free (mediaType);
 
+    if (gst_structure_get (padStats, "min", G_TYPE_UINT64, &min, "p50",
+                           G_TYPE_UINT64, &p50, "p90", G_TYPE_UINT64, &p90, "p99", G_TYPE_UINT64,
+                           &p99, "max", G_TYPE_UINT64, &max, NULL) ) {
+      latency->setMin (min);
+      latency->setP50 (p50);
+      latency->setP90 (p90);
+      latency->setP99 (p99);
+      latency->setMax (max);
+    }
+
     latencyStats.push_back (latency);
   }
 }
 
+static void
+collectProcessingLatencyStats (
+  std::vector<std::shared_ptr<ProcessingLatencyStat>> &latencyStats,
+  const GstStructure *stats)
+{
+  gint i, fields;
+
+  fields = gst_structure_n_fields (stats);
+
+  for (i = 0; i < fields; i ++) {
+    const gchar *fieldname;
+    const GValue *val;
+    guint64 count = 0, p50 = 0, p99 = 0, p999 = 0, max = 0;
+
+    fieldname = gst_structure_nth_field_name (stats, i);
+    val = gst_structure_get_value (stats, fieldname);
+
+    if (!GST_VALUE_HOLDS_STRUCTURE (val) ) {
+      GST_DEBUG ("Ignore unexpected value for field %s", fieldname);
+      continue;
+    }
+
+    gst_structure_get (gst_value_get_structure (val), "count", G_TYPE_UINT64,
+                       &count, "p50", G_TYPE_UINT64, &p50, "p99", G_TYPE_UINT64, &p99,
+                       "p999", G_TYPE_UINT64, &p999, "max", G_TYPE_UINT64, &max, NULL);
+
+    latencyStats.push_back (std::make_shared <ProcessingLatencyStat> (fieldname,
+                            count, p50, p99, p999, max) );
+  }
+}
+
 static void
 setDeprecatedProperties (std::shared_ptr<ElementStats> eStats)
 {
@@ -1344,6 +1784,25 @@ MediaElementImpl::fillStatsReport (std::map
 
   setDeprecatedProperties (std::dynamic_pointer_cast <ElementStats>
                            (report[getId ()]) );
+
+  if (gst_structure_get (gst_value_get_structure (value), "processing-latency",
+                         GST_TYPE_STRUCTURE, &latencies, NULL) ) {
+    std::vector<std::shared_ptr<ProcessingLatencyStat>> processingLatencies;
+
+    collectProcessingLatencyStats (processingLatencies, latencies);
+    gst_structure_free (latencies);
+
+    std::dynamic_pointer_cast <ElementStats> (report[getId ()])->
+    setProcessingLatency (processingLatencies);
+  }
+
+  std::shared_ptr<MediaPipelineImpl> pipe =
+    std::dynamic_pointer_cast<MediaPipelineImpl> (getMediaPipeline() );
+
+  if (pipe) {
+    std::dynamic_pointer_cast <ElementStats> (report[getId ()])->
+    setStreamingThreads (pipe->getStreamingThreads (element) );
+  }
 }
 
 bool MediaElementImpl::isMediaFlowingIn (std::shared_ptr<MediaType> mediaType)
@@ -1416,8 +1875,30 @@ MediaElementImpl::StaticConstructor MediaElementImpl::staticConstructor;
 
 MediaElementImpl::StaticConstructor::StaticConstructor()
 {
+  MetricsRegistry &metrics = MetricsRegistry::getRegistry ();
+  const char *directions[] = {"in", "out"};
+  const char *states[] = {"not_flowing", "flowing"};
+
   GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, GST_DEFAULT_NAME, 0,
                            GST_DEFAULT_NAME);
+
+  for (int i = 0; i < 2; i++) {
+    for (int j = 0; j < 2; j++) {
+      mediaFlowChanges[i][j] = metrics.getCounter ("kms_media_flow_changes_total",
+                               "Media flow state changes of element pads",
+                               std::string ("direction=\"") + directions[i] + "\",state=\"" +
+                               states[j] + "\"");
+    }
+  }
+
+  mediaFlowSuppressed = metrics.getCounter (
+                          "kms_media_flow_events_suppressed_total",
+                          "Media flow events dropped by the coalescing window");
+
+  metrics.addCollector ([] (MetricsWriter & writer) {
+    writer.gauge ("kms_encoders_active", "Encoders currently instantiated",
+                  kms_enc_tree_bin_get_active_count () );
+  });
 }
 
 } /* kurento */
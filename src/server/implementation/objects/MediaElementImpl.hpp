@@ -26,6 +26,7 @@
 #include <mutex>
 #include <set>
 #include <random>
+#include <atomic>
 #include "MediaFlowOutStateChange.hpp"
 #include "MediaFlowInStateChange.hpp"
 #include "MediaFlowState.hpp"
@@ -124,6 +125,18 @@ public:
                         std::shared_ptr<MediaType> mediaType,
                         const std::string &sourceMediaDescription,
                         const std::string &sinkMediaDescription) override;
+  virtual std::vector<std::shared_ptr<ElementConnectionData>> connectMany (
+        const std::vector<std::shared_ptr<MediaElement>> &sinks,
+        std::shared_ptr<MediaType> mediaType) override;
+  virtual std::vector<std::shared_ptr<ElementConnectionData>> connectMany (
+        const std::vector<std::shared_ptr<MediaElement>> &sinks,
+        std::shared_ptr<MediaType> mediaType,
+        const std::string &sourceMediaDescription) override;
+  virtual std::vector<std::shared_ptr<ElementConnectionData>> connectMany (
+        const std::vector<std::shared_ptr<MediaElement>> &sinks,
+        std::shared_ptr<MediaType> mediaType,
+        const std::string &sourceMediaDescription,
+        const std::string &sinkMediaDescription) override;
   virtual void disconnect (std::shared_ptr<MediaElement> sink) override;
   virtual void disconnect (std::shared_ptr<MediaElement> sink,
                            std::shared_ptr<MediaType> mediaType) override;
@@ -179,6 +192,11 @@ public:
 
   virtual void Serialize (JsonSerializer &serializer) override;
 
+  /* Adds the stats of the element to a report shared with other elements,
+   * keys other than the element id are prefixed with it */
+  void collectStats (std::map <std::string, std::shared_ptr<Stats>> &report,
+                     double timestamp);
+
 protected:
   GstElement *element;
   GstBus *bus;
@@ -214,7 +232,23 @@ private:
   gulong mediaFlowOutHandler = 0;
   gulong mediaFlowInHandler = 0;
 
+  struct MediaFlowWindow {
+    bool out;
+    std::string padName;
+    KmsElementPadType type;
+    std::shared_ptr<MediaFlowState> notified;
+    std::shared_ptr<MediaFlowState> pending;
+    guint source;
+  };
+
+  std::mutex mediaFlowWindowsMutex;
+  std::map <std::string, MediaFlowWindow> mediaFlowWindows;
+  guint mediaFlowCoalesceInterval = 0;
+  std::atomic<uint64_t> suppressedMediaFlowEvents {0};
+
   void disconnectAll();
+  void dropConnections ();
+  bool isPipelineTearingDown ();
   void performConnection (std::shared_ptr <ElementConnectionDataInternal> data);
   std::map <std::string, std::shared_ptr<Stats>> generateStats (
         const gchar *selector);
@@ -222,6 +256,12 @@ private:
                                 KmsElementPadType type);
   void mediaFlowInStateChange (gboolean isFlowing, gchar *padName,
                                KmsElementPadType type);
+  void postMediaFlowEvent (bool out, const std::string &key,
+                           std::shared_ptr<MediaFlowState> state,
+                           const std::string &padName, KmsElementPadType type);
+  void emitMediaFlowEvent (bool out, std::shared_ptr<MediaFlowState> state,
+                           const std::string &padName, KmsElementPadType type);
+  bool flushMediaFlowEvent (const std::string &key);
 
   class StaticConstructor
   {
@@ -235,6 +275,7 @@ private:
       gpointer data);
   friend void _media_element_pad_added (GstElement *elem, GstPad *pad,
                                         gpointer data);
+  friend gboolean media_flow_window_timeout (gpointer user_data);
 };
 
 } /* kurento */
@@ -58,17 +58,25 @@ MediaObjectImpl::getMediaPipeline ()
 std::string
 MediaObjectImpl::createId()
 {
-  std::string uuid = generateUUID();
+  char uuid[UUID_STRING_LENGTH];
+  std::string id;
+
+  generateUUID (uuid);
 
   if (parent) {
     std::shared_ptr<MediaObjectImpl> parent;
+    std::string parentId;
 
     parent = std::dynamic_pointer_cast<MediaObjectImpl> (getParent() );
-    return parent->getId() + "/" +
-           uuid;
-  } else {
-    return uuid;
+    parentId = parent->getId();
+
+    id.reserve (parentId.size () + 1 + UUID_STRING_LENGTH);
+    id.append (parentId).append (1, '/');
   }
+
+  id.append (uuid, UUID_STRING_LENGTH);
+
+  return id;
 }
 
 std::string
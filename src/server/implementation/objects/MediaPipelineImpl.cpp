@@ -24,6 +24,9 @@
 #include <GstreamerDotDetails.hpp>
 #include <SignalHandler.hpp>
 #include "kmselement.h"
+#include "kmshistogram.h"
+#include <MediaSet.hpp>
+#include <MediaElementImpl.hpp>
 
 #define GST_CAT_DEFAULT kurento_media_pipeline_impl
 GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
@@ -110,6 +113,20 @@ MediaPipelineImpl::MediaPipelineImpl (const boost::property_tree::ptree &config)
   gst_pipeline_use_clock (GST_PIPELINE (pipeline), clock);
   g_object_unref (clock);
 
+  PipelineScheduleConfig scheduleConfig;
+  scheduleConfig.pin = getConfigValue<bool, MediaPipeline> ("cpuAffinity",
+                       false);
+  scheduleConfig.cpusPerPipeline = getConfigValue<int, MediaPipeline>
+                                   ("cpusPerPipeline", 1);
+  scheduleConfig.sharedTaskPool = getConfigValue<bool, MediaPipeline>
+                                  ("sharedTaskPool", false);
+  scheduleConfig.accountMemory = getConfigValue<bool, MediaPipeline>
+                                 ("memoryAccounting", false);
+  scheduleConfig.accountThreads = getConfigValue<bool, MediaPipeline>
+                                  ("threadAccounting", false);
+  schedule = PipelineScheduler::getScheduler ().schedule (pipeline,
+             scheduleConfig);
+
   gst_element_set_state (pipeline, GST_STATE_PLAYING);
 
   busMessageHandler = 0;
@@ -120,6 +137,7 @@ MediaPipelineImpl::~MediaPipelineImpl ()
   GstBus *bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline) );
 
   gst_element_set_state (pipeline, GST_STATE_NULL);
+  schedule.reset ();
 
   if (busMessageHandler > 0) {
     unregister_signal_handler (bus, busMessageHandler);
@@ -130,6 +148,18 @@ MediaPipelineImpl::~MediaPipelineImpl ()
   g_object_unref (pipeline);
 }
 
+void
+MediaPipelineImpl::release ()
+{
+  GST_DEBUG ("Tearing down pipeline %s", getId().c_str () );
+
+  /* Stop the whole pipeline at once instead of element by element */
+  tearingDown = true;
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  MediaObjectImpl::release ();
+}
+
 std::string MediaPipelineImpl::getGstreamerDot (
   std::shared_ptr<GstreamerDotDetails> details)
 {
@@ -143,6 +173,36 @@ std::string MediaPipelineImpl::getGstreamerDot()
                                  GstreamerDotDetails::SHOW_VERBOSE) ) );
 }
 
+int64_t
+MediaPipelineImpl::getCpuTime ()
+{
+  return schedule->getCpuTime () / 1000;
+}
+
+int64_t
+MediaPipelineImpl::getUsedMemory ()
+{
+  return schedule->getMemory () / 1024;
+}
+
+int64_t
+MediaPipelineImpl::getPeakMemory ()
+{
+  return schedule->getPeakMemory () / 1024;
+}
+
+int
+MediaPipelineImpl::getStreamingThreads ()
+{
+  return schedule->getThreadCount ();
+}
+
+int
+MediaPipelineImpl::getStreamingThreads (GstElement *element)
+{
+  return schedule->getThreadCount (element);
+}
+
 bool
 MediaPipelineImpl::getLatencyStats ()
 {
@@ -193,6 +253,60 @@ MediaPipelineImpl::setLatencyStats (bool latencyStats)
   gst_iterator_free (it);
 }
 
+static void
+collect_children_stats (std::shared_ptr<MediaObjectImpl> obj,
+                        std::map <std::string, std::shared_ptr<Stats>> &report,
+                        double timestamp)
+{
+  for (auto child : MediaSet::getMediaSet ()->getChildren (obj) ) {
+    std::shared_ptr<MediaElementImpl> element =
+      std::dynamic_pointer_cast<MediaElementImpl> (child);
+
+    if (element) {
+      element->collectStats (report, timestamp);
+    }
+
+    /* Hub ports are children of their hub */
+    collect_children_stats (child, report, timestamp);
+  }
+}
+
+void
+MediaPipelineImpl::collectStats (std::map <std::string, std::shared_ptr<Stats>>
+                                 &report, double timestamp)
+{
+  std::shared_ptr<MediaObjectImpl> self;
+
+  try {
+    self = std::dynamic_pointer_cast<MediaObjectImpl> (shared_from_this () );
+  } catch (std::bad_weak_ptr &e) {
+    return;
+  }
+
+  collect_children_stats (self, report, timestamp);
+}
+
+std::map <std::string, std::shared_ptr<Stats>>
+    MediaPipelineImpl::getStats ()
+{
+  std::map <std::string, std::shared_ptr<Stats>> report;
+
+  collectStats (report, time (NULL) );
+
+  return report;
+}
+
+std::string
+MediaPipelineImpl::dumpLatencyHistograms ()
+{
+  gchar *dump = kms_processing_latency_dump (pipeline);
+  std::string ret = dump;
+
+  g_free (dump);
+
+  return ret;
+}
+
 bool
 MediaPipelineImpl::addElement (GstElement *element)
 {
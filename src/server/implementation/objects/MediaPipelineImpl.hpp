@@ -20,8 +20,10 @@
 #include "MediaObjectImpl.hpp"
 #include "MediaPipeline.hpp"
 #include <EventHandler.hpp>
+#include <PipelineScheduler.hpp>
 #include <gst/gst.h>
 #include <boost/property_tree/ptree.hpp>
+#include <atomic>
 
 namespace kurento
 {
@@ -52,6 +54,25 @@ public:
   virtual bool getLatencyStats ();
   virtual void setLatencyStats (bool latencyStats);
 
+  virtual int64_t getCpuTime ();
+  virtual int getStreamingThreads ();
+
+  /* Streaming threads running inside one of the elements of the pipeline */
+  int getStreamingThreads (GstElement *element);
+
+  /* KiB allocated by the streaming threads and still in use, and the
+   * highest it has been. Only tracked with memoryAccounting enabled */
+  int64_t getUsedMemory ();
+  int64_t getPeakMemory ();
+
+  virtual std::map <std::string, std::shared_ptr<Stats>> getStats ();
+
+  virtual std::string dumpLatencyHistograms ();
+
+  /* Adds the stats of every element of the pipeline to report */
+  void collectStats (std::map <std::string, std::shared_ptr<Stats>> &report,
+                     double timestamp);
+
   /* Next methods are automatically implemented by code generator */
   virtual bool connect (const std::string &eventType,
                         std::shared_ptr<EventHandler> handler);
@@ -64,6 +85,15 @@ public:
 
   bool addElement (GstElement *element);
 
+  virtual void release ();
+
+  /* True once the pipeline has been released, its elements are going away
+   * with it and do not need to be cleaned up one by one */
+  bool isTearingDown ()
+  {
+    return tearingDown;
+  }
+
 protected:
   virtual void postConstructor ();
 private:
@@ -74,6 +104,8 @@ private:
 
   std::recursive_mutex recMutex;
   bool latencyStats = false;
+  std::atomic<bool> tearingDown {false};
+  std::shared_ptr<PipelineSchedule> schedule;
 
   void busMessage (GstMessage *message);
 
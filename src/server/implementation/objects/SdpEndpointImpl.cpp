@@ -23,6 +23,9 @@
 #include <fstream>
 #include <CodecConfiguration.hpp>
 #include <gst/sdp/gstsdpmessage.h>
+#include <boost/property_tree/json_parser.hpp>
+#include <map>
+#include <sstream>
 
 #define GST_CAT_DEFAULT kurento_sdp_endpoint_impl
 GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
@@ -90,39 +93,80 @@ append_codec_to_array (GArray *array, const char *codec)
   g_array_append_val (array, v);
 }
 
-void SdpEndpointImpl::postConstructor ()
+/*
+ * Media configuration shared by every endpoint of the same type. Reading it
+ * from the module config means a JSON round trip per key, so it is parsed
+ * once per endpoint type and reused by later endpoints as long as the
+ * config section of the type does not change.
+ */
+struct SdpOfferTemplate {
+  /* Config section the template was built from */
+  std::string config;
+  guint audioMedias;
+  guint videoMedias;
+  std::vector<std::string> audioCodecs;
+  std::vector<std::string> videoCodecs;
+};
+
+/* One template per module.type, replaced when its config changes */
+static std::mutex templatesMutex;
+static std::map<std::string, std::shared_ptr<SdpOfferTemplate>>
+    offerTemplates;
+
+static std::string
+config_section (const boost::property_tree::ptree &config,
+                const std::string &path)
 {
-  gchar *sess_id;
-  SessionEndpointImpl::postConstructor ();
+  auto section = config.get_child_optional (path);
+  std::stringstream ss;
 
-  g_signal_emit_by_name (element, "create-session", &sess_id);
+  if (!section) {
+    return "";
+  }
 
-  if (sess_id == NULL) {
-    throw KurentoException (SDP_END_POINT_CANNOT_CREATE_SESSON,
-                            "Cannot create session");
+  boost::property_tree::write_json (ss, *section, false);
+
+  return ss.str ();
+}
+
+static GArray *
+codecs_to_array (const std::vector<std::string> &codecs)
+{
+  GArray *array;
+
+  array = g_array_sized_new (FALSE, TRUE, sizeof (GValue), codecs.size () );
+
+  for (const std::string &codec : codecs) {
+    append_codec_to_array (array, codec.c_str () );
   }
 
-  sessId = std::string (sess_id);
-  g_free (sess_id);
+  return array;
 }
 
-SdpEndpointImpl::SdpEndpointImpl (const boost::property_tree::ptree &config,
-                                  std::shared_ptr< MediaObjectImpl > parent,
-                                  const std::string &factoryName, bool useIpv6) :
-  SessionEndpointImpl (config, parent, factoryName)
+std::shared_ptr<SdpOfferTemplate>
+SdpEndpointImpl::getOfferTemplate ()
 {
-  GArray *audio_codecs, *video_codecs;
-  guint audio_medias, video_medias;
+  std::string type = getModule () + "." + getType ();
+  std::string section = config_section (config, "modules." + type);
+  std::shared_ptr<SdpOfferTemplate> tmpl;
+  std::unique_lock <std::mutex> lock (templatesMutex);
 
-  audio_codecs = g_array_new (FALSE, TRUE, sizeof (GValue) );
-  video_codecs = g_array_new (FALSE, TRUE, sizeof (GValue) );
+  auto it = offerTemplates.find (type);
 
-  //   TODO: Add support for this events
-  //   g_signal_connect (element, "media-start", G_CALLBACK (media_start_cb), this);
-  //   g_signal_connect (element, "media-stop", G_CALLBACK (media_stop_cb), this);
+  if (it != offerTemplates.end () && it->second->config == section) {
+    return it->second;
+  }
+
+  /* Parsing is slow, do not hold back other endpoints meanwhile */
+  lock.unlock ();
+
+  tmpl = std::make_shared<SdpOfferTemplate> ();
+  tmpl->config = section;
 
-  audio_medias = getConfigValue <guint, SdpEndpoint> (PARAM_NUM_AUDIO_MEDIAS, 1);
-  video_medias = getConfigValue <guint, SdpEndpoint> (PARAM_NUM_VIDEO_MEDIAS, 1);
+  tmpl->audioMedias = getConfigValue <guint, SdpEndpoint>
+                      (PARAM_NUM_AUDIO_MEDIAS, 1);
+  tmpl->videoMedias = getConfigValue <guint, SdpEndpoint>
+                      (PARAM_NUM_VIDEO_MEDIAS, 1);
 
   try {
     std::vector<std::shared_ptr<CodecConfiguration>> list = getConfigValue
@@ -130,8 +174,7 @@ SdpEndpointImpl::SdpEndpointImpl (const boost::property_tree::ptree &config,
         (PARAM_AUDIO_CODECS);
 
     for (std::shared_ptr<CodecConfiguration> conf : list) {
-
-      append_codec_to_array (audio_codecs, conf->getName().c_str() );
+      tmpl->audioCodecs.push_back (conf->getName () );
     }
   } catch (boost::property_tree::ptree_bad_path &e) {
     /* When key is missing we assume an empty array */
@@ -143,17 +186,59 @@ SdpEndpointImpl::SdpEndpointImpl (const boost::property_tree::ptree &config,
         (PARAM_VIDEO_CODECS);
 
     for (std::shared_ptr<CodecConfiguration> conf : list) {
-
-      append_codec_to_array (video_codecs, conf->getName().c_str() );
+      tmpl->videoCodecs.push_back (conf->getName () );
     }
   } catch (boost::property_tree::ptree_bad_path &e) {
     /* When key is missing we assume an empty array */
   }
 
-  g_object_set (element, "num-audio-medias", audio_medias, "audio-codecs",
-                audio_codecs, NULL);
-  g_object_set (element, "num-video-medias", video_medias, "video-codecs",
-                video_codecs, NULL);
+  GST_DEBUG ("Caching offer template for %s", type.c_str () );
+
+  lock.lock ();
+  auto res = offerTemplates.emplace (type, tmpl);
+
+  if (!res.second) {
+    res.first->second = tmpl;
+  }
+
+  return tmpl;
+}
+
+void SdpEndpointImpl::postConstructor ()
+{
+  gchar *sess_id;
+  SessionEndpointImpl::postConstructor ();
+
+  g_signal_emit_by_name (element, "create-session", &sess_id);
+
+  if (sess_id == NULL) {
+    throw KurentoException (SDP_END_POINT_CANNOT_CREATE_SESSON,
+                            "Cannot create session");
+  }
+
+  sessId = std::string (sess_id);
+  g_free (sess_id);
+}
+
+SdpEndpointImpl::SdpEndpointImpl (const boost::property_tree::ptree &config,
+                                  std::shared_ptr< MediaObjectImpl > parent,
+                                  const std::string &factoryName, bool useIpv6) :
+  SessionEndpointImpl (config, parent, factoryName)
+{
+  std::shared_ptr<SdpOfferTemplate> tmpl = getOfferTemplate ();
+  GArray *audio_codecs, *video_codecs;
+
+  //   TODO: Add support for this events
+  //   g_signal_connect (element, "media-start", G_CALLBACK (media_start_cb), this);
+  //   g_signal_connect (element, "media-stop", G_CALLBACK (media_stop_cb), this);
+
+  audio_codecs = codecs_to_array (tmpl->audioCodecs);
+  video_codecs = codecs_to_array (tmpl->videoCodecs);
+
+  g_object_set (element, "num-audio-medias", tmpl->audioMedias,
+                "audio-codecs", audio_codecs, NULL);
+  g_object_set (element, "num-video-medias", tmpl->videoMedias,
+                "video-codecs", video_codecs, NULL);
   g_object_set (element, "use-ipv6", useIpv6, NULL);
 
   offerInProcess = false;
@@ -26,6 +26,7 @@ namespace kurento
 {
 
 class SdpEndpointImpl;
+struct SdpOfferTemplate;
 
 void Serialize (std::shared_ptr<SdpEndpointImpl> &object,
                 JsonSerializer &serializer);
@@ -69,6 +70,8 @@ protected:
 
 private:
 
+  std::shared_ptr<SdpOfferTemplate> getOfferTemplate ();
+
   static std::mutex sdpMutex;
   std::atomic_bool offerInProcess;
   std::atomic_bool waitingAnswer;
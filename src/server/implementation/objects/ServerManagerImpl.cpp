@@ -17,12 +17,14 @@
 
 #include <gst/gst.h>
 #include "ServerInfo.hpp"
+#include "PipelineUsage.hpp"
 #include "MediaPipelineImpl.hpp"
 #include "ServerManagerImpl.hpp"
 #include <jsonrpc/JsonSerializer.hpp>
 #include <KurentoException.hpp>
 #include <MediaSet.hpp>
 #include <boost/property_tree/json_parser.hpp>
+#include "kmsstats.h"
 
 #define GST_CAT_DEFAULT kurento_server_manager_impl
 GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
@@ -30,6 +32,13 @@ GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
 
 #define METADATA "metadata"
 
+/* seconds */
+#define METRICS_INTERVAL_DEFAULT 15
+
+#define LATENCY_SAMPLE_RATE_DEFAULT 1
+/* milliseconds */
+#define LATENCY_SAMPLE_INTERVAL_DEFAULT 0
+
 namespace kurento
 {
 
@@ -52,12 +61,47 @@ childToString (const boost::property_tree::ptree tree, const char *nodeName)
   return ss.str ();
 }
 
+static int
+getNonNegative (const char *name, int value, int defaultValue)
+{
+  if (value < 0) {
+    GST_WARNING ("Invalid %s %d, using %d", name, value, defaultValue);
+    return defaultValue;
+  }
+
+  return value;
+}
+
 ServerManagerImpl::ServerManagerImpl (const std::shared_ptr<ServerInfo> info,
                                       const boost::property_tree::ptree &config,
                                       ModuleManager &moduleManager) : MediaObjectImpl (config),
   info (info), moduleManager (moduleManager)
 {
+  std::string metricsFile;
+
   metadata = childToString (config, METADATA);
+
+  PipelineScheduler::getScheduler ().setThreadBudget (
+    getConfigValue<int, ServerManager> ("streamingThreadBudget", 0) );
+
+  /* Latency metadata sampling is process wide, set once for all pipelines */
+  kms_stats_set_latency_sampling (
+    getNonNegative ("latencySampleRate",
+                    getConfigValue<int, ServerManager> ("latencySampleRate",
+                        LATENCY_SAMPLE_RATE_DEFAULT),
+                    LATENCY_SAMPLE_RATE_DEFAULT),
+    getNonNegative ("latencySampleInterval",
+                    getConfigValue<int, ServerManager> ("latencySampleInterval",
+                        LATENCY_SAMPLE_INTERVAL_DEFAULT),
+                    LATENCY_SAMPLE_INTERVAL_DEFAULT) );
+
+  metricsFile = getConfigValue<std::string, ServerManager> ("metricsFile", "");
+
+  if (!metricsFile.empty () ) {
+    metricsExporter = std::make_shared<MetricsExporter> (metricsFile,
+                      std::chrono::seconds (getConfigValue<int, ServerManager>
+                          ("metricsInterval", METRICS_INTERVAL_DEFAULT) ) );
+  }
 }
 
 std::shared_ptr<ServerInfo> ServerManagerImpl::getInfo ()
@@ -76,6 +120,49 @@ std::vector<std::shared_ptr<MediaPipeline>> ServerManagerImpl::getPipelines ()
   return ret;
 }
 
+std::map <std::string, std::shared_ptr<Stats>> ServerManagerImpl::getStats ()
+{
+  std::map <std::string, std::shared_ptr<Stats>> report;
+  double timestamp = time (NULL);
+
+  for (auto it : MediaSet::getMediaSet ()->getPipelines() ) {
+    std::shared_ptr<MediaPipelineImpl> pipeline =
+      std::dynamic_pointer_cast <MediaPipelineImpl> (it);
+
+    if (pipeline) {
+      pipeline->collectStats (report, timestamp);
+    }
+  }
+
+  return report;
+}
+
+std::string ServerManagerImpl::getMetrics ()
+{
+  return MetricsRegistry::getRegistry ().scrape ();
+}
+
+std::vector<std::shared_ptr<PipelineUsage>>
+    ServerManagerImpl::getPipelineUsage ()
+{
+  std::vector<std::shared_ptr<PipelineUsage>> ret;
+
+  for (auto it : MediaSet::getMediaSet ()->getPipelines() ) {
+    std::shared_ptr<MediaPipelineImpl> pipeline =
+      std::dynamic_pointer_cast <MediaPipelineImpl> (it);
+
+    if (!pipeline) {
+      continue;
+    }
+
+    ret.push_back (std::make_shared <PipelineUsage> (pipeline,
+                   pipeline->getCpuTime (), pipeline->getStreamingThreads (),
+                   pipeline->getUsedMemory (), pipeline->getPeakMemory () ) );
+  }
+
+  return ret;
+}
+
 std::vector<std::string> ServerManagerImpl::getSessions ()
 {
   return MediaSet::getMediaSet ()->getSessions();
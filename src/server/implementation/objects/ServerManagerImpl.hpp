@@ -23,6 +23,7 @@
 #include <EventHandler.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <ModuleManager.hpp>
+#include <Metrics.hpp>
 
 namespace kurento
 {
@@ -72,6 +73,13 @@ public:
 
   virtual int64_t getUsedMemory() override;
 
+  virtual std::map <std::string, std::shared_ptr<Stats>> getStats () override;
+
+  virtual std::string getMetrics () override;
+
+  virtual std::vector<std::shared_ptr<PipelineUsage>> getPipelineUsage ()
+      override;
+
   /* Next methods are automatically implemented by code generator */
   virtual bool connect (const std::string &eventType,
                         std::shared_ptr<EventHandler> handler) override;
@@ -91,6 +99,8 @@ private:
 
   ModuleManager &moduleManager;
 
+  std::shared_ptr<MetricsExporter> metricsExporter;
+
   class StaticConstructor
   {
   public:
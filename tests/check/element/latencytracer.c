@@ -0,0 +1,221 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/gst.h>
+#include <glib.h>
+
+#include "kmshistogram.h"
+
+/* Time an audio buffer is held inside the element in test_streams */
+#define HOLD_TIME (100 * GST_MSECOND)
+
+static GstFlowReturn
+drop_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+drop_event (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+static void
+start_stream (GstPad * pad)
+{
+  GstSegment segment;
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (pad, gst_event_new_stream_start ("test"));
+  gst_pad_push_event (pad, gst_event_new_segment (&segment));
+}
+
+typedef struct _TestStream
+{
+  /* Pushes into a new sink pad of the element */
+  GstPad *input;
+  /* New src pad of the element, pushing into output_peer */
+  GstPad *output;
+  GstPad *output_peer;
+} TestStream;
+
+/* Pads are named as a KmsElement names them */
+static void
+add_stream (GstElement * element, const gchar * type, TestStream * stream)
+{
+  GstPad *pad;
+  gchar *name;
+
+  name = g_strdup_printf ("sink_%s_test", type);
+  pad = gst_pad_new (name, GST_PAD_SINK);
+  gst_pad_set_chain_function (pad, drop_chain);
+  gst_pad_set_event_function (pad, drop_event);
+  gst_element_add_pad (element, pad);
+  gst_pad_set_active (pad, TRUE);
+  g_free (name);
+
+  stream->input = gst_pad_new (NULL, GST_PAD_SRC);
+  gst_pad_set_active (stream->input, TRUE);
+  fail_unless (gst_pad_link (stream->input, pad) == GST_PAD_LINK_OK);
+
+  name = g_strdup_printf ("%s_src_test_0", type);
+  stream->output = gst_pad_new (name, GST_PAD_SRC);
+  gst_element_add_pad (element, stream->output);
+  gst_pad_set_active (stream->output, TRUE);
+  g_free (name);
+
+  stream->output_peer = gst_pad_new (NULL, GST_PAD_SINK);
+  gst_pad_set_chain_function (stream->output_peer, drop_chain);
+  gst_pad_set_event_function (stream->output_peer, drop_event);
+  gst_pad_set_active (stream->output_peer, TRUE);
+  fail_unless (gst_pad_link (stream->output,
+          stream->output_peer) == GST_PAD_LINK_OK);
+
+  start_stream (stream->input);
+  start_stream (stream->output);
+}
+
+static void
+clear_stream (TestStream * stream)
+{
+  gst_pad_set_active (stream->input, FALSE);
+  gst_pad_set_active (stream->output_peer, FALSE);
+  gst_object_unref (stream->input);
+  gst_object_unref (stream->output_peer);
+}
+
+static GstBuffer *
+create_buffer (GstClockTime pts)
+{
+  GstBuffer *buffer = gst_buffer_new ();
+
+  GST_BUFFER_PTS (buffer) = pts;
+
+  return buffer;
+}
+
+GST_START_TEST (test_streams)
+{
+  GstElement *element = gst_element_factory_make ("passthrough", NULL);
+  TestStream audio, video;
+  KmsHistogram *hist;
+
+  add_stream (element, "audio", &audio);
+  add_stream (element, "video", &video);
+
+  /* An audio and a video buffer with the same PTS enter, the audio one
+   * long before the video one */
+  fail_unless (gst_pad_push (audio.input, create_buffer (0)) == GST_FLOW_OK);
+  g_usleep (GST_TIME_AS_USECONDS (HOLD_TIME));
+  fail_unless (gst_pad_push (video.input, create_buffer (0)) == GST_FLOW_OK);
+
+  /* The audio one leaves right after the video one entered. Matched with
+   * the video entry, it would look like it took no time */
+  fail_unless (gst_pad_push (audio.output, create_buffer (0)) == GST_FLOW_OK);
+  fail_unless (gst_pad_push (video.output, create_buffer (0)) == GST_FLOW_OK);
+
+  hist = kms_processing_latency_get (element, FALSE);
+  fail_unless (hist != NULL);
+  fail_unless (kms_histogram_get_count (hist) == 2);
+  fail_unless (kms_histogram_get_max (hist) >= HOLD_TIME);
+  fail_unless (kms_histogram_get_min (hist) < HOLD_TIME);
+
+  clear_stream (&audio);
+  clear_stream (&video);
+  gst_object_unref (element);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_ghost_pads)
+{
+  GstElement *pipeline = gst_pipeline_new (NULL);
+  GstElement *src = gst_element_factory_make ("audiotestsrc", NULL);
+  GstElement *agnosticbin = gst_element_factory_make ("agnosticbin", NULL);
+  GstElement *sink = gst_element_factory_make ("fakesink", NULL);
+  GstStructure *stats;
+  KmsHistogram *hist = NULL;
+  gchar *name;
+  gint i;
+
+  g_object_set (src, "is-live", TRUE, NULL);
+  g_object_set (sink, "async", FALSE, "sync", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), src, agnosticbin, sink, NULL);
+  fail_unless (gst_element_link_many (src, agnosticbin, sink, NULL));
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  /* Buffers enter and leave the bin through its ghost pads */
+  for (i = 0; i < 100; i++) {
+    hist = kms_processing_latency_get (agnosticbin, FALSE);
+
+    if (hist != NULL && kms_histogram_get_count (hist) > 0) {
+      break;
+    }
+
+    g_usleep (50 * G_TIME_SPAN_MILLISECOND);
+  }
+
+  fail_unless (hist != NULL && kms_histogram_get_count (hist) > 0);
+
+  /* Only elements that buffers go through are measured */
+  fail_unless (kms_processing_latency_get (src, FALSE) == NULL);
+
+  stats = kms_processing_latency_get_stats (pipeline);
+  fail_unless (stats != NULL);
+  name = gst_element_get_name (agnosticbin);
+  fail_unless (gst_structure_has_field (stats, name));
+  g_free (name);
+  gst_structure_free (stats);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+static Suite *
+latency_tracer_suite (void)
+{
+  Suite *s = suite_create ("latencytracer");
+  TCase *tc_chain = tcase_create ("element");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_streams);
+  tcase_add_test (tc_chain, test_ghost_pads);
+
+  return s;
+}
+
+int
+main (int argc, char **argv)
+{
+  Suite *s;
+
+  /* Tracers are created by gst_init */
+  g_setenv ("GST_TRACERS", "kmslatency", TRUE);
+  gst_check_init (&argc, &argv);
+  s = latency_tracer_suite ();
+
+  return gst_check_run_suite (s, "latencytracer", __FILE__);
+}
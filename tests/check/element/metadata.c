@@ -24,6 +24,7 @@
 #include <time.h>
 
 #include "kmsbufferlacentymeta.h"
+#include "kmsstats.h"
 
 #define KMS_FACTORY_MAKE_IF_AVAILABLE(factory_name) ({      \
   GstElement *_element;                                     \
@@ -416,6 +417,64 @@ GST_START_TEST (check_metadata_enc)
   }
 }
 
+GST_END_TEST;
+
+#define SAMPLED_BUFFERS 40
+#define SAMPLE_RATE 4
+
+static GstFlowReturn
+count_latency_meta_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  guint *count = g_object_get_data (G_OBJECT (pad), "meta-count");
+
+  if (kms_buffer_get_buffer_latency_meta (buffer) != NULL) {
+    (*count)++;
+  }
+
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+GST_START_TEST (check_metadata_sampling)
+{
+  GstPad *srcpad, *sinkpad;
+  GstSegment segment;
+  guint count = 0;
+  gint i;
+
+  srcpad = gst_pad_new ("src", GST_PAD_SRC);
+  sinkpad = gst_pad_new ("sink", GST_PAD_SINK);
+  gst_pad_set_chain_function (sinkpad, count_latency_meta_chain);
+  g_object_set_data (G_OBJECT (sinkpad), "meta-count", &count);
+
+  fail_unless (gst_pad_link (srcpad, sinkpad) == GST_PAD_LINK_OK);
+  gst_pad_set_active (sinkpad, TRUE);
+  gst_pad_set_active (srcpad, TRUE);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("sampling"));
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  kms_stats_set_latency_sampling (SAMPLE_RATE, 0);
+  kms_stats_add_buffer_latency_meta_probe (srcpad, TRUE,
+      KMS_MEDIA_TYPE_VIDEO);
+
+  for (i = 0; i < SAMPLED_BUFFERS; i++) {
+    fail_unless (gst_pad_push (srcpad, gst_buffer_new ()) == GST_FLOW_OK);
+  }
+
+  fail_unless (count == SAMPLED_BUFFERS / SAMPLE_RATE);
+
+  /* Restore the default so every buffer is measured again */
+  kms_stats_set_latency_sampling (1, 0);
+
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_set_active (sinkpad, FALSE);
+  g_object_unref (srcpad);
+  g_object_unref (sinkpad);
+}
+
 GST_END_TEST
 /******************************/
 /* metadata test suite        */
@@ -429,6 +488,7 @@ metadata_suite (void)
   suite_add_tcase (s, tc_chain);
 
   tcase_add_test (tc_chain, check_metadata_enc);
+  tcase_add_test (tc_chain, check_metadata_sampling);
 
   return s;
 }
@@ -0,0 +1,602 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/gst.h>
+#include <glib.h>
+#include <stdlib.h>
+
+#include "sdp_utils.h"
+#include "kmssdpagent.h"
+#include "kmssdpmediahandler.h"
+#include "kmssdppayloadmanager.h"
+#include "kmssdpsctpmediahandler.h"
+#include "kmssdprtpavpmediahandler.h"
+#include "kmssdprtpsavpfmediahandler.h"
+#include "kmssdpbundlegroup.h"
+
+/*
+ * Throughput benchmark for the SDP agent. Every negotiation is replayed
+ * end to end (parse, set_remote_description, create_answer and
+ * set_local_description for answers; handler setup and create_offer for
+ * offers) so that the figures match what a KmsBaseSdpEndpoint pays per
+ * session.
+ *
+ * Results are logged with GST_DEBUG=sdp_agent_perf:4. The default
+ * thresholds are far from the usual figures, so they only catch gross
+ * regressions even on loaded machines. Tighter ones can be set in the
+ * environment, 0 disables a check:
+ *   KMS_SDP_PERF_ITERATIONS   negotiations per case (default 200)
+ *   KMS_SDP_PERF_MIN_RATE     minimum negotiations per second (default 20)
+ *   KMS_SDP_PERF_MAX_ALLOCS   maximum allocations per negotiation
+ *                             (default 20000)
+ */
+
+#define DEFAULT_ITERATIONS 200
+#define DEFAULT_MIN_RATE 20
+#define DEFAULT_MAX_ALLOCS 20000
+
+#define ANSWERER_ADDR "111.111.111.111"
+
+GST_DEBUG_CATEGORY_STATIC (sdp_agent_perf_debug);
+#define GST_CAT_DEFAULT sdp_agent_perf_debug
+
+/*
+ * Allocations are counted by interposing the libc allocator entry points
+ * in the test binary, so every malloc family call made by GLib and the
+ * SDP agent is seen whatever the GLib version. GSlice is forced to use
+ * malloc so its allocations are counted too. Only available on glibc,
+ * which exports the real allocator as __libc_malloc and friends.
+ */
+#ifdef __GLIBC__
+#define ALLOC_COUNTING TRUE
+#else
+#define ALLOC_COUNTING FALSE
+#endif
+
+static volatile gint allocs = 0;
+static volatile gint frees = 0;
+
+#ifdef __GLIBC__
+
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t nmemb, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+extern void __libc_free (void *ptr);
+
+void *
+malloc (size_t size)
+{
+  g_atomic_int_inc (&allocs);
+  return __libc_malloc (size);
+}
+
+void *
+calloc (size_t nmemb, size_t size)
+{
+  g_atomic_int_inc (&allocs);
+  return __libc_calloc (nmemb, size);
+}
+
+void *
+realloc (void *ptr, size_t size)
+{
+  g_atomic_int_inc (&allocs);
+  return __libc_realloc (ptr, size);
+}
+
+void
+free (void *ptr)
+{
+  if (ptr != NULL) {
+    g_atomic_int_inc (&frees);
+  }
+
+  __libc_free (ptr);
+}
+
+/* Before GSlice reads it on its first allocation */
+static void count_slice_allocations (void) __attribute__ ((constructor));
+
+static void
+count_slice_allocations (void)
+{
+  setenv ("G_SLICE", "always-malloc", 1);
+}
+
+#endif
+
+static gchar *audio_codecs[] = {
+  "opus/48000/2",
+  "PCMU/8000/1",
+  "AMR/8000/1"
+};
+
+static gchar *video_codecs[] = {
+  "VP8/90000",
+  "H264/90000"
+};
+
+static const gchar sdp_chrome_offer[] =
+    "v=0\r\n"
+    "o=- 9112637149779242531 2 IN IP4 127.0.0.1\r\n"
+    "s=-\r\n"
+    "t=0 0\r\n"
+    "a=msid-semantic: WMS *\r\n"
+    "a=group:BUNDLE audio video data\r\n"
+    "m=audio 9 UDP/TLS/RTP/SAVPF 111 103 104 9 0 8 106 105 13 126\r\n"
+    "c=IN IP4 0.0.0.0\r\n"
+    "a=rtpmap:111 opus/48000/2\r\n"
+    "a=rtpmap:103 ISAC/16000\r\n"
+    "a=rtpmap:104 ISAC/32000\r\n"
+    "a=rtpmap:9 G722/8000\r\n"
+    "a=rtpmap:0 PCMU/8000\r\n"
+    "a=rtpmap:8 PCMA/8000\r\n"
+    "a=rtpmap:106 CN/32000\r\n"
+    "a=rtpmap:105 CN/16000\r\n"
+    "a=rtpmap:13 CN/8000\r\n"
+    "a=rtpmap:126 telephone-event/8000\r\n"
+    "a=fmtp:111 minptime=10; useinbandfec=1\r\n"
+    "a=rtcp:9 IN IP4 0.0.0.0\r\n"
+    "a=rtcp-fb:111 transport-cc\r\n"
+    "a=extmap:1 urn:ietf:params:rtp-hdrext:ssrc-audio-level\r\n"
+    "a=extmap:3 http://www.webrtc.org/experiments/rtp-hdrext/abs-send-time\r\n"
+    "a=setup:actpass\r\n"
+    "a=mid:audio\r\n"
+    "a=msid:97tjCrfgycD7aLu8L1kFwCpaARd4dvZOzcoE 12f15712-4d0d-4d08-8f7e-09c3087ee4ad\r\n"
+    "a=maxptime:60\r\n"
+    "a=sendrecv\r\n"
+    "a=ice-ufrag:5E9apHXc228AnqJl\r\n"
+    "a=ice-pwd:Adq18Kq1IgPby078eoJKnFPH\r\n"
+    "a=fingerprint:sha-256 D7:60:7A:DE:56:03:32:1C:FB:E8:1C:D7:4A:56:71:60:54:59:DE:2F:1B:68:3A:15:36:E1:E0:D1:4C:C8:90:45\r\n"
+    "a=ssrc:100010 cname:k/mtykpGVf9V+s2/\r\n"
+    "a=ssrc:100010 mslabel:97tjCrfgycD7aLu8L1kFwCpaARd4dvZOzcoE\r\n"
+    "a=ssrc:100010 label:12f15712-4d0d-4d08-8f7e-09c3087ee4ad\r\n"
+    "a=rtcp-mux\r\n"
+    "m=video 9 UDP/TLS/RTP/SAVPF 100 101 116 117 96 97 98\r\n"
+    "c=IN IP4 0.0.0.0\r\n"
+    "a=rtpmap:100 VP8/90000\r\n"
+    "a=rtpmap:101 VP9/90000\r\n"
+    "a=rtpmap:116 red/90000\r\n"
+    "a=rtpmap:117 ulpfec/90000\r\n"
+    "a=rtpmap:96 rtx/90000\r\n"
+    "a=rtpmap:97 rtx/90000\r\n"
+    "a=rtpmap:98 rtx/90000\r\n"
+    "a=fmtp:96 apt=100\r\n"
+    "a=fmtp:97 apt=101\r\n"
+    "a=fmtp:98 apt=116\r\n"
+    "a=rtcp:9 IN IP4 0.0.0.0\r\n"
+    "a=rtcp-fb:100 ccm fir\r\n"
+    "a=rtcp-fb:100 nack\r\n"
+    "a=rtcp-fb:100 nack pli\r\n"
+    "a=rtcp-fb:100 goog-remb\r\n"
+    "a=rtcp-fb:100 transport-cc\r\n"
+    "a=extmap:2 urn:ietf:params:rtp-hdrext:toffset\r\n"
+    "a=extmap:3 http://www.webrtc.org/experiments/rtp-hdrext/abs-send-time\r\n"
+    "a=extmap:4 urn:3gpp:video-orientation\r\n"
+    "a=setup:actpass\r\n"
+    "a=mid:video\r\n"
+    "a=msid:97tjCrfgycD7aLu8L1kFwCpaARd4dvZOzcoE f327238b-f989-4fbf-bd06-0148b3dcc3f2\r\n"
+    "a=sendrecv\r\n"
+    "a=ice-ufrag:5E9apHXc228AnqJl\r\n"
+    "a=ice-pwd:Adq18Kq1IgPby078eoJKnFPH\r\n"
+    "a=fingerprint:sha-256 D7:60:7A:DE:56:03:32:1C:FB:E8:1C:D7:4A:56:71:60:54:59:DE:2F:1B:68:3A:15:36:E1:E0:D1:4C:C8:90:45\r\n"
+    "a=ssrc-group:SIM 100020 100030 100040\r\n"
+    "a=ssrc-group:FID 100020 607622965\r\n"
+    "a=ssrc:100020 cname:k/mtykpGVf9V+s2/\r\n"
+    "a=ssrc:100030 cname:k/mtykpGVf9V+s2/\r\n"
+    "a=ssrc:100040 cname:k/mtykpGVf9V+s2/\r\n"
+    "a=ssrc:607622965 cname:k/mtykpGVf9V+s2/\r\n"
+    "a=rtcp-mux\r\n"
+    "m=application 9 DTLS/SCTP 5000\r\n"
+    "c=IN IP4 0.0.0.0\r\n"
+    "a=ice-ufrag:5E9apHXc228AnqJl\r\n"
+    "a=ice-pwd:Adq18Kq1IgPby078eoJKnFPH\r\n"
+    "a=fingerprint:sha-256 D7:60:7A:DE:56:03:32:1C:FB:E8:1C:D7:4A:56:71:60:54:59:DE:2F:1B:68:3A:15:36:E1:E0:D1:4C:C8:90:45\r\n"
+    "a=setup:actpass\r\n"
+    "a=mid:data\r\n" "a=sctpmap:5000 webrtc-datachannel 1024\r\n";
+
+static const gchar sdp_firefox_offer[] =
+    "v=0\r\n"
+    "o=mozilla...THIS_IS_SDPARTA-52.0 4294967295 0 IN IP4 0.0.0.0\r\n"
+    "s=-\r\n"
+    "t=0 0\r\n"
+    "a=fingerprint:sha-256 5B:D3:8E:66:0E:7D:D3:F3:8D:F4:B0:53:07:7A:9C:EE:DB:A5:4A:9F:A5:16:75:0A:4C:D4:9A:57:7C:32:3C:33\r\n"
+    "a=group:BUNDLE sdparta_0 sdparta_1 sdparta_2\r\n"
+    "a=ice-options:trickle\r\n"
+    "a=msid-semantic:WMS *\r\n"
+    "m=audio 9 UDP/TLS/RTP/SAVPF 109 9 0 8 101\r\n"
+    "c=IN IP4 0.0.0.0\r\n"
+    "a=sendrecv\r\n"
+    "a=extmap:1/sendonly urn:ietf:params:rtp-hdrext:ssrc-audio-level\r\n"
+    "a=fmtp:109 maxplaybackrate=48000;stereo=1;useinbandfec=1\r\n"
+    "a=fmtp:101 0-15\r\n"
+    "a=ice-pwd:b5a5c0e1b5a8a4f1f4ba6d1b6b3f1a6e\r\n"
+    "a=ice-ufrag:3c8e07e5\r\n"
+    "a=mid:sdparta_0\r\n"
+    "a=msid:{5b0e8fe5-0d5c-4d3b-a1f2-9a2f4ef4f1a2} {3e3f5a0c-7e52-45b1-b8e0-dbc2b1f7a6d0}\r\n"
+    "a=rtcp-mux\r\n"
+    "a=rtpmap:109 opus/48000/2\r\n"
+    "a=rtpmap:9 G722/8000/1\r\n"
+    "a=rtpmap:0 PCMU/8000\r\n"
+    "a=rtpmap:8 PCMA/8000\r\n"
+    "a=rtpmap:101 telephone-event/8000\r\n"
+    "a=setup:actpass\r\n"
+    "a=ssrc:2655508255 cname:{6f7e1c2a-91f2-4d0a-b0f3-35ab9d0b7c11}\r\n"
+    "m=video 9 UDP/TLS/RTP/SAVPF 120 121 126 97\r\n"
+    "c=IN IP4 0.0.0.0\r\n"
+    "a=sendrecv\r\n"
+    "a=extmap:1 http://www.webrtc.org/experiments/rtp-hdrext/abs-send-time\r\n"
+    "a=extmap:2 urn:ietf:params:rtp-hdrext:toffset\r\n"
+    "a=extmap:3/sendonly urn:ietf:params:rtp-hdrext:sdes:rtp-stream-id\r\n"
+    "a=fmtp:126 profile-level-id=42e01f;level-asymmetry-allowed=1;packetization-mode=1\r\n"
+    "a=fmtp:97 profile-level-id=42e01f;level-asymmetry-allowed=1\r\n"
+    "a=fmtp:120 max-fs=12288;max-fr=60\r\n"
+    "a=fmtp:121 max-fs=12288;max-fr=60\r\n"
+    "a=ice-pwd:b5a5c0e1b5a8a4f1f4ba6d1b6b3f1a6e\r\n"
+    "a=ice-ufrag:3c8e07e5\r\n"
+    "a=mid:sdparta_1\r\n"
+    "a=msid:{5b0e8fe5-0d5c-4d3b-a1f2-9a2f4ef4f1a2} {8d8a6d7e-2b8c-4cc3-a6c8-5a1c5e9c3b0f}\r\n"
+    "a=rid:hi send\r\n"
+    "a=rid:mid send\r\n"
+    "a=rid:lo send\r\n"
+    "a=simulcast: send rid=hi;mid;lo\r\n"
+    "a=rtcp-fb:120 nack\r\n"
+    "a=rtcp-fb:120 nack pli\r\n"
+    "a=rtcp-fb:120 ccm fir\r\n"
+    "a=rtcp-fb:120 goog-remb\r\n"
+    "a=rtcp-fb:121 nack\r\n"
+    "a=rtcp-fb:121 nack pli\r\n"
+    "a=rtcp-fb:121 ccm fir\r\n"
+    "a=rtcp-fb:121 goog-remb\r\n"
+    "a=rtcp-fb:126 nack\r\n"
+    "a=rtcp-fb:126 nack pli\r\n"
+    "a=rtcp-fb:126 ccm fir\r\n"
+    "a=rtcp-fb:126 goog-remb\r\n"
+    "a=rtcp-fb:97 nack\r\n"
+    "a=rtcp-fb:97 nack pli\r\n"
+    "a=rtcp-fb:97 ccm fir\r\n"
+    "a=rtcp-fb:97 goog-remb\r\n"
+    "a=rtcp-mux\r\n"
+    "a=rtpmap:120 VP8/90000\r\n"
+    "a=rtpmap:121 VP9/90000\r\n"
+    "a=rtpmap:126 H264/90000\r\n"
+    "a=rtpmap:97 H264/90000\r\n"
+    "a=setup:actpass\r\n"
+    "a=ssrc:2104384523 cname:{6f7e1c2a-91f2-4d0a-b0f3-35ab9d0b7c11}\r\n"
+    "a=ssrc:3520290116 cname:{6f7e1c2a-91f2-4d0a-b0f3-35ab9d0b7c11}\r\n"
+    "a=ssrc:1011538926 cname:{6f7e1c2a-91f2-4d0a-b0f3-35ab9d0b7c11}\r\n"
+    "m=application 9 DTLS/SCTP 5000\r\n"
+    "c=IN IP4 0.0.0.0\r\n"
+    "a=sendrecv\r\n"
+    "a=ice-pwd:b5a5c0e1b5a8a4f1f4ba6d1b6b3f1a6e\r\n"
+    "a=ice-ufrag:3c8e07e5\r\n"
+    "a=mid:sdparta_2\r\n"
+    "a=sctpmap:5000 webrtc-datachannel 256\r\n" "a=setup:actpass\r\n";
+
+static const gchar sdp_safari_offer[] =
+    "v=0\r\n"
+    "o=- 6541426437268290361 2 IN IP4 127.0.0.1\r\n"
+    "s=-\r\n"
+    "t=0 0\r\n"
+    "a=group:BUNDLE 0 1\r\n"
+    "a=msid-semantic: WMS 3a8gqbHYl4pBLk3lZ1q7Vg0Rb1V8w6Yc1k9S\r\n"
+    "m=audio 9 UDP/TLS/RTP/SAVPF 111 103 9 102 0 8 105 13 110 113 126\r\n"
+    "c=IN IP4 0.0.0.0\r\n"
+    "a=rtcp:9 IN IP4 0.0.0.0\r\n"
+    "a=ice-ufrag:Zv1V\r\n"
+    "a=ice-pwd:3vP5fVZQ1d6bYQ4bd2uHxM+Z\r\n"
+    "a=ice-options:trickle\r\n"
+    "a=fingerprint:sha-256 1C:1E:6E:25:6B:83:58:D0:A4:DD:2E:5E:E2:42:2B:1F:4B:E4:7C:AA:E0:6C:5B:3B:42:2D:94:AB:1A:57:0D:D4\r\n"
+    "a=setup:actpass\r\n"
+    "a=mid:0\r\n"
+    "a=extmap:1 urn:ietf:params:rtp-hdrext:ssrc-audio-level\r\n"
+    "a=sendrecv\r\n"
+    "a=msid:3a8gqbHYl4pBLk3lZ1q7Vg0Rb1V8w6Yc1k9S 6c6d2c1e-1f35-4a6e-9a41-6c6f8b5e22c7\r\n"
+    "a=rtcp-mux\r\n"
+    "a=rtpmap:111 opus/48000/2\r\n"
+    "a=rtcp-fb:111 transport-cc\r\n"
+    "a=fmtp:111 minptime=10;useinbandfec=1\r\n"
+    "a=rtpmap:103 ISAC/16000\r\n"
+    "a=rtpmap:9 G722/8000\r\n"
+    "a=rtpmap:102 ILBC/8000\r\n"
+    "a=rtpmap:0 PCMU/8000\r\n"
+    "a=rtpmap:8 PCMA/8000\r\n"
+    "a=rtpmap:105 CN/16000\r\n"
+    "a=rtpmap:13 CN/8000\r\n"
+    "a=rtpmap:110 telephone-event/48000\r\n"
+    "a=rtpmap:113 telephone-event/16000\r\n"
+    "a=rtpmap:126 telephone-event/8000\r\n"
+    "a=ssrc:1522335327 cname:L3k4m7+Lt7vK0Zw7\r\n"
+    "m=video 9 UDP/TLS/RTP/SAVPF 96 97 98 99 100 101 127 125 104\r\n"
+    "c=IN IP4 0.0.0.0\r\n"
+    "a=rtcp:9 IN IP4 0.0.0.0\r\n"
+    "a=ice-ufrag:Zv1V\r\n"
+    "a=ice-pwd:3vP5fVZQ1d6bYQ4bd2uHxM+Z\r\n"
+    "a=ice-options:trickle\r\n"
+    "a=fingerprint:sha-256 1C:1E:6E:25:6B:83:58:D0:A4:DD:2E:5E:E2:42:2B:1F:4B:E4:7C:AA:E0:6C:5B:3B:42:2D:94:AB:1A:57:0D:D4\r\n"
+    "a=setup:actpass\r\n"
+    "a=mid:1\r\n"
+    "a=extmap:14 urn:ietf:params:rtp-hdrext:toffset\r\n"
+    "a=extmap:13 http://www.webrtc.org/experiments/rtp-hdrext/abs-send-time\r\n"
+    "a=extmap:12 urn:3gpp:video-orientation\r\n"
+    "a=sendrecv\r\n"
+    "a=msid:3a8gqbHYl4pBLk3lZ1q7Vg0Rb1V8w6Yc1k9S 0b6d2a52-7c8d-4cf0-8f3e-5c1b5a3d7e1f\r\n"
+    "a=rtcp-mux\r\n"
+    "a=rtcp-rsize\r\n"
+    "a=rtpmap:96 H264/90000\r\n"
+    "a=rtcp-fb:96 goog-remb\r\n"
+    "a=rtcp-fb:96 transport-cc\r\n"
+    "a=rtcp-fb:96 ccm fir\r\n"
+    "a=rtcp-fb:96 nack\r\n"
+    "a=rtcp-fb:96 nack pli\r\n"
+    "a=fmtp:96 level-asymmetry-allowed=1;packetization-mode=1;profile-level-id=640c1f\r\n"
+    "a=rtpmap:97 rtx/90000\r\n"
+    "a=fmtp:97 apt=96\r\n"
+    "a=rtpmap:98 H264/90000\r\n"
+    "a=rtcp-fb:98 goog-remb\r\n"
+    "a=rtcp-fb:98 transport-cc\r\n"
+    "a=rtcp-fb:98 ccm fir\r\n"
+    "a=rtcp-fb:98 nack\r\n"
+    "a=rtcp-fb:98 nack pli\r\n"
+    "a=fmtp:98 level-asymmetry-allowed=1;packetization-mode=1;profile-level-id=42e01f\r\n"
+    "a=rtpmap:99 rtx/90000\r\n"
+    "a=fmtp:99 apt=98\r\n"
+    "a=rtpmap:100 VP8/90000\r\n"
+    "a=rtcp-fb:100 goog-remb\r\n"
+    "a=rtcp-fb:100 transport-cc\r\n"
+    "a=rtcp-fb:100 ccm fir\r\n"
+    "a=rtcp-fb:100 nack\r\n"
+    "a=rtcp-fb:100 nack pli\r\n"
+    "a=rtpmap:101 rtx/90000\r\n"
+    "a=fmtp:101 apt=100\r\n"
+    "a=rtpmap:127 red/90000\r\n"
+    "a=rtpmap:125 rtx/90000\r\n"
+    "a=fmtp:125 apt=127\r\n"
+    "a=rtpmap:104 ulpfec/90000\r\n"
+    "a=ssrc-group:FID 2470880524 2811353454\r\n"
+    "a=ssrc:2470880524 cname:L3k4m7+Lt7vK0Zw7\r\n"
+    "a=ssrc:2811353454 cname:L3k4m7+Lt7vK0Zw7\r\n";
+
+typedef struct _PerfCase
+{
+  const gchar *name;
+  const gchar *sdp;
+} PerfCase;
+
+static const PerfCase answer_cases[] = {
+  {"chrome", sdp_chrome_offer},
+  {"firefox", sdp_firefox_offer},
+  {"safari", sdp_safari_offer},
+};
+
+static guint
+get_env_uint (const gchar * name, guint default_value)
+{
+  const gchar *val;
+
+  val = g_getenv (name);
+
+  if (val == NULL) {
+    return default_value;
+  }
+
+  return (guint) g_ascii_strtoull (val, NULL, 10);
+}
+
+static void
+set_codecs (KmsSdpRtpAvpMediaHandler * handler)
+{
+  KmsSdpPayloadManager *ptmanager;
+  GError *err = NULL;
+  guint i;
+
+  ptmanager = kms_sdp_payload_manager_new ();
+  fail_unless (kms_sdp_rtp_avp_media_handler_use_payload_manager (handler,
+          KMS_I_SDP_PAYLOAD_MANAGER (ptmanager), &err));
+  fail_if (err != NULL);
+
+  for (i = 0; i < G_N_ELEMENTS (audio_codecs); i++) {
+    fail_unless (kms_sdp_rtp_avp_media_handler_add_audio_codec (handler,
+            audio_codecs[i], &err));
+  }
+
+  for (i = 0; i < G_N_ELEMENTS (video_codecs); i++) {
+    fail_unless (kms_sdp_rtp_avp_media_handler_add_video_codec (handler,
+            video_codecs[i], &err));
+  }
+}
+
+static KmsSdpMediaHandler *
+create_handler (const gchar * media)
+{
+  KmsSdpMediaHandler *handler;
+
+  if (g_strcmp0 (media, "application") == 0) {
+    return KMS_SDP_MEDIA_HANDLER (kms_sdp_sctp_media_handler_new ());
+  }
+
+  handler = KMS_SDP_MEDIA_HANDLER (kms_sdp_rtp_savpf_media_handler_new ());
+  set_codecs (KMS_SDP_RTP_AVP_MEDIA_HANDLER (handler));
+
+  return handler;
+}
+
+static KmsSdpMediaHandler *
+on_handler_required (KmsSdpAgent * agent, const GstSDPMedia * media,
+    gpointer user_data)
+{
+  return create_handler (gst_sdp_media_get_media (media));
+}
+
+static void
+negotiate_answer (const gchar * sdp)
+{
+  KmsSdpAgentCallbacks cb;
+  GstSDPMessage *offer, *answer;
+  KmsSdpAgent *agent;
+  GError *err = NULL;
+
+  agent = kms_sdp_agent_new ();
+  g_object_set (agent, "addr", ANSWERER_ADDR, NULL);
+
+  fail_if (kms_sdp_agent_create_group (agent, KMS_TYPE_SDP_BUNDLE_GROUP, NULL,
+          NULL) < 0);
+
+  cb.on_media_offer = NULL;
+  cb.on_media_answer = NULL;
+  cb.on_media_answered = NULL;
+  cb.on_handler_required = on_handler_required;
+  kms_sdp_agent_set_callbacks (agent, &cb, NULL, NULL);
+
+  fail_unless (gst_sdp_message_new (&offer) == GST_SDP_OK);
+  fail_unless (gst_sdp_message_parse_buffer ((const guint8 *) sdp, -1,
+          offer) == GST_SDP_OK);
+
+  fail_unless (kms_sdp_agent_set_remote_description (agent, offer, &err));
+  answer = kms_sdp_agent_create_answer (agent, &err);
+  fail_if (err != NULL);
+  fail_unless (kms_sdp_agent_set_local_description (agent, answer, &err));
+
+  gst_sdp_message_free (answer);
+  gst_sdp_message_free (offer);
+  g_object_unref (agent);
+}
+
+static void
+negotiate_offer (const gchar * sdp)
+{
+  const gchar *medias[] = { "audio", "video", "application" };
+  GstSDPMessage *offer;
+  KmsSdpAgent *agent;
+  GError *err = NULL;
+  gint gid, hid;
+  guint i;
+
+  agent = kms_sdp_agent_new ();
+  g_object_set (agent, "addr", ANSWERER_ADDR, NULL);
+
+  gid = kms_sdp_agent_create_group (agent, KMS_TYPE_SDP_BUNDLE_GROUP, NULL,
+      NULL);
+  fail_if (gid < 0);
+
+  for (i = 0; i < G_N_ELEMENTS (medias); i++) {
+    hid = kms_sdp_agent_add_proto_handler (agent, medias[i],
+        create_handler (medias[i]), NULL);
+    fail_if (hid < 0);
+    fail_unless (kms_sdp_agent_group_add (agent, gid, hid, NULL));
+  }
+
+  offer = kms_sdp_agent_create_offer (agent, &err);
+  fail_if (err != NULL);
+  fail_unless (kms_sdp_agent_set_local_description (agent, offer, &err));
+
+  gst_sdp_message_free (offer);
+  g_object_unref (agent);
+}
+
+static void
+run_benchmark (const gchar * name, void (*negotiate) (const gchar * sdp),
+    const gchar * sdp)
+{
+  guint iterations, min_rate, max_allocs, i;
+  gdouble elapsed, rate, allocs_per_op, frees_per_op;
+  gint64 start;
+
+  iterations = get_env_uint ("KMS_SDP_PERF_ITERATIONS", DEFAULT_ITERATIONS);
+  min_rate = get_env_uint ("KMS_SDP_PERF_MIN_RATE", DEFAULT_MIN_RATE);
+  max_allocs = get_env_uint ("KMS_SDP_PERF_MAX_ALLOCS", DEFAULT_MAX_ALLOCS);
+
+  if (iterations == 0) {
+    return;
+  }
+
+  /* Warm up type registration and caches before measuring */
+  negotiate (sdp);
+
+  g_atomic_int_set (&allocs, 0);
+  g_atomic_int_set (&frees, 0);
+  start = g_get_monotonic_time ();
+
+  for (i = 0; i < iterations; i++) {
+    negotiate (sdp);
+  }
+
+  elapsed = (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC;
+
+  rate = elapsed > 0 ? iterations / elapsed : G_MAXDOUBLE;
+  allocs_per_op = g_atomic_int_get (&allocs) / (gdouble) iterations;
+  frees_per_op = g_atomic_int_get (&frees) / (gdouble) iterations;
+
+  if (ALLOC_COUNTING) {
+    GST_INFO ("%s: %u negotiations in %.3fs: %.1f ops/s, %.1f allocs/op, "
+        "%.1f frees/op", name, iterations, elapsed, rate, allocs_per_op,
+        frees_per_op);
+  } else {
+    GST_INFO ("%s: %u negotiations in %.3fs: %.1f ops/s", name, iterations,
+        elapsed, rate);
+  }
+
+  fail_if (min_rate > 0 && rate < min_rate,
+      "%s: %.1f negotiations/s is below the %u/s threshold", name, rate,
+      min_rate);
+  fail_if (ALLOC_COUNTING && max_allocs > 0 && allocs_per_op > max_allocs,
+      "%s: %.1f allocations/negotiation is above the %u threshold", name,
+      allocs_per_op, max_allocs);
+}
+
+GST_START_TEST (sdp_agent_perf_create_offer)
+{
+  run_benchmark ("offer", negotiate_offer, NULL);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (sdp_agent_perf_create_answer)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (answer_cases); i++) {
+    run_benchmark (answer_cases[i].name, negotiate_answer,
+        answer_cases[i].sdp);
+  }
+}
+
+GST_END_TEST;
+
+static Suite *
+sdp_agent_perf_suite (void)
+{
+  Suite *s = suite_create ("kmssdpagentperf");
+  TCase *tc_chain = tcase_create ("SdpAgentPerf");
+
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, "sdp_agent_perf", 0,
+      "sdp_agent_perf");
+
+  suite_add_tcase (s, tc_chain);
+
+  tcase_add_test (tc_chain, sdp_agent_perf_create_offer);
+  tcase_add_test (tc_chain, sdp_agent_perf_create_answer);
+
+  return s;
+}
+
+GST_CHECK_MAIN (sdp_agent_perf)
@@ -0,0 +1,244 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/rtp/gstrtpbuffer.h>
+#include <gst/rtp/gstrtcpbuffer.h>
+
+#include <kmsbundledemux.h>
+
+static gchar audio_data[] = "audio";
+static gchar video_data[] = "video";
+
+#define AUDIO audio_data
+#define VIDEO video_data
+
+#define MID_EXT_ID 3
+#define RID_EXT_ID 4
+
+static const gchar *sdp_str = "v=0\r\n"
+    "o=- 0 0 IN IP4 0.0.0.0\r\n"
+    "s=TestSession\r\n"
+    "c=IN IP4 0.0.0.0\r\n"
+    "t=0 0\r\n"
+    "a=group:BUNDLE audio0 video0\r\n"
+    "m=audio 9 UDP/TLS/RTP/SAVPF 111\r\n"
+    "a=mid:audio0\r\n"
+    "a=extmap:3 urn:ietf:params:rtp-hdrext:sdes:mid\r\n"
+    "a=ssrc:1001 cname:test\r\n"
+    "m=video 9 UDP/TLS/RTP/SAVPF 96 97\r\n"
+    "a=mid:video0\r\n"
+    "a=extmap:3 urn:ietf:params:rtp-hdrext:sdes:mid\r\n"
+    "a=extmap:4 urn:ietf:params:rtp-hdrext:sdes:rtp-stream-id\r\n"
+    "a=rid:hi send\r\n"
+    "a=rid:lo send\r\n"
+    "a=ssrc-group:FID 2001 2002\r\n"
+    "a=ssrc:2001 cname:test\r\n" "a=ssrc:2002 cname:test\r\n";
+
+static KmsBundleDemux *
+create_demux (void)
+{
+  KmsBundleDemux *demux = kms_bundle_demux_new ();
+  GstSDPMessage *sdp;
+
+  fail_unless (gst_sdp_message_new (&sdp) == GST_SDP_OK);
+  fail_unless (gst_sdp_message_parse_buffer ((const guint8 *) sdp_str, -1,
+          sdp) == GST_SDP_OK);
+
+  kms_bundle_demux_add_media (demux, gst_sdp_message_get_media (sdp, 0),
+      AUDIO);
+  kms_bundle_demux_add_media (demux, gst_sdp_message_get_media (sdp, 1),
+      VIDEO);
+
+  gst_sdp_message_free (sdp);
+
+  return demux;
+}
+
+static GstBuffer *
+generate_rtp_buffer (guint32 ssrc, guint8 ext_id, const gchar * ext_value)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstBuffer *buf;
+
+  buf = gst_rtp_buffer_new_allocate (0, 0, 0);
+  gst_rtp_buffer_map (buf, GST_MAP_READWRITE, &rtp);
+  gst_rtp_buffer_set_ssrc (&rtp, ssrc);
+  if (ext_id != 0) {
+    fail_unless (gst_rtp_buffer_add_extension_onebyte_header (&rtp, ext_id,
+            ext_value, strlen (ext_value)));
+  }
+  gst_rtp_buffer_unmap (&rtp);
+
+  return buf;
+}
+
+static GstBuffer *
+generate_rtcp_rr_buffer (guint32 sender_ssrc, guint32 reported_ssrc)
+{
+  GstRTCPBuffer rtcp = GST_RTCP_BUFFER_INIT;
+  GstRTCPPacket packet;
+  GstBuffer *buf;
+
+  buf = gst_rtcp_buffer_new (1400);
+  gst_rtcp_buffer_map (buf, GST_MAP_READWRITE, &rtcp);
+  fail_unless (gst_rtcp_buffer_add_packet (&rtcp, GST_RTCP_TYPE_RR, &packet));
+  gst_rtcp_packet_rr_set_ssrc (&packet, sender_ssrc);
+  fail_unless (gst_rtcp_packet_add_rb (&packet, reported_ssrc, 0, 0, 0, 0, 0,
+          0));
+  fail_unless (gst_rtcp_buffer_add_packet (&rtcp, GST_RTCP_TYPE_SDES,
+          &packet));
+  gst_rtcp_buffer_unmap (&rtcp);
+
+  return buf;
+}
+
+static gpointer
+process_rtp (KmsBundleDemux * demux, guint32 ssrc, guint8 ext_id,
+    const gchar * ext_value)
+{
+  GstBuffer *buf = generate_rtp_buffer (ssrc, ext_id, ext_value);
+  gpointer data;
+
+  data = kms_bundle_demux_process_rtp (demux, buf);
+  gst_buffer_unref (buf);
+
+  return data;
+}
+
+GST_START_TEST (test_signaled_ssrcs)
+{
+  KmsBundleDemux *demux = create_demux ();
+
+  fail_unless (kms_bundle_demux_lookup_ssrc (demux, 1001) == AUDIO);
+  fail_unless (kms_bundle_demux_lookup_ssrc (demux, 2001) == VIDEO);
+  fail_unless (kms_bundle_demux_lookup_ssrc (demux, 2002) == VIDEO);
+  fail_unless (kms_bundle_demux_lookup_ssrc (demux, 3001) == NULL);
+
+  fail_unless (process_rtp (demux, 1001, 0, NULL) == AUDIO);
+  fail_unless (process_rtp (demux, 2002, 0, NULL) == VIDEO);
+  fail_unless (process_rtp (demux, 3001, 0, NULL) == NULL);
+
+  kms_bundle_demux_destroy (demux);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_learn_from_mid)
+{
+  KmsBundleDemux *demux = create_demux ();
+
+  fail_unless (process_rtp (demux, 3001, MID_EXT_ID, "video0") == VIDEO);
+  fail_unless (kms_bundle_demux_lookup_ssrc (demux, 3001) == VIDEO);
+
+  /* Once learnt the extension is not needed anymore */
+  fail_unless (process_rtp (demux, 3001, 0, NULL) == VIDEO);
+
+  fail_unless (process_rtp (demux, 3002, MID_EXT_ID, "unknown") == NULL);
+  fail_unless (kms_bundle_demux_lookup_ssrc (demux, 3002) == NULL);
+
+  kms_bundle_demux_destroy (demux);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_learn_from_rid)
+{
+  KmsBundleDemux *demux = create_demux ();
+
+  fail_unless (process_rtp (demux, 4001, RID_EXT_ID, "lo") == VIDEO);
+  fail_unless (kms_bundle_demux_lookup_ssrc (demux, 4001) == VIDEO);
+
+  kms_bundle_demux_destroy (demux);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_give_up_unknown_ssrc)
+{
+  KmsBundleDemux *demux = create_demux ();
+  GstSDPMessage *sdp;
+  guint i;
+
+  fail_unless (kms_bundle_demux_can_learn_ssrc (demux, 8001));
+
+  for (i = 0; kms_bundle_demux_can_learn_ssrc (demux, 8001); i++) {
+    fail_unless (i < 1000);
+    fail_unless (process_rtp (demux, 8001, 0, NULL) == NULL);
+  }
+
+  /* Not looked at anymore, even if the extension shows up later */
+  fail_unless (process_rtp (demux, 8001, MID_EXT_ID, "video0") == NULL);
+  fail_unless (kms_bundle_demux_lookup_ssrc (demux, 8001) == NULL);
+
+  /* Until the remote description changes */
+  fail_unless (gst_sdp_message_new (&sdp) == GST_SDP_OK);
+  fail_unless (gst_sdp_message_parse_buffer ((const guint8 *) sdp_str, -1,
+          sdp) == GST_SDP_OK);
+  kms_bundle_demux_add_media (demux, gst_sdp_message_get_media (sdp, 1),
+      VIDEO);
+  gst_sdp_message_free (sdp);
+
+  fail_unless (kms_bundle_demux_can_learn_ssrc (demux, 8001));
+  fail_unless (process_rtp (demux, 8001, MID_EXT_ID, "video0") == VIDEO);
+
+  kms_bundle_demux_destroy (demux);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_learn_from_rtcp)
+{
+  KmsBundleDemux *demux = create_demux ();
+  GstBuffer *buf;
+
+  kms_bundle_demux_add_local_ssrc (demux, 5555, AUDIO);
+
+  buf = generate_rtcp_rr_buffer (6001, 5555);
+  kms_bundle_demux_process_rtcp (demux, buf);
+  gst_buffer_unref (buf);
+
+  fail_unless (kms_bundle_demux_lookup_ssrc (demux, 6001) == AUDIO);
+
+  buf = generate_rtcp_rr_buffer (6002, 7777);
+  kms_bundle_demux_process_rtcp (demux, buf);
+  gst_buffer_unref (buf);
+
+  fail_unless (kms_bundle_demux_lookup_ssrc (demux, 6002) == NULL);
+
+  kms_bundle_demux_destroy (demux);
+}
+
+GST_END_TEST;
+
+static Suite *
+bundledemux_suite (void)
+{
+  Suite *s = suite_create ("bundledemux");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_signaled_ssrcs);
+  tcase_add_test (tc_chain, test_learn_from_mid);
+  tcase_add_test (tc_chain, test_learn_from_rid);
+  tcase_add_test (tc_chain, test_give_up_unknown_ssrc);
+  tcase_add_test (tc_chain, test_learn_from_rtcp);
+
+  return s;
+}
+
+GST_CHECK_MAIN (bundledemux);
@@ -0,0 +1,186 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <gst/check/gstcheck.h>
+
+#include <kmshistogram.h>
+
+/* Relative error allowed by the sub-bucket resolution */
+#define MAX_ERROR 0.07
+
+static gboolean
+is_close (guint64 value, guint64 expected)
+{
+  return ABS ((gdouble) value - (gdouble) expected) <= expected * MAX_ERROR;
+}
+
+GST_START_TEST (test_empty)
+{
+  KmsHistogram *hist = kms_histogram_new ();
+
+  fail_unless (kms_histogram_get_count (hist) == 0);
+  fail_unless (kms_histogram_get_sum (hist) == 0);
+  fail_unless (kms_histogram_get_min (hist) == 0);
+  fail_unless (kms_histogram_get_max (hist) == 0);
+  fail_unless (kms_histogram_get_percentile (hist, 99) == 0);
+
+  kms_histogram_free (hist);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_percentiles)
+{
+  KmsHistogram *hist = kms_histogram_new ();
+  guint64 i;
+
+  /* 1us to 10ms */
+  for (i = 1; i <= 10000; i++) {
+    kms_histogram_record (hist, i * GST_USECOND);
+  }
+
+  fail_unless (kms_histogram_get_count (hist) == 10000);
+  fail_unless (kms_histogram_get_sum (hist) == 50005000 * GST_USECOND);
+  fail_unless (kms_histogram_get_min (hist) == GST_USECOND);
+  fail_unless (kms_histogram_get_max (hist) == 10000 * GST_USECOND);
+  fail_unless (is_close (kms_histogram_get_percentile (hist, 50),
+          5000 * GST_USECOND));
+  fail_unless (is_close (kms_histogram_get_percentile (hist, 99),
+          9900 * GST_USECOND));
+  fail_unless (is_close (kms_histogram_get_percentile (hist, 99.9),
+          9990 * GST_USECOND));
+  fail_unless (kms_histogram_get_percentile (hist, 100) ==
+      10000 * GST_USECOND);
+
+  kms_histogram_reset (hist);
+  fail_unless (kms_histogram_get_count (hist) == 0);
+  fail_unless (kms_histogram_get_sum (hist) == 0);
+
+  kms_histogram_free (hist);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_small_values)
+{
+  KmsHistogram *hist = kms_histogram_new ();
+  guint64 i;
+
+  for (i = 0; i < 16; i++) {
+    kms_histogram_record (hist, i);
+  }
+
+  /* Values below the sub-bucket count are exact */
+  fail_unless (kms_histogram_get_percentile (hist, 50) == 7);
+  fail_unless (kms_histogram_get_min (hist) == 0);
+  fail_unless (kms_histogram_get_max (hist) == 15);
+
+  kms_histogram_free (hist);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_counts)
+{
+  KmsHistogram *hist = kms_histogram_new ();
+  const guint64 bounds[] = { 10, 128, 1024 };
+  guint64 counts[G_N_ELEMENTS (bounds) + 1];
+  guint64 sum;
+
+  kms_histogram_record (hist, 1);
+  kms_histogram_record (hist, 10);
+  kms_histogram_record (hist, 100);
+  kms_histogram_record (hist, 1000);
+  kms_histogram_record (hist, 5000);
+
+  kms_histogram_get_counts (hist, bounds, G_N_ELEMENTS (bounds), counts,
+      &sum);
+
+  fail_unless (counts[0] == 2);
+  fail_unless (counts[1] == 1);
+  fail_unless (counts[2] == 1);
+  fail_unless (counts[3] == 1);
+  fail_unless (sum == 6111);
+
+  /* Values above the last bound go to the extra count */
+  kms_histogram_reset (hist);
+  kms_histogram_record (hist, 1000);
+  kms_histogram_get_counts (hist, bounds, 1, counts, NULL);
+  fail_unless (counts[0] == 0);
+  fail_unless (counts[1] == 1);
+
+  kms_histogram_free (hist);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_merge)
+{
+  KmsHistogram *fast = kms_histogram_new ();
+  KmsHistogram *slow = kms_histogram_new ();
+  GstStructure *stats;
+  guint64 i, count, p50, max;
+
+  for (i = 0; i < 900; i++) {
+    kms_histogram_record (fast, GST_MSECOND);
+  }
+
+  for (i = 0; i < 100; i++) {
+    kms_histogram_record (slow, 80 * GST_MSECOND);
+  }
+
+  kms_histogram_merge (fast, slow);
+
+  fail_unless (kms_histogram_get_count (fast) == 1000);
+  fail_unless (kms_histogram_get_count (slow) == 100);
+  fail_unless (kms_histogram_get_sum (fast) == 8900 * GST_MSECOND);
+  fail_unless (is_close (kms_histogram_get_percentile (fast, 50),
+          GST_MSECOND));
+  fail_unless (is_close (kms_histogram_get_percentile (fast, 99),
+          80 * GST_MSECOND));
+
+  stats = kms_histogram_to_structure (fast, "merged");
+  fail_unless (gst_structure_get (stats, "count", G_TYPE_UINT64, &count,
+          "p50", G_TYPE_UINT64, &p50, "max", G_TYPE_UINT64, &max, NULL));
+  fail_unless (count == 1000);
+  fail_unless (is_close (p50, GST_MSECOND));
+  fail_unless (max == 80 * GST_MSECOND);
+  gst_structure_free (stats);
+
+  kms_histogram_free (fast);
+  kms_histogram_free (slow);
+}
+
+GST_END_TEST;
+
+static Suite *
+histogram_suite (void)
+{
+  Suite *s = suite_create ("histogram");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_empty);
+  tcase_add_test (tc_chain, test_percentiles);
+  tcase_add_test (tc_chain, test_small_values);
+  tcase_add_test (tc_chain, test_counts);
+  tcase_add_test (tc_chain, test_merge);
+
+  return s;
+}
+
+GST_CHECK_MAIN (histogram);
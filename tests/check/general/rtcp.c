@@ -0,0 +1,164 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/rtp/gstrtcpbuffer.h>
+
+#include <kmsrtcp.h>
+
+#define SENDER_SSRC 0x1111
+#define MEDIA_SSRC 0x2222
+#define REMB_BITRATE 300000
+
+typedef struct _ConsumerData
+{
+  guint sr;
+  guint rr;
+  guint remb;
+  guint pli;
+  guint32 remb_bitrate;
+} ConsumerData;
+
+static GstBuffer *
+generate_compound_buffer (void)
+{
+  GstRTCPBuffer rtcp = GST_RTCP_BUFFER_INIT;
+  KmsRTCPPSFBAFBREMBPacket remb;
+  GstRTCPPacket packet;
+  GstBuffer *buf;
+
+  buf = gst_rtcp_buffer_new (1400);
+  gst_rtcp_buffer_map (buf, GST_MAP_READWRITE, &rtcp);
+
+  fail_unless (gst_rtcp_buffer_add_packet (&rtcp, GST_RTCP_TYPE_SR, &packet));
+  gst_rtcp_packet_sr_set_sender_info (&packet, SENDER_SSRC, 0, 0, 0, 0);
+
+  fail_unless (gst_rtcp_buffer_add_packet (&rtcp, GST_RTCP_TYPE_PSFB,
+          &packet));
+  remb.bitrate = REMB_BITRATE;
+  remb.n_ssrcs = 1;
+  remb.ssrcs[0] = MEDIA_SSRC;
+  fail_unless (kms_rtcp_psfb_afb_remb_marshall_packet (&packet, &remb,
+          SENDER_SSRC));
+
+  fail_unless (gst_rtcp_buffer_add_packet (&rtcp, GST_RTCP_TYPE_PSFB,
+          &packet));
+  gst_rtcp_packet_fb_set_type (&packet, GST_RTCP_PSFB_TYPE_PLI);
+  gst_rtcp_packet_fb_set_sender_ssrc (&packet, SENDER_SSRC);
+  gst_rtcp_packet_fb_set_media_ssrc (&packet, MEDIA_SSRC);
+
+  gst_rtcp_buffer_unmap (&rtcp);
+
+  return buf;
+}
+
+static void
+consumer_cb (const KmsRTCPPacketView * view, gpointer user_data)
+{
+  ConsumerData *data = user_data;
+
+  switch (view->type) {
+    case KMS_RTCP_PACKET_VIEW_SR:
+      fail_unless (view->sender_ssrc == SENDER_SSRC);
+      data->sr++;
+      break;
+    case KMS_RTCP_PACKET_VIEW_RR:
+      data->rr++;
+      break;
+    case KMS_RTCP_PACKET_VIEW_REMB:
+      fail_unless (view->remb != NULL);
+      fail_unless (view->remb->n_ssrcs == 1);
+      fail_unless (view->remb->ssrcs[0] == MEDIA_SSRC);
+      data->remb_bitrate = view->remb->bitrate;
+      data->remb++;
+      break;
+    case KMS_RTCP_PACKET_VIEW_PLI:
+      fail_unless (view->media_ssrc == MEDIA_SSRC);
+      data->pli++;
+      break;
+    default:
+      fail ("Unexpected packet view %d", view->type);
+      break;
+  }
+}
+
+GST_START_TEST (test_dispatch_compound)
+{
+  KmsRTCPDispatcher *dispatcher = kms_rtcp_dispatcher_new ();
+  ConsumerData all = { 0, }, remb = { 0, };
+  GstBuffer *buf = generate_compound_buffer ();
+
+  kms_rtcp_dispatcher_add_consumer (dispatcher, KMS_RTCP_PACKET_VIEW_ALL,
+      consumer_cb, &all, NULL);
+  kms_rtcp_dispatcher_add_consumer (dispatcher, KMS_RTCP_PACKET_VIEW_REMB,
+      consumer_cb, &remb, NULL);
+
+  fail_unless (kms_rtcp_dispatcher_process_buffer (dispatcher, buf));
+
+  fail_unless (all.sr == 1);
+  fail_unless (all.rr == 0);
+  fail_unless (all.remb == 1);
+  fail_unless (all.pli == 1);
+
+  fail_unless (remb.sr == 0);
+  fail_unless (remb.remb == 1);
+  fail_unless (remb.pli == 0);
+  /* Mantissa has 18 bits, so this bitrate is exactly representable */
+  fail_unless (remb.remb_bitrate == REMB_BITRATE);
+
+  gst_buffer_unref (buf);
+  kms_rtcp_dispatcher_destroy (dispatcher);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_remove_consumer)
+{
+  KmsRTCPDispatcher *dispatcher = kms_rtcp_dispatcher_new ();
+  ConsumerData data = { 0, };
+  GstBuffer *buf = generate_compound_buffer ();
+  gulong id;
+
+  id = kms_rtcp_dispatcher_add_consumer (dispatcher, KMS_RTCP_PACKET_VIEW_SR,
+      consumer_cb, &data, NULL);
+  fail_unless (kms_rtcp_dispatcher_process_buffer (dispatcher, buf));
+  fail_unless (data.sr == 1);
+
+  kms_rtcp_dispatcher_remove_consumer (dispatcher, id);
+  fail_unless (kms_rtcp_dispatcher_process_buffer (dispatcher, buf));
+  fail_unless (data.sr == 1);
+
+  gst_buffer_unref (buf);
+  kms_rtcp_dispatcher_destroy (dispatcher);
+}
+
+GST_END_TEST;
+
+static Suite *
+rtcp_suite (void)
+{
+  Suite *s = suite_create ("rtcp");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_dispatch_compound);
+  tcase_add_test (tc_chain, test_remove_consumer);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtcp);
@@ -0,0 +1,211 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/rtp/gstrtpbuffer.h>
+
+#include <kmsrtphdrext.h>
+
+#define ABS_SEND_TIME_ID 3
+#define AUDIO_LEVEL_ID 1
+#define MID_ID 5
+#define CVO_ID 4
+
+static GstBuffer *
+generate_rtp_buffer (gboolean two_bytes)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  guint8 abs_send_time[3] = { 0x12, 0x34, 0x56 };
+  guint8 audio_level = 0x80 | 42;
+  guint8 cvo = 0x08 | 0x01;
+  GstBuffer *buf;
+
+  buf = gst_rtp_buffer_new_allocate (0, 0, 0);
+  gst_rtp_buffer_map (buf, GST_MAP_READWRITE, &rtp);
+
+  if (two_bytes) {
+    fail_unless (gst_rtp_buffer_add_extension_twobytes_header (&rtp, 0,
+            ABS_SEND_TIME_ID, abs_send_time, sizeof (abs_send_time)));
+    fail_unless (gst_rtp_buffer_add_extension_twobytes_header (&rtp, 0,
+            AUDIO_LEVEL_ID, &audio_level, 1));
+    fail_unless (gst_rtp_buffer_add_extension_twobytes_header (&rtp, 0,
+            MID_ID, "audio0", 6));
+    fail_unless (gst_rtp_buffer_add_extension_twobytes_header (&rtp, 0,
+            CVO_ID, &cvo, 1));
+  } else {
+    fail_unless (gst_rtp_buffer_add_extension_onebyte_header (&rtp,
+            ABS_SEND_TIME_ID, abs_send_time, sizeof (abs_send_time)));
+    fail_unless (gst_rtp_buffer_add_extension_onebyte_header (&rtp,
+            AUDIO_LEVEL_ID, &audio_level, 1));
+    fail_unless (gst_rtp_buffer_add_extension_onebyte_header (&rtp,
+            MID_ID, "audio0", 6));
+    fail_unless (gst_rtp_buffer_add_extension_onebyte_header (&rtp,
+            CVO_ID, &cvo, 1));
+  }
+
+  gst_rtp_buffer_unmap (&rtp);
+
+  return buf;
+}
+
+static KmsRtpHdrExtMap *
+create_map (void)
+{
+  KmsRtpHdrExtMap *map = kms_rtp_hdr_ext_map_new ();
+
+  kms_rtp_hdr_ext_map_set_id (map, KMS_RTP_HDR_EXT_ABS_SEND_TIME,
+      ABS_SEND_TIME_ID);
+  kms_rtp_hdr_ext_map_set_id (map, KMS_RTP_HDR_EXT_AUDIO_LEVEL,
+      AUDIO_LEVEL_ID);
+  kms_rtp_hdr_ext_map_set_id (map, KMS_RTP_HDR_EXT_MID, MID_ID);
+  kms_rtp_hdr_ext_map_set_id (map, KMS_RTP_HDR_EXT_VIDEO_ORIENTATION, CVO_ID);
+
+  return map;
+}
+
+static void
+check_values (const KmsRtpHdrExtValues * values)
+{
+  fail_unless (values->present & KMS_RTP_HDR_EXT_FLAG
+      (KMS_RTP_HDR_EXT_ABS_SEND_TIME));
+  fail_unless (values->abs_send_time == 0x123456);
+
+  fail_unless (values->present & KMS_RTP_HDR_EXT_FLAG
+      (KMS_RTP_HDR_EXT_AUDIO_LEVEL));
+  fail_unless (values->voice_activity);
+  fail_unless (values->audio_level == 42);
+
+  fail_unless (values->present & KMS_RTP_HDR_EXT_FLAG (KMS_RTP_HDR_EXT_MID));
+  fail_unless (values->mid_len == 6);
+  fail_unless (strncmp (values->mid, "audio0", 6) == 0);
+
+  fail_unless (values->present & KMS_RTP_HDR_EXT_FLAG
+      (KMS_RTP_HDR_EXT_VIDEO_ORIENTATION));
+  fail_unless (values->camera_back);
+  fail_unless (!values->horizontal_flip);
+  fail_unless (values->video_rotation == 90);
+
+  fail_if (values->present & KMS_RTP_HDR_EXT_FLAG
+      (KMS_RTP_HDR_EXT_TRANSPORT_CC));
+}
+
+static void
+parse_and_check (gboolean two_bytes)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  KmsRtpHdrExtMap *map = create_map ();
+  GstBuffer *buf = generate_rtp_buffer (two_bytes);
+  KmsRtpHdrExtValues values;
+
+  fail_unless (gst_rtp_buffer_map (buf, GST_MAP_READ, &rtp));
+  fail_unless (kms_rtp_hdr_ext_map_parse (map, &rtp, &values));
+  check_values (&values);
+  gst_rtp_buffer_unmap (&rtp);
+
+  gst_buffer_unref (buf);
+  kms_rtp_hdr_ext_map_free (map);
+}
+
+GST_START_TEST (test_parse_onebyte)
+{
+  parse_and_check (FALSE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_parse_twobytes)
+{
+  parse_and_check (TRUE);
+}
+
+GST_END_TEST;
+
+static void
+handler_cb (const KmsRtpHdrExtValues * values, GstRTPBuffer * rtp,
+    gpointer user_data)
+{
+  guint *count = user_data;
+
+  check_values (values);
+  (*count)++;
+}
+
+GST_START_TEST (test_handlers)
+{
+  KmsRtpHdrExtMap *map = create_map ();
+  GstBuffer *buf = generate_rtp_buffer (FALSE);
+  guint level_count = 0, tcc_count = 0;
+
+  kms_rtp_hdr_ext_map_add_handler (map,
+      KMS_RTP_HDR_EXT_FLAG (KMS_RTP_HDR_EXT_AUDIO_LEVEL), handler_cb,
+      &level_count, NULL);
+  kms_rtp_hdr_ext_map_add_handler (map,
+      KMS_RTP_HDR_EXT_FLAG (KMS_RTP_HDR_EXT_TRANSPORT_CC), handler_cb,
+      &tcc_count, NULL);
+
+  fail_unless (kms_rtp_hdr_ext_map_process_buffer (map, buf));
+  fail_unless (level_count == 1);
+  fail_unless (tcc_count == 0);
+
+  gst_buffer_unref (buf);
+  kms_rtp_hdr_ext_map_free (map);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_map_from_sdp)
+{
+  KmsRtpHdrExtMap *map = kms_rtp_hdr_ext_map_new ();
+  GstSDPMedia *media;
+
+  gst_sdp_media_new (&media);
+  gst_sdp_media_add_attribute (media, "extmap",
+      "3 http://www.webrtc.org/experiments/rtp-hdrext/abs-send-time");
+  gst_sdp_media_add_attribute (media, "extmap",
+      "1/sendrecv urn:ietf:params:rtp-hdrext:ssrc-audio-level vad=on");
+  gst_sdp_media_add_attribute (media, "extmap", "7 urn:unknown:extension");
+
+  kms_rtp_hdr_ext_map_add_from_sdp_media (map, media);
+
+  fail_unless (kms_rtp_hdr_ext_map_get_id (map,
+          KMS_RTP_HDR_EXT_ABS_SEND_TIME) == 3);
+  fail_unless (kms_rtp_hdr_ext_map_get_id (map,
+          KMS_RTP_HDR_EXT_AUDIO_LEVEL) == 1);
+  fail_unless (kms_rtp_hdr_ext_map_get_id (map, KMS_RTP_HDR_EXT_MID) == 0);
+
+  gst_sdp_media_free (media);
+  kms_rtp_hdr_ext_map_free (map);
+}
+
+GST_END_TEST;
+
+static Suite *
+rtphdrext_suite (void)
+{
+  Suite *s = suite_create ("rtphdrext");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_parse_onebyte);
+  tcase_add_test (tc_chain, test_parse_twobytes);
+  tcase_add_test (tc_chain, test_handlers);
+  tcase_add_test (tc_chain, test_map_from_sdp);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtphdrext);
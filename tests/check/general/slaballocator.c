@@ -0,0 +1,256 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <gst/check/gstcheck.h>
+
+#include <kmsslaballocator.h>
+
+static guint64
+get_stat (const gchar * name)
+{
+  GstStructure *stats = kms_slab_allocator_get_stats ();
+  guint64 value = 0;
+
+  gst_structure_get_uint64 (stats, name, &value);
+  gst_structure_free (stats);
+
+  return value;
+}
+
+GST_START_TEST (test_reuse)
+{
+  GstAllocator *allocator = kms_slab_allocator_get ();
+  GstMemory *mem, *again;
+  guint64 hits;
+
+  mem = gst_allocator_alloc (allocator, 1400, NULL);
+  fail_unless (mem->allocator == allocator);
+  fail_unless (gst_memory_get_sizes (mem, NULL, NULL) == 1400);
+  fail_unless (get_stat ("bytes-in-use") > 0);
+  gst_memory_unref (mem);
+
+  fail_unless (get_stat ("bytes-cached") > 0);
+  hits = get_stat ("hits");
+
+  /* Same size class, the freed block is reused */
+  again = gst_allocator_alloc (allocator, 1200, NULL);
+  fail_unless (again == mem);
+  fail_unless (get_stat ("hits") == hits + 1);
+  gst_memory_unref (again);
+
+  /* Too big for the slabs */
+  mem = gst_allocator_alloc (allocator, 64 * 1024, NULL);
+  fail_if (mem->allocator == allocator);
+  gst_memory_unref (mem);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_map_share_copy)
+{
+  GstAllocationParams params;
+  GstMemory *mem, *sub, *copy;
+  GstMapInfo info;
+  guint i;
+
+  gst_allocation_params_init (&params);
+  params.align = 15;
+  params.prefix = 12;
+  params.flags = GST_MEMORY_FLAG_ZERO_PREFIXED;
+
+  mem = gst_allocator_alloc (kms_slab_allocator_get (), 1000, &params);
+
+  fail_unless (gst_memory_map (mem, &info, GST_MAP_WRITE));
+  fail_unless (info.size == 1000);
+  fail_unless (((((guintptr) info.data) - params.prefix) & params.align) == 0);
+  fail_unless (info.data[-1] == 0);
+
+  for (i = 0; i < info.size; i++) {
+    info.data[i] = i % 256;
+  }
+
+  gst_memory_unmap (mem, &info);
+
+  sub = gst_memory_share (mem, 100, 50);
+  fail_unless (gst_memory_map (sub, &info, GST_MAP_READ));
+  fail_unless (info.size == 50);
+  fail_unless (info.data[0] == 100);
+  gst_memory_unmap (sub, &info);
+
+  copy = gst_memory_copy (mem, 10, 20);
+  fail_unless (gst_memory_map (copy, &info, GST_MAP_READ));
+  fail_unless (info.size == 20);
+  fail_unless (info.data[0] == 10);
+  gst_memory_unmap (copy, &info);
+
+  gst_memory_unref (mem);
+  gst_memory_unref (sub);
+  gst_memory_unref (copy);
+}
+
+GST_END_TEST;
+
+static gpointer
+alloc_thread (gpointer data)
+{
+  return gst_allocator_alloc (kms_slab_allocator_get (), 500, NULL);
+}
+
+GST_START_TEST (test_other_thread_free)
+{
+  guint64 in_use = get_stat ("bytes-in-use");
+  GstMemory *mem;
+  GThread *thread;
+
+  thread = g_thread_new ("alloc", alloc_thread, NULL);
+  mem = g_thread_join (thread);
+
+  fail_unless (get_stat ("bytes-in-use") > in_use);
+
+  /* Freed in a thread other than the one that allocated it */
+  gst_memory_unref (mem);
+  fail_unless (get_stat ("bytes-in-use") == in_use);
+}
+
+GST_END_TEST;
+
+#define BATCHES 100
+#define BATCH_SIZE 64
+
+typedef struct _ProducerConsumer
+{
+  GAsyncQueue *memories;
+  GAsyncQueue *freed;
+} ProducerConsumer;
+
+static gpointer
+producer_thread (gpointer data)
+{
+  ProducerConsumer *pc = data;
+  guint i, j;
+
+  for (i = 0; i < BATCHES; i++) {
+    for (j = 0; j < BATCH_SIZE; j++) {
+      g_async_queue_push (pc->memories,
+          gst_allocator_alloc (kms_slab_allocator_get (), 1000, NULL));
+    }
+
+    /* Wait for the batch to be freed, as a pipeline with a bounded queue */
+    g_async_queue_pop (pc->freed);
+  }
+
+  return NULL;
+}
+
+static gpointer
+consumer_thread (gpointer data)
+{
+  ProducerConsumer *pc = data;
+  guint i, j;
+
+  for (i = 0; i < BATCHES; i++) {
+    for (j = 0; j < BATCH_SIZE; j++) {
+      gst_memory_unref (g_async_queue_pop (pc->memories));
+    }
+
+    g_async_queue_push (pc->freed, GUINT_TO_POINTER (1));
+  }
+
+  return NULL;
+}
+
+GST_START_TEST (test_producer_consumer)
+{
+  guint64 hits = get_stat ("hits");
+  guint64 misses = get_stat ("misses");
+  GThread *producer, *consumer;
+  ProducerConsumer pc;
+  gdouble hit_rate;
+
+  pc.memories = g_async_queue_new ();
+  pc.freed = g_async_queue_new ();
+
+  producer = g_thread_new ("producer", producer_thread, &pc);
+  consumer = g_thread_new ("consumer", consumer_thread, &pc);
+  g_thread_join (producer);
+  g_thread_join (consumer);
+
+  hits = get_stat ("hits") - hits;
+  misses = get_stat ("misses") - misses;
+  fail_unless (hits + misses == BATCHES * BATCH_SIZE);
+
+  /* Blocks freed by the consumer are reused by the producer, only the
+   * first batches come from malloc */
+  hit_rate = (gdouble) hits / (hits + misses);
+  GST_INFO ("Hit rate %f", hit_rate);
+  fail_unless (hit_rate > 0.9);
+
+  g_async_queue_unref (pc.memories);
+  g_async_queue_unref (pc.freed);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_allocation_query)
+{
+  GstCaps *caps = gst_caps_new_empty_simple ("application/x-rtp");
+  GstAllocator *allocator, *sysmem;
+  GstAllocationParams params;
+  GstQuery *query;
+
+  query = gst_query_new_allocation (caps, TRUE);
+  kms_slab_allocator_add_to_query (query);
+  fail_unless (gst_query_get_n_allocation_params (query) == 1);
+  gst_query_parse_nth_allocation_param (query, 0, &allocator, NULL);
+  fail_unless (allocator == kms_slab_allocator_get ());
+  gst_object_unref (allocator);
+  gst_query_unref (query);
+
+  /* An allocator asked by downstream is kept */
+  sysmem = gst_allocator_find (GST_ALLOCATOR_SYSMEM);
+  gst_allocation_params_init (&params);
+  query = gst_query_new_allocation (caps, TRUE);
+  gst_query_add_allocation_param (query, sysmem, &params);
+  kms_slab_allocator_add_to_query (query);
+  gst_query_parse_nth_allocation_param (query, 0, &allocator, NULL);
+  fail_unless (allocator == sysmem);
+  gst_object_unref (allocator);
+  gst_query_unref (query);
+
+  gst_object_unref (sysmem);
+  gst_caps_unref (caps);
+}
+
+GST_END_TEST;
+
+static Suite *
+slab_allocator_suite (void)
+{
+  Suite *s = suite_create ("slaballocator");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_reuse);
+  tcase_add_test (tc_chain, test_map_share_copy);
+  tcase_add_test (tc_chain, test_other_thread_free);
+  tcase_add_test (tc_chain, test_producer_consumer);
+  tcase_add_test (tc_chain, test_allocation_query);
+
+  return s;
+}
+
+GST_CHECK_MAIN (slab_allocator);
@@ -0,0 +1,172 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE ConnectManyBenchmark
+#include <boost/test/unit_test.hpp>
+#include <MediaPipelineImpl.hpp>
+#include <MediaElementImpl.hpp>
+#include <ElementConnectionData.hpp>
+#include <MediaType.hpp>
+#include <MediaSet.hpp>
+#include <ModuleManager.hpp>
+
+#include <chrono>
+
+using namespace kurento;
+
+#define VIEWERS 500
+
+ModuleManager moduleManager;
+boost::property_tree::ptree config;
+
+struct GF {
+  GF();
+  ~GF();
+};
+
+BOOST_GLOBAL_FIXTURE (GF)
+
+GF::GF()
+{
+  gst_init (NULL, NULL);
+  moduleManager.loadModulesFromDirectories ("../../src/server");
+}
+
+GF::~GF()
+{
+  MediaSet::deleteMediaSet();
+}
+
+static std::shared_ptr <MediaElementImpl>
+createDummyElement (const std::string &name, const std::string &mediaPipelineId)
+{
+  auto mediaObject = MediaSet::getMediaSet()->ref (new  MediaElementImpl (
+                       boost::property_tree::ptree(),
+                       MediaSet::getMediaSet()->getMediaObject (mediaPipelineId),
+                       name) );
+  std::shared_ptr <MediaElementImpl> element = std::dynamic_pointer_cast
+      <MediaElementImpl> (mediaObject);
+  MediaSet::getMediaSet()->ref ("", mediaObject);
+
+  return element;
+}
+
+static void
+releaseMediaObject (const std::string &id)
+{
+  MediaSet::getMediaSet ()->release (id);
+}
+
+static double
+attach_viewers (bool batched)
+{
+  std::shared_ptr <MediaType> VIDEO (new MediaType (MediaType::VIDEO) );
+  std::vector<std::shared_ptr<MediaElement>> viewers;
+  std::vector<std::shared_ptr<ElementConnectionData>> connections;
+  std::string mediaPipelineId =
+    moduleManager.getFactory ("MediaPipeline")->createObject (
+      config, "",
+      Json::Value() )->getId();
+  std::shared_ptr <MediaElementImpl> src = createDummyElement ("dummysrc",
+      mediaPipelineId);
+
+  g_object_set (src->getGstreamerElement(), "video", TRUE, NULL);
+
+  for (int i = 0; i < VIEWERS; i++) {
+    std::shared_ptr <MediaElementImpl> viewer = createDummyElement ("dummysink",
+        mediaPipelineId);
+
+    g_object_set (viewer->getGstreamerElement(), "video", TRUE, NULL);
+    viewers.push_back (viewer);
+  }
+
+  auto start = std::chrono::steady_clock::now ();
+
+  if (batched) {
+    connections = src->connectMany (viewers, VIDEO);
+  } else {
+    for (auto viewer : viewers) {
+      src->connect (viewer, VIDEO);
+    }
+
+    connections = src->getSinkConnections (VIDEO);
+  }
+
+  std::chrono::duration<double, std::milli> elapsed =
+    std::chrono::steady_clock::now () - start;
+
+  BOOST_CHECK (connections.size () == VIEWERS);
+
+  for (auto viewer : viewers) {
+    BOOST_CHECK (viewer->getSourceConnections (VIDEO).size () == 1);
+    releaseMediaObject (viewer->getId () );
+  }
+
+  releaseMediaObject (src->getId () );
+  releaseMediaObject (mediaPipelineId);
+
+  return elapsed.count ();
+}
+
+BOOST_AUTO_TEST_CASE (attach_viewers_one_by_one)
+{
+  double ms = attach_viewers (false);
+
+  BOOST_TEST_MESSAGE ("connect: " << VIEWERS << " viewers attached in " << ms
+                      << " ms");
+}
+
+BOOST_AUTO_TEST_CASE (attach_viewers_batched)
+{
+  double ms = attach_viewers (true);
+
+  BOOST_TEST_MESSAGE ("connectMany: " << VIEWERS << " viewers attached in " <<
+                      ms << " ms");
+}
+
+BOOST_AUTO_TEST_CASE (connect_many_skips_foreign_sinks)
+{
+  std::shared_ptr <MediaType> AUDIO (new MediaType (MediaType::AUDIO) );
+  std::string mediaPipelineId1 =
+    moduleManager.getFactory ("MediaPipeline")->createObject (
+      config, "",
+      Json::Value() )->getId();
+  std::string mediaPipelineId2 =
+    moduleManager.getFactory ("MediaPipeline")->createObject (
+      config, "",
+      Json::Value() )->getId();
+  std::shared_ptr <MediaElementImpl> src = createDummyElement ("dummysrc",
+      mediaPipelineId1);
+  std::shared_ptr <MediaElementImpl> sink = createDummyElement ("dummysink",
+      mediaPipelineId1);
+  std::shared_ptr <MediaElementImpl> foreign = createDummyElement ("dummysink",
+      mediaPipelineId2);
+  std::vector<std::shared_ptr<MediaElement>> sinks = {sink, foreign, sink};
+
+  auto connections = src->connectMany (sinks, AUDIO);
+
+  BOOST_REQUIRE (connections.size () == 1);
+  BOOST_CHECK (connections.at (0)->getSink ()->getId () == sink->getId () );
+  BOOST_CHECK (foreign->getSourceConnections ().size () == 0);
+
+  releaseMediaObject (sink->getId () );
+  releaseMediaObject (foreign->getId () );
+  releaseMediaObject (src->getId () );
+  releaseMediaObject (mediaPipelineId1);
+  releaseMediaObject (mediaPipelineId2);
+}
@@ -0,0 +1,82 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE EventHandler
+#include <boost/test/unit_test.hpp>
+#include <EventHandler.hpp>
+#include <gst/gst.h>
+
+#include <condition_variable>
+#include <mutex>
+
+using namespace kurento;
+
+class DummyEventHandler : public EventHandler
+{
+public:
+  DummyEventHandler () : EventHandler (nullptr) {}
+
+  virtual void sendEvent (Json::Value &value) override
+  {
+  }
+};
+
+BOOST_AUTO_TEST_CASE (dispatch_order)
+{
+  const int EVENTS = 1000;
+  std::shared_ptr<EventHandler> handler (new DummyEventHandler () );
+  std::vector<int> received;
+  std::mutex mutex;
+  std::condition_variable cond;
+  uint64_t dispatched = 0;
+
+  gst_init (NULL, NULL);
+
+  for (auto stats : EventHandler::getDispatchStats () ) {
+    dispatched += stats.dispatched;
+  }
+
+  for (int i = 0; i < EVENTS; i++) {
+    handler->sendEventAsync ([&, i] () {
+      std::unique_lock <std::mutex> lock (mutex);
+
+      received.push_back (i);
+      cond.notify_all ();
+    });
+  }
+
+  std::unique_lock <std::mutex> lock (mutex);
+
+  BOOST_REQUIRE (cond.wait_for (lock, std::chrono::seconds (5), [&] () {
+    return received.size () == EVENTS;
+  }) );
+
+  for (int i = 0; i < EVENTS; i++) {
+    BOOST_CHECK_EQUAL (received[i], i);
+  }
+
+  lock.unlock ();
+
+  uint64_t total = 0;
+
+  for (auto stats : EventHandler::getDispatchStats () ) {
+    total += stats.dispatched;
+  }
+
+  BOOST_CHECK_GE (total - dispatched, (uint64_t) EVENTS);
+}
@@ -27,6 +27,10 @@
 #include <MediaSet.hpp>
 #include <ModuleManager.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 using namespace kurento;
 
 ModuleManager moduleManager;
@@ -64,6 +68,45 @@ createDummyElement (const std::string &name, const std::string &mediaPipelineId)
   return element;
 }
 
+static std::shared_ptr <MediaElementImpl>
+createCoalescingElement (const std::string &mediaPipelineId, int interval)
+{
+  boost::property_tree::ptree elementConfig;
+
+  elementConfig.put ("modules.kurento.MediaElement.mediaFlowCoalesceInterval",
+                     interval);
+
+  auto mediaObject = MediaSet::getMediaSet()->ref (new  MediaElementImpl (
+                       elementConfig,
+                       MediaSet::getMediaSet()->getMediaObject (mediaPipelineId),
+                       "dummysrc") );
+  MediaSet::getMediaSet()->ref ("", mediaObject);
+
+  return std::dynamic_pointer_cast <MediaElementImpl> (mediaObject);
+}
+
+static void
+emitFlowOut (std::shared_ptr <MediaElementImpl> element, bool flowing)
+{
+  g_signal_emit_by_name (element->getGstreamerElement(), "flow-out-media",
+                         flowing, "default", KMS_ELEMENT_PAD_TYPE_VIDEO);
+}
+
+/* Windows expire on the default main context */
+static void
+waitForWindow (int interval)
+{
+  auto end = std::chrono::steady_clock::now () +
+             std::chrono::milliseconds (3 * interval);
+
+  while (std::chrono::steady_clock::now () < end) {
+    while (g_main_context_iteration (NULL, FALSE) ) {
+    }
+
+    std::this_thread::sleep_for (std::chrono::milliseconds (5) );
+  }
+}
+
 static void
 releaseMediaObject (const std::string &id)
 {
@@ -299,3 +342,164 @@ BOOST_AUTO_TEST_CASE (dot_test)
   src.reset();
   pipe.reset();
 }
+
+BOOST_AUTO_TEST_CASE (pipeline_teardown)
+{
+  std::atomic<int> disconnections (0);
+  std::vector<std::shared_ptr <MediaElementImpl>> sinks;
+  std::string mediaPipelineId =
+    moduleManager.getFactory ("MediaPipeline")->createObject (
+      config, "",
+      Json::Value() )->getId();
+  std::shared_ptr <MediaPipelineImpl> pipe = std::dynamic_pointer_cast
+      <MediaPipelineImpl> (MediaSet::getMediaSet()->getMediaObject (
+                             mediaPipelineId) );
+  std::shared_ptr <MediaElementImpl> src = createDummyElement ("dummysrc",
+      mediaPipelineId);
+
+  g_object_set (src->getGstreamerElement(), "audio", TRUE, "video", TRUE, NULL);
+
+  for (int i = 0; i < 50; i++) {
+    std::shared_ptr <MediaElementImpl> sink = createDummyElement ("dummysink",
+        mediaPipelineId);
+
+    g_object_set (sink->getGstreamerElement(), "audio", TRUE, "video", TRUE,
+                  NULL);
+    src->connect (sink);
+    sink->signalElementDisconnected.connect ([&] (ElementDisconnected event) {
+      disconnections++;
+    });
+    sinks.push_back (sink);
+  }
+
+  src->signalElementDisconnected.connect ([&] (ElementDisconnected event) {
+    disconnections++;
+  });
+
+  releaseMediaObject (mediaPipelineId);
+
+  for (int i = 0; i < 500 && !pipe->isTearingDown (); i++) {
+    std::this_thread::sleep_for (std::chrono::milliseconds (10) );
+  }
+
+  BOOST_REQUIRE (pipe->isTearingDown () );
+
+  for (int i = 0; i < 500 && !src->getSinkConnections ().empty (); i++) {
+    std::this_thread::sleep_for (std::chrono::milliseconds (10) );
+  }
+
+  BOOST_CHECK (src->getSinkConnections ().empty () );
+  BOOST_CHECK_EQUAL (disconnections, 0);
+  BOOST_CHECK_EQUAL (GST_STATE (pipe->getPipeline () ), GST_STATE_NULL);
+
+  sinks.clear();
+  src.reset();
+  pipe.reset();
+}
+
+BOOST_AUTO_TEST_CASE (media_flow_not_coalesced_by_default)
+{
+  std::vector<MediaFlowState::type> states;
+  std::string mediaPipelineId =
+    moduleManager.getFactory ("MediaPipeline")->createObject (
+      config, "",
+      Json::Value() )->getId();
+  std::shared_ptr <MediaElementImpl> src = createDummyElement ("dummysrc",
+      mediaPipelineId);
+
+  src->signalMediaFlowOutStateChange.connect ([&] (
+  MediaFlowOutStateChange event) {
+    states.push_back (event.getState ()->getValue () );
+  });
+
+  emitFlowOut (src, true);
+  emitFlowOut (src, false);
+  emitFlowOut (src, true);
+
+  BOOST_REQUIRE_EQUAL (states.size (), 3U);
+  BOOST_CHECK (states[0] == MediaFlowState::FLOWING);
+  BOOST_CHECK (states[1] == MediaFlowState::NOT_FLOWING);
+  BOOST_CHECK (states[2] == MediaFlowState::FLOWING);
+
+  releaseMediaObject (src->getId() );
+  releaseMediaObject (mediaPipelineId);
+
+  src.reset();
+}
+
+BOOST_AUTO_TEST_CASE (media_flow_flapping_coalesced)
+{
+  const int interval = 100;
+  std::vector<MediaFlowState::type> states;
+  std::string mediaPipelineId =
+    moduleManager.getFactory ("MediaPipeline")->createObject (
+      config, "",
+      Json::Value() )->getId();
+  std::shared_ptr <MediaElementImpl> src = createCoalescingElement (
+        mediaPipelineId, interval);
+
+  src->signalMediaFlowOutStateChange.connect ([&] (
+  MediaFlowOutStateChange event) {
+    states.push_back (event.getState ()->getValue () );
+  });
+
+  /* The first transition is not delayed */
+  emitFlowOut (src, true);
+  BOOST_REQUIRE_EQUAL (states.size (), 1U);
+  BOOST_CHECK (states[0] == MediaFlowState::FLOWING);
+
+  /* Flaps back to the notified state cancel out */
+  emitFlowOut (src, false);
+  emitFlowOut (src, true);
+  emitFlowOut (src, false);
+  emitFlowOut (src, true);
+  BOOST_CHECK_EQUAL (states.size (), 1U);
+
+  waitForWindow (interval);
+  BOOST_CHECK_EQUAL (states.size (), 1U);
+
+  releaseMediaObject (src->getId() );
+  releaseMediaObject (mediaPipelineId);
+
+  src.reset();
+}
+
+BOOST_AUTO_TEST_CASE (media_flow_state_change_flushed)
+{
+  const int interval = 100;
+  std::vector<MediaFlowState::type> states;
+  std::string mediaPipelineId =
+    moduleManager.getFactory ("MediaPipeline")->createObject (
+      config, "",
+      Json::Value() )->getId();
+  std::shared_ptr <MediaElementImpl> src = createCoalescingElement (
+        mediaPipelineId, interval);
+
+  src->signalMediaFlowOutStateChange.connect ([&] (
+  MediaFlowOutStateChange event) {
+    states.push_back (event.getState ()->getValue () );
+  });
+
+  emitFlowOut (src, true);
+  emitFlowOut (src, false);
+  emitFlowOut (src, true);
+  emitFlowOut (src, false);
+  BOOST_REQUIRE_EQUAL (states.size (), 1U);
+
+  /* The last state differs from the notified one, so it is sent when the
+   * window expires */
+  waitForWindow (interval);
+  BOOST_REQUIRE_EQUAL (states.size (), 2U);
+  BOOST_CHECK (states[1] == MediaFlowState::NOT_FLOWING);
+
+  /* A quiet window closes, the next transition is sent at once */
+  waitForWindow (interval);
+  emitFlowOut (src, true);
+  BOOST_REQUIRE_EQUAL (states.size (), 3U);
+  BOOST_CHECK (states[2] == MediaFlowState::FLOWING);
+
+  releaseMediaObject (src->getId() );
+  releaseMediaObject (mediaPipelineId);
+
+  src.reset();
+}
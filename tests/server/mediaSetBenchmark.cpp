@@ -0,0 +1,152 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE MediaSetBenchmark
+#include <boost/test/unit_test.hpp>
+#include <ModuleManager.hpp>
+#include <KurentoException.hpp>
+#include <gst/gst.h>
+#include <MediaSet.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+#include <config.h>
+
+using namespace kurento;
+
+#define THREADS 16
+#define PIPELINES 64
+/* Kept small so it can run with the unit tests, set
+ * KMS_MEDIASET_BENCHMARK_ITERATIONS for meaningful numbers */
+#define DEFAULT_ITERATIONS 500
+
+static int
+get_iterations ()
+{
+  const char *value = g_getenv ("KMS_MEDIASET_BENCHMARK_ITERATIONS");
+
+  if (value != NULL && atoi (value) > 0) {
+    return atoi (value);
+  }
+
+  return DEFAULT_ITERATIONS;
+}
+
+static const int ITERATIONS = get_iterations ();
+
+std::shared_ptr <ModuleManager> moduleManager;
+
+struct InitTests {
+  InitTests();
+  ~InitTests();
+};
+
+BOOST_GLOBAL_FIXTURE (InitTests)
+
+InitTests::InitTests()
+{
+  gst_init (NULL, NULL);
+
+  moduleManager = std::shared_ptr<ModuleManager> (new ModuleManager() );
+
+  std::string moduleName = "../../src/server/libkmscoremodule.so";
+
+  moduleManager->loadModule (moduleName);
+}
+
+InitTests::~InitTests()
+{
+  moduleManager.reset();
+  MediaSet::deleteMediaSet();
+}
+
+static double
+run_threads (std::function<void (int) > func)
+{
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now ();
+
+  for (int i = 0; i < THREADS; i++) {
+    threads.push_back (std::thread (func, i) );
+  }
+
+  for (auto &t : threads) {
+    t.join ();
+  }
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now () -
+                                          start;
+
+  return (double) THREADS * ITERATIONS / elapsed.count ();
+}
+
+BOOST_AUTO_TEST_CASE (lookups_and_refs)
+{
+  std::shared_ptr<kurento::Factory> mediaPipelineFactory;
+  std::vector<std::string> ids;
+  std::atomic<int> errors (0);
+  double opsPerSecond;
+
+  mediaPipelineFactory = moduleManager->getFactory ("MediaPipeline");
+
+  for (int i = 0; i < PIPELINES; i++) {
+    ids.push_back (mediaPipelineFactory->createObject (
+                     boost::property_tree::ptree(), "session",
+                     Json::Value() )->getId() );
+  }
+
+  opsPerSecond = run_threads ([&] (int thread) {
+    for (int i = 0; i < ITERATIONS; i++) {
+      try {
+        MediaSet::getMediaSet ()->getMediaObject (ids[ (thread + i) % PIPELINES]);
+      } catch (KurentoException &e) {
+        errors++;
+      }
+    }
+  });
+
+  BOOST_TEST_MESSAGE ("Lookups: " << (long) opsPerSecond << " ops/s with "
+                      << THREADS << " threads");
+
+  opsPerSecond = run_threads ([&] (int thread) {
+    std::string sessionId = "session" + std::to_string (thread);
+
+    for (int i = 0; i < ITERATIONS; i++) {
+      try {
+        MediaSet::getMediaSet ()->getMediaObject (sessionId,
+            ids[ (thread + i) % PIPELINES]);
+      } catch (KurentoException &e) {
+        errors++;
+      }
+    }
+  });
+
+  BOOST_TEST_MESSAGE ("Refs: " << (long) opsPerSecond << " ops/s with "
+                      << THREADS << " threads");
+
+  BOOST_CHECK_EQUAL (errors, 0);
+
+  for (int i = 0; i < THREADS; i++) {
+    MediaSet::getMediaSet ()->unrefSession ("session" + std::to_string (i) );
+  }
+
+  MediaSet::getMediaSet ()->unrefSession ("session");
+}
@@ -0,0 +1,121 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Metrics
+#include <boost/test/unit_test.hpp>
+#include <Metrics.hpp>
+#include <gst/gst.h>
+
+#include <thread>
+
+using namespace kurento;
+
+static bool
+contains (const std::string &text, const std::string &line)
+{
+  return text.find (line + "\n") != std::string::npos;
+}
+
+BOOST_AUTO_TEST_CASE (counters_from_threads)
+{
+  const int THREADS = 4;
+  const int INCREMENTS = 100000;
+  MetricsRegistry &registry = MetricsRegistry::getRegistry ();
+  std::shared_ptr<MetricCounter> counter;
+  std::vector<std::thread> threads;
+  std::string text;
+
+  gst_init (NULL, NULL);
+
+  counter = registry.getCounter ("test_increments_total", "Increments",
+                                 "kind=\"a\"");
+  BOOST_CHECK (counter == registry.getCounter ("test_increments_total",
+               "Increments", "kind=\"a\"") );
+  registry.getCounter ("test_increments_total", "Increments",
+                       "kind=\"b\"")->inc ();
+
+  for (int i = 0; i < THREADS; i++) {
+    threads.push_back (std::thread ([counter] () {
+      for (int j = 0; j < INCREMENTS; j++) {
+        counter->inc ();
+      }
+    }) );
+  }
+
+  for (auto &thread : threads) {
+    thread.join ();
+  }
+
+  BOOST_CHECK_EQUAL (counter->get (), THREADS * INCREMENTS);
+
+  text = registry.scrape ();
+
+  BOOST_CHECK (contains (text, "# HELP test_increments_total Increments") );
+  BOOST_CHECK (contains (text, "# TYPE test_increments_total counter") );
+  BOOST_CHECK (contains (text, "test_increments_total{kind=\"a\"} 400000") );
+  BOOST_CHECK (contains (text, "test_increments_total{kind=\"b\"} 1") );
+  /* Only one header per metric */
+  BOOST_CHECK_EQUAL (text.find ("# TYPE test_increments_total"),
+                     text.rfind ("# TYPE test_increments_total") );
+}
+
+BOOST_AUTO_TEST_CASE (histogram_buckets)
+{
+  MetricsRegistry &registry = MetricsRegistry::getRegistry ();
+  std::shared_ptr<MetricHistogram> histogram;
+  std::string text;
+
+  histogram = registry.getHistogram ("test_latency_seconds", "Latency", {0.1, 1});
+  histogram->observe (0.05);
+  histogram->observe (0.1);
+  histogram->observe (0.5);
+  histogram->observe (5);
+
+  text = registry.scrape ();
+
+  BOOST_CHECK (contains (text, "# TYPE test_latency_seconds histogram") );
+  BOOST_CHECK (contains (text, "test_latency_seconds_bucket{le=\"0.1\"} 2") );
+  BOOST_CHECK (contains (text, "test_latency_seconds_bucket{le=\"1\"} 3") );
+  BOOST_CHECK (contains (text, "test_latency_seconds_bucket{le=\"+Inf\"} 4") );
+  BOOST_CHECK (contains (text, "test_latency_seconds_sum 5.65") );
+  BOOST_CHECK (contains (text, "test_latency_seconds_count 4") );
+}
+
+BOOST_AUTO_TEST_CASE (collectors)
+{
+  MetricsRegistry &registry = MetricsRegistry::getRegistry ();
+  int value = 3;
+  int id;
+
+  id = registry.addCollector ([&value] (MetricsWriter & writer) {
+    writer.gauge ("test_value", "Value", value);
+    writer.summary ("test_summary", "Summary", {{0.5, 10}}, 2, 25);
+  });
+
+  BOOST_CHECK (contains (registry.scrape (), "test_value 3") );
+
+  value = 4;
+  BOOST_CHECK (contains (registry.scrape (), "test_value 4") );
+  BOOST_CHECK (contains (registry.scrape (),
+                         "test_summary{quantile=\"0.5\"} 10") );
+  BOOST_CHECK (contains (registry.scrape (), "test_summary_sum 25") );
+  BOOST_CHECK (contains (registry.scrape (), "test_summary_count 2") );
+
+  registry.removeCollector (id);
+  BOOST_CHECK (registry.scrape ().find ("test_value") == std::string::npos);
+}
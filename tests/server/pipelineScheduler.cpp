@@ -0,0 +1,195 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE PipelineScheduler
+#include <boost/test/unit_test.hpp>
+#include <PipelineScheduler.hpp>
+#include <gst/gst.h>
+
+#include <chrono>
+#include <thread>
+
+using namespace kurento;
+
+static GstElement *
+create_busy_pipeline ()
+{
+  GstElement *pipeline = gst_pipeline_new (NULL);
+  GstElement *src = gst_element_factory_make ("fakesrc", "src");
+  GstElement *sink = gst_element_factory_make ("fakesink", NULL);
+
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), src, sink, NULL);
+  gst_element_link (src, sink);
+
+  return pipeline;
+}
+
+static PipelineScheduleConfig
+create_config (bool pin, bool sharedTaskPool)
+{
+  PipelineScheduleConfig config;
+
+  config.pin = pin;
+  config.cpusPerPipeline = 1;
+  config.sharedTaskPool = sharedTaskPool;
+  config.accountMemory = false;
+  config.accountThreads = true;
+
+  return config;
+}
+
+BOOST_AUTO_TEST_CASE (cpu_time_and_placement)
+{
+  std::shared_ptr<PipelineSchedule> first, second;
+  GstElement *pipeline;
+
+  gst_init (NULL, NULL);
+
+  pipeline = create_busy_pipeline ();
+  first = PipelineScheduler::getScheduler ().schedule (pipeline,
+          create_config (true, false) );
+
+  BOOST_CHECK (first->getCpu () >= 0);
+  BOOST_CHECK (first->getCpuTime () == 0);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  std::this_thread::sleep_for (std::chrono::milliseconds (200) );
+
+  BOOST_CHECK (first->getCpuTime () > 0);
+
+  second = PipelineScheduler::getScheduler ().schedule (pipeline,
+          create_config (true, false) );
+
+  if (std::thread::hardware_concurrency () > 1) {
+    /* The first pipeline is busy, the second goes somewhere else */
+    BOOST_CHECK (second->getCpu () != first->getCpu () );
+  }
+
+  second.reset ();
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  uint64_t cpuTime = first->getCpuTime ();
+
+  std::this_thread::sleep_for (std::chrono::milliseconds (50) );
+  BOOST_CHECK (first->getCpuTime () == cpuTime);
+
+  first.reset ();
+  g_object_unref (pipeline);
+}
+
+BOOST_AUTO_TEST_CASE (unpinned)
+{
+  GstElement *pipeline = create_busy_pipeline ();
+  std::shared_ptr<PipelineSchedule> schedule =
+    PipelineScheduler::getScheduler ().schedule (pipeline,
+          create_config (false, false) );
+
+  BOOST_CHECK (schedule->getCpu () == -1);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  std::this_thread::sleep_for (std::chrono::milliseconds (100) );
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  BOOST_CHECK (schedule->getCpuTime () > 0);
+
+  schedule.reset ();
+  g_object_unref (pipeline);
+}
+
+BOOST_AUTO_TEST_CASE (nothing_configured)
+{
+  GstElement *pipeline = create_busy_pipeline ();
+  PipelineScheduleConfig config = create_config (false, false);
+  std::shared_ptr<PipelineSchedule> schedule;
+
+  config.accountThreads = false;
+  schedule = PipelineScheduler::getScheduler ().schedule (pipeline, config);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  gst_element_get_state (pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
+
+  /* Streaming threads are not followed at all */
+  BOOST_CHECK (schedule->getThreadCount () == 0);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  BOOST_CHECK (schedule->getCpuTime () == 0);
+
+  schedule.reset ();
+  g_object_unref (pipeline);
+}
+
+BOOST_AUTO_TEST_CASE (thread_count_shared_pool)
+{
+  GstElement *pipeline = create_busy_pipeline ();
+  GstElement *src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  std::shared_ptr<PipelineSchedule> schedule =
+    PipelineScheduler::getScheduler ().schedule (pipeline,
+        create_config (false, true) );
+
+  BOOST_CHECK (schedule->getThreadCount () == 0);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  gst_element_get_state (pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
+
+  BOOST_CHECK (schedule->getThreadCount () == 1);
+  BOOST_CHECK (schedule->getThreadCount (src) == 1);
+  BOOST_CHECK (PipelineScheduler::getScheduler ().getThreadCount () >= 1);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  BOOST_CHECK (schedule->getThreadCount () == 0);
+  BOOST_CHECK (schedule->getThreadCount (src) == 0);
+
+  schedule.reset ();
+  g_object_unref (src);
+  g_object_unref (pipeline);
+}
+
+BOOST_AUTO_TEST_CASE (memory_accounting)
+{
+  GstElement *pipeline = create_busy_pipeline ();
+  GstElement *src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  PipelineScheduleConfig config = create_config (false, false);
+  std::shared_ptr<PipelineSchedule> schedule;
+  GstMemory *memory;
+
+  config.accountMemory = true;
+  schedule = PipelineScheduler::getScheduler ().schedule (pipeline, config);
+
+  /* Threads that are not streaming threads of the pipeline are not charged */
+  memory = gst_allocator_alloc (NULL, 1000, NULL);
+  BOOST_CHECK (schedule->getMemory () == 0);
+  gst_memory_unref (memory);
+
+  g_object_set (src, "sizetype", 2, "sizemax", 100000, "num-buffers", 100,
+                NULL);
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  std::this_thread::sleep_for (std::chrono::milliseconds (100) );
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  /* Buffers are gone, the peak was at least one of them */
+  BOOST_CHECK (schedule->getMemory () == 0);
+  BOOST_CHECK (schedule->getPeakMemory () >= 100000);
+
+  schedule.reset ();
+  g_object_unref (src);
+  g_object_unref (pipeline);
+}
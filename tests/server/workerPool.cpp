@@ -0,0 +1,103 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE WorkerPool
+#include <boost/test/unit_test.hpp>
+#include <WorkerPool.hpp>
+#include <gst/gst.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+using namespace kurento;
+
+BOOST_AUTO_TEST_CASE (single_thread_order)
+{
+  const int TASKS = 1000;
+  std::vector<int> executed;
+
+  gst_init (NULL, NULL);
+
+  {
+    WorkerPool pool (1);
+
+    for (int i = 0; i < TASKS; i++) {
+      pool.post ([&executed, i] () {
+        executed.push_back (i);
+      });
+    }
+  }
+
+  /* Pending tasks are run when the pool is destroyed */
+  BOOST_REQUIRE_EQUAL (executed.size (), TASKS);
+
+  for (int i = 0; i < TASKS; i++) {
+    BOOST_CHECK_EQUAL (executed[i], i);
+  }
+}
+
+BOOST_AUTO_TEST_CASE (nested_posts_and_stats)
+{
+  const int TASKS = 10000;
+  std::atomic<int> executed (0);
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool done = false;
+  WorkerPool pool (4);
+
+  gst_init (NULL, NULL);
+
+  auto finish = [&] () {
+    if (++executed == 2 * TASKS) {
+      std::unique_lock <std::mutex> lock (mutex);
+      done = true;
+      cond.notify_all ();
+    }
+  };
+
+  for (int i = 0; i < TASKS; i++) {
+    pool.post ([&finish, &pool] () {
+      finish ();
+      pool.post ([&finish] () {
+        finish ();
+      });
+    });
+  }
+
+  std::unique_lock <std::mutex> lock (mutex);
+  cond.wait (lock, [&done] () {
+    return done;
+  });
+  lock.unlock ();
+
+  BOOST_REQUIRE_EQUAL (executed, 2 * TASKS);
+
+  WorkerPoolStats stats = pool.getStats ();
+  uint64_t histogramTotal = 0;
+
+  for (auto count : stats.latencyHistogram) {
+    histogramTotal += count;
+  }
+
+  BOOST_CHECK_EQUAL (stats.queueDepth, 0);
+  BOOST_CHECK_EQUAL (stats.executed, 2 * TASKS);
+  BOOST_CHECK_EQUAL (stats.latencyHistogram.size (),
+                     WorkerPool::LATENCY_BUCKETS);
+  BOOST_CHECK_EQUAL (histogramTotal, 2 * TASKS);
+}